@@ -0,0 +1,75 @@
+import matplotlib.pyplot as plt
+import subprocess
+import tempfile
+import shutil
+import json
+import time
+import sys
+import os
+import re
+
+# 用法: python scaling.py [build目录] [每次生成的用例数]
+BUILD_DIR = 'build'
+NUM_CASES = 200
+if len(sys.argv) > 1:
+    BUILD_DIR = sys.argv[1]
+if len(sys.argv) > 2:
+    NUM_CASES = int(sys.argv[2])
+
+MAIN = os.path.join(BUILD_DIR, 'main')
+SYNTH = os.path.join(BUILD_DIR, 'ststgen_synth')
+
+# 每个参数单独扫描，其余参数保持为0
+SWEEPS = {
+    'chain': [4, 16, 64, 256, 1024],
+    'disjunction': [2, 8, 32, 128],
+    'or_density': [1, 4, 16, 64],
+    'array': [2, 4, 8, 16, 32],
+    'struct_array': [2, 8, 32, 128],
+    'struct_fields': [2, 4, 8, 16, 32],
+}
+
+
+CASE_FILE = re.compile(r'[PN]\d{5,}\.json')
+
+
+def run(param, value):
+    work = tempfile.mkdtemp(prefix='ststgen_scaling_')
+    cons = os.path.join(work, 'cons.c')
+    out = os.path.join(work, 'out')
+    args = [SYNTH, '--' + param, str(value), '-o', cons]
+    if param == 'struct_fields':
+        args += ['--struct_array', '8']
+    subprocess.run(args, check=True)
+    begin = time.perf_counter()
+    subprocess.run([MAIN, '-n', str(NUM_CASES), '-p', '0.5', '-c', cons, '-o', out],
+                   check=True, stdout=subprocess.DEVNULL)
+    elapsed = time.perf_counter() - begin
+    # 输出目录中还有manifest.json，只数用例文件
+    generated = len([f for f in os.listdir(out) if CASE_FILE.fullmatch(f)]) if os.path.isdir(out) else 0
+    shutil.rmtree(work)
+    return generated / elapsed
+
+
+results = {}
+for param, values in SWEEPS.items():
+    results[param] = []
+    for v in values:
+        rate = run(param, v)
+        print(f'{param}={v}: {rate:.1f} cases/s')
+        results[param].append([v, rate])
+
+with open('scaling.json', 'w') as f:
+    json.dump(results, f, indent=4)
+
+fig, axes = plt.subplots(2, 3, figsize=(15, 8))
+for ax, (param, points) in zip(axes.flat, results.items()):
+    xs = [p[0] for p in points]
+    ys = [p[1] for p in points]
+    ax.loglog(xs, ys, marker='o')
+    ax.set_title(param)
+    ax.set_xlabel('value')
+    ax.set_ylabel('cases/s')
+fig.tight_layout()
+plt.savefig('scaling.png')
+plt.show()
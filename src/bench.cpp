@@ -0,0 +1,252 @@
+#include "cmdline.h"
+#include "frontend.hpp"
+#include "parser.hpp"
+#include "subset_parser.hpp"
+#include "synth.hpp"
+
+#include "utils.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fmt/core.h>
+#include <nlohmann/json.hpp>
+
+#ifndef STSTGEN_EXAMPLES_DIR
+#define STSTGEN_EXAMPLES_DIR "constraint-examples"
+#endif
+
+namespace {
+    using json = nlohmann::json;
+    using steady_clock = std::chrono::steady_clock;
+    const char *PHASES[] = {"parse", "visit", "solve", "mutate", "extract", "validate", "write", "total"};
+
+    struct Workload {
+        std::string name;
+        std::string src;
+        ststgen::ArrayEncoding array_encoding = ststgen::ArrayEncoding::Nested;
+    };
+
+    double seconds(std::chrono::nanoseconds ns) {
+        return ns.count() / 1e9;
+    }
+
+    json run_once(const Workload &workload, int cases, bool is_positive, unsigned seed, const std::filesystem::path &out) {
+        std::filesystem::remove_all(out);
+        std::filesystem::create_directories(out);
+        auto time_begin = steady_clock::now();
+        ststgen::ConstraintFrontend frontend{workload.src};
+        auto *tree = frontend.parse();
+        auto time_parse = steady_clock::now();
+
+        auto visitor = ststgen::CConstraintVisitor{cases, is_positive, 0};
+        visitor.setArrayEncoding(workload.array_encoding);
+        visitor.visit(tree);
+        auto time_visit = steady_clock::now();
+        visitor.setRandomSeed(seed);
+        visitor.mutateEntrance(out.string());
+        auto time_generate = steady_clock::now();
+        visitor.writeCases();
+        auto time_end = steady_clock::now();
+
+        const auto &phase = visitor.getMetrics().times;
+        std::chrono::nanoseconds generate = time_generate - time_visit;
+        json ret{};
+        ret["parse"] = seconds(time_parse - time_begin);
+        ret["visit"] = seconds(time_visit - time_parse);
+        ret["solve"] = seconds(phase.solve);
+        ret["extract"] = seconds(phase.extract);
+        ret["mutate"] = seconds(generate - phase.solve - phase.extract);
+        ret["validate"] = seconds(phase.validate);
+        ret["write"] = seconds(phase.write);
+        ret["total"] = seconds(time_end - time_begin);
+        return ret;
+    }
+
+    /// @brief 单独比较三种前端的解析时间，取repeat次的中位数
+    json frontend_times(const Workload &workload, int repeat) {
+        auto median = [repeat](auto &&parse_once) {
+            std::vector<double> v{};
+            for (int r = 0; r < repeat; ++r) {
+                auto time_begin = steady_clock::now();
+                parse_once();
+                v.push_back(seconds(steady_clock::now() - time_begin));
+            }
+            std::sort(v.begin(), v.end());
+            return v[v.size() / 2];
+        };
+        json ret{};
+        ret["antlr_ll"] = median([&] {
+            ststgen::ConstraintFrontend frontend{workload.src};
+            frontend.parse(false);
+        });
+        bool fallback = false;
+        ret["antlr_sll"] = median([&] {
+            ststgen::ConstraintFrontend frontend{workload.src};
+            frontend.parse();
+            fallback = frontend.used_fallback();
+        });
+        ret["sll_fallback"] = fallback;
+        try {
+            ret["subset_rd"] = median([&] { ststgen::subset::parse(workload.src); });
+        } catch (const ststgen::subset::SyntaxError &e) {
+            ret["subset_rd"] = nullptr;
+            ret["subset_error"] = e.what();
+        }
+        return ret;
+    }
+
+    json median_of(const json &runs) {
+        json ret{};
+        for (auto phase: PHASES) {
+            std::vector<double> v{};
+            for (const auto &r: runs) {
+                v.push_back(r[phase].get<double>());
+            }
+            std::sort(v.begin(), v.end());
+            ret[phase] = v.empty() ? 0.0 : v[v.size() / 2];
+        }
+        return ret;
+    }
+}// namespace
+
+int main(int argc, char **argv) try {
+    cmdline::parser cmd_parser;
+    cmd_parser.add<int>(
+            "num_cases",
+            'n',
+            "number of testcases generated per polarity and run",
+            false,
+            200,
+            cmdline::range(1, 65536));
+    cmd_parser.add<int>(
+            "repeat",
+            'r',
+            "runs per workload, the median is reported",
+            false,
+            3,
+            cmdline::range(1, 100));
+    cmd_parser.add<unsigned>(
+            "seed",
+            's',
+            "random seed of the first run",
+            false,
+            2025);
+    cmd_parser.add<std::string>(
+            "examples",
+            'e',
+            "directory of constraint files",
+            false,
+            STSTGEN_EXAMPLES_DIR);
+    cmd_parser.add<std::string>(
+            "filter",
+            'f',
+            "only run workloads whose name contains this string",
+            false,
+            "");
+    cmd_parser.add<std::string>(
+            "array_encoding",
+            'a',
+            "array encoding to measure: flat, nested or both",
+            false,
+            "both",
+            cmdline::oneof<std::string>("flat", "nested", "both"));
+    cmd_parser.add<std::string>(
+            "output",
+            'o',
+            "write the json report to this file instead of stdout",
+            false,
+            "");
+    cmd_parser.parse_check(argc, argv);
+    ststgen::g_log_level = 0;
+
+    std::vector<Workload> workloads{};
+    std::vector<std::filesystem::path> files{};
+    for (const auto &e: std::filesystem::directory_iterator(cmd_parser.get<std::string>("examples"))) {
+        if (e.path().extension() == ".c") {
+            files.push_back(e.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto &f: files) {
+        std::ifstream in{f};
+        workloads.push_back({f.filename().string(), std::string{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()}});
+    }
+    for (int n: {16, 64, 256}) {
+        ststgen::SynthParams params{};
+        params.chain = n;
+        workloads.push_back({fmt::format("synthetic_chain_{}", n), ststgen::make_synthetic_constraints(params)});
+    }
+    for (int m: {4, 16, 64}) {
+        ststgen::SynthParams params{};
+        params.disjunction = m;
+        workloads.push_back({fmt::format("synthetic_or_{}", m), ststgen::make_synthetic_constraints(params)});
+    }
+    for (int k: {4, 8, 16}) {
+        ststgen::SynthParams params{};
+        params.array = k;
+        workloads.push_back({fmt::format("synthetic_array_{}x{}", k, k), ststgen::make_synthetic_constraints(params)});
+    }
+    for (int l: {4, 16, 64}) {
+        ststgen::SynthParams params{};
+        params.struct_array = l;
+        workloads.push_back({fmt::format("synthetic_struct_array_{}", l), ststgen::make_synthetic_constraints(params)});
+    }
+
+    // both: 每个负载分别以两种编码各跑一次，名字后加上编码
+    const auto encoding = cmd_parser.get<std::string>("array_encoding");
+    if (encoding == "flat") {
+        for (auto &w: workloads) {
+            w.array_encoding = ststgen::ArrayEncoding::Flat;
+        }
+    } else if (encoding == "both") {
+        std::vector<Workload> expanded{};
+        for (auto &w: workloads) {
+            expanded.push_back({w.name + " [nested]", w.src, ststgen::ArrayEncoding::Nested});
+            expanded.push_back({w.name + " [flat]", std::move(w.src), ststgen::ArrayEncoding::Flat});
+        }
+        workloads = std::move(expanded);
+    }
+
+    const auto filter = cmd_parser.get<std::string>("filter");
+    const int cases = cmd_parser.get<int>("num_cases");
+    const int repeat = cmd_parser.get<int>("repeat");
+    const unsigned seed = cmd_parser.get<unsigned>("seed");
+    const auto out = std::filesystem::temp_directory_path() / "ststgen_bench";
+
+    json report{};
+    report["num_cases"] = cases;
+    report["repeat"] = repeat;
+    report["seed"] = seed;
+    report["hardware_concurrency"] = std::thread::hardware_concurrency();
+    report["workloads"] = json::array();
+    for (const auto &workload: workloads) {
+        if (!filter.empty() && workload.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        json result{{"name", workload.name}};
+        result["frontend"] = frontend_times(workload, repeat);
+        for (bool is_positive: {true, false}) {
+            json runs = json::array();
+            for (int r = 0; r < repeat; ++r) {
+                runs.push_back(run_once(workload, cases, is_positive, seed + r, out));
+            }
+            result[is_positive ? "positive" : "negative"] = json{{"runs", runs}, {"median", median_of(runs)}};
+        }
+        fmt::println(stderr, "{}: positive {:.3f}s, negative {:.3f}s", workload.name,
+                     result["positive"]["median"]["total"].get<double>(),
+                     result["negative"]["median"]["total"].get<double>());
+        report["workloads"].push_back(std::move(result));
+    }
+    std::filesystem::remove_all(out);
+
+    const auto output = cmd_parser.get<std::string>("output");
+    if (output.empty()) {
+        fmt::println("{}", report.dump(4));
+    } else {
+        std::ofstream ofs(output);
+        ofs << std::setw(4) << report << '\n';
+    }
+    return 0;
+} catch (const std::exception &e) {
+    fmt::println("bench catch exception: {}", e.what());
+    return 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * SanitizerCoverage运行时，链接进被测共享库以向ststgen反馈覆盖：
+ *   clang -shared -fPIC -fsanitize-coverage=trace-pc-guard target.c coverage_rt.c -o libtarget.so
+ * 每条边对应位图中的一个8位计数器。dlopen之后harness把__ststgen_cov_map指向
+ * 与fork出的子进程共享的内存，在此之前(如全局构造函数中)的计数落在本文件的静态区里。
+ */
+#include <stdint.h>
+
+#define STSTGEN_COV_MAP_SIZE (1u << 16)
+
+#define STSTGEN_EXPORT __attribute__((visibility("default")))
+
+static uint8_t fallback_map[STSTGEN_COV_MAP_SIZE];
+static uint32_t next_guard = 0;
+
+STSTGEN_EXPORT uint8_t *__ststgen_cov_map = fallback_map;
+STSTGEN_EXPORT const uint32_t __ststgen_cov_map_size = STSTGEN_COV_MAP_SIZE;
+
+STSTGEN_EXPORT void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop) {
+    if (start == stop || *start) {
+        return;
+    }
+    for (uint32_t *guard = start; guard < stop; ++guard) {
+        /* 0表示未初始化，边数超过位图大小时回绕 */
+        *guard = next_guard++ % (STSTGEN_COV_MAP_SIZE - 1) + 1;
+    }
+}
+
+STSTGEN_EXPORT void __sanitizer_cov_trace_pc_guard(uint32_t *guard) {
+    if (!*guard) {
+        return;
+    }
+    uint8_t *counter = &__ststgen_cov_map[*guard];
+    /* 饱和计数，避免255次后回到0 */
+    if (*counter != UINT8_MAX) {
+        ++*counter;
+    }
+}
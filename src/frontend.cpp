@@ -0,0 +1,32 @@
+#include "frontend.hpp"
+#include "utils.hpp"
+
+namespace ststgen {
+
+    ConstraintFrontend::ConstraintFrontend(const std::string &src)
+        : m_input(src), m_lexer(&m_input), m_tokens(&m_lexer), m_parser(&m_tokens) {}
+
+    antlr4::tree::ParseTree *ConstraintFrontend::parse(bool sll_first) {
+        auto *interpreter = m_parser.getInterpreter<antlr4::atn::ParserATNSimulator>();
+        if (sll_first) {
+            interpreter->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+            m_parser.removeErrorListeners();
+            m_parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+            try {
+                m_tree = m_parser.compilationUnit();
+                return m_tree;
+            } catch (const antlr4::ParseCancellationException &) {
+                // SLL无法确定时未必是真正的语法错误，用LL重新解析一次
+                info("SLL parse failed, retrying with full LL prediction");
+                m_fallback = true;
+                m_tokens.seek(0);
+                m_parser.reset();
+                m_parser.addErrorListener(&antlr4::ConsoleErrorListener::INSTANCE);
+            }
+        }
+        m_parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+        interpreter->setPredictionMode(antlr4::atn::PredictionMode::LL);
+        m_tree = m_parser.compilationUnit();
+        return m_tree;
+    }
+}// namespace ststgen
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include "CBaseVisitor.h"
+#include "CLexer.h"
+
+namespace ststgen {
+
+    /// @brief 约束文件的ANTLR前端
+    ///
+    /// 先用SLL预测模式并在首个语法错误处放弃，只有失败时才回退到完整的LL模式重新解析。
+    /// 约束文件几乎总能在SLL下正确解析，这样避免了LL模式下昂贵的全上下文预测。
+    /// 解析得到的树只读，可被多个线程的CConstraintVisitor共享。
+    class ConstraintFrontend {
+    public:
+        explicit ConstraintFrontend(const std::string &src);
+        ConstraintFrontend(const ConstraintFrontend &) = delete;
+        ConstraintFrontend &operator=(const ConstraintFrontend &) = delete;
+
+        /// @param sll_first 为false时直接使用LL模式，用于对比测试
+        antlr4::tree::ParseTree *parse(bool sll_first = true);
+        /// @brief SLL解析失败并回退到了LL
+        bool used_fallback() const {
+            return m_fallback;
+        }
+
+    private:
+        antlr4::ANTLRInputStream m_input;
+        c11parser::CLexer m_lexer;
+        antlr4::CommonTokenStream m_tokens;
+        c11parser::CParser m_parser;
+        antlr4::tree::ParseTree *m_tree = nullptr;
+        bool m_fallback = false;
+    };
+}// namespace ststgen
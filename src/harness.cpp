@@ -0,0 +1,474 @@
+#include "harness.hpp"
+#include "sparse_array.hpp"
+#include "utils.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define STSTGEN_HARNESS_POSIX 1
+#include <dlfcn.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace ststgen {
+
+    namespace {
+        // 整数类参数与浮点类参数在x86-64 SysV和AArch64上分别使用独立的寄存器组，
+        // 因此用固定的原型调用即可把参数送到被测函数期望的位置
+        constexpr size_t MAX_INT_ARGS = 6;
+        constexpr size_t MAX_FLOAT_ARGS = 8;
+        constexpr size_t ALT_STACK_SIZE = 1 << 16;
+
+        // 浮点参数寄存器的内容：float只占低32位(x86-64 SysV与AAPCS64都是如此)，
+        // 以这样的位模式作为double传入，被测函数按float读到的就是原值
+        template<typename T>
+        uint64_t register_image(T v) {
+            static_assert(sizeof(T) <= sizeof(uint64_t));
+            uint64_t bits = 0;
+            std::memcpy(&bits, &v, sizeof(v));
+            return bits;
+        }
+
+        size_t scalar_size(SymbolTableEntryType type) {
+            switch (type) {
+                case SymbolTableEntryType::Int32:
+                case SymbolTableEntryType::UInt32:
+                case SymbolTableEntryType::Float32:
+                    return 4;
+                case SymbolTableEntryType::Int64:
+                case SymbolTableEntryType::UInt64:
+                case SymbolTableEntryType::Float64:
+                    return 8;
+                default:
+                    unreachable();
+            }
+        }
+
+        /// @brief AFL式的命中次数分档：1,2,3,4-7,8-15,16-31,32-127,128+
+        uint8_t count_class(uint8_t count) {
+            if (count <= 3) {
+                return static_cast<uint8_t>(1u << (count - 1));
+            }
+            if (count <= 7) {
+                return 8;
+            }
+            if (count <= 15) {
+                return 16;
+            }
+            if (count <= 31) {
+                return 32;
+            }
+            if (count <= 127) {
+                return 64;
+            }
+            return 128;
+        }
+
+        size_t align_up(size_t v, size_t align) {
+            return (v + align - 1) / align * align;
+        }
+
+        size_t element_count(const std::vector<int> &dims) {
+            size_t n = 1;
+            for (auto d: dims) {
+                n *= d;
+            }
+            return n;
+        }
+
+        struct StructLayout {
+            size_t size = 0;
+            size_t align = 1;
+            // 与m_member_order一一对应
+            std::vector<size_t> offsets{};
+        };
+
+        StructLayout struct_layout(const StructBlueprint &blueprint) {
+            StructLayout layout{};
+            size_t cur = 0;
+            for (const auto &name: blueprint.m_member_order) {
+                const auto &member = blueprint.m_members.at(name);
+                size_t size = 0, align = 0;
+                if (member.qualifer == SymbolTableEntryQualifer::Pointer) {
+                    size = sizeof(void *);
+                    align = alignof(void *);
+                } else {
+                    align = scalar_size(member.type);
+                    size = align;
+                    if (member.qualifer == SymbolTableEntryQualifer::Array) {
+                        size *= element_count(member.dims);
+                    }
+                }
+                cur = align_up(cur, align);
+                layout.offsets.push_back(cur);
+                cur += size;
+                layout.align = std::max(layout.align, align);
+            }
+            layout.size = align_up(cur, layout.align);
+            return layout;
+        }
+
+        void write_scalar(std::byte *dst, SymbolTableEntryType type, const json &v) {
+            switch (type) {
+                case SymbolTableEntryType::Int32: {
+                    auto x = static_cast<int32_t>(v.get<int64_t>());
+                    std::memcpy(dst, &x, sizeof(x));
+                    break;
+                }
+                case SymbolTableEntryType::UInt32: {
+                    auto x = static_cast<uint32_t>(v.get<int64_t>());
+                    std::memcpy(dst, &x, sizeof(x));
+                    break;
+                }
+                case SymbolTableEntryType::Int64: {
+                    auto x = v.get<int64_t>();
+                    std::memcpy(dst, &x, sizeof(x));
+                    break;
+                }
+                case SymbolTableEntryType::UInt64: {
+                    auto x = v.is_number_unsigned() ? v.get<uint64_t>() : static_cast<uint64_t>(v.get<int64_t>());
+                    std::memcpy(dst, &x, sizeof(x));
+                    break;
+                }
+                case SymbolTableEntryType::Float32: {
+                    auto x = v.get<float>();
+                    std::memcpy(dst, &x, sizeof(x));
+                    break;
+                }
+                case SymbolTableEntryType::Float64: {
+                    auto x = v.get<double>();
+                    std::memcpy(dst, &x, sizeof(x));
+                    break;
+                }
+                default:
+                    unreachable();
+            }
+        }
+
+#ifdef STSTGEN_HARNESS_POSIX
+        sigjmp_buf g_harness_jmp;
+        std::atomic<bool> g_in_call{false};
+        pthread_t g_calling_thread;
+        const int HARNESS_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGALRM};
+
+        void harness_signal_handler(int sig) {
+            if (g_in_call.load() && pthread_equal(pthread_self(), g_calling_thread)) {
+                siglongjmp(g_harness_jmp, sig);
+            }
+            if (g_in_call.load() && sig == SIGALRM) {
+                // the process-wide timer fired on another worker
+                pthread_kill(g_calling_thread, SIGALRM);
+                return;
+            }
+            signal(sig, SIG_DFL);
+            raise(sig);
+        }
+
+        void install_alt_stack() {
+            // 栈溢出时仍能进入信号处理函数
+            thread_local std::unique_ptr<char[]> alt_stack{};
+            if (alt_stack) {
+                return;
+            }
+            alt_stack = std::make_unique<char[]>(ALT_STACK_SIZE);
+            stack_t ss{};
+            ss.ss_sp = alt_stack.get();
+            ss.ss_size = ALT_STACK_SIZE;
+            ss.ss_flags = 0;
+            sigaltstack(&ss, nullptr);
+        }
+
+        void arm_timer(unsigned timeout_ms) {
+            itimerval t{};
+            t.it_value.tv_sec = timeout_ms / 1000;
+            t.it_value.tv_usec = (timeout_ms % 1000) * 1000;
+            setitimer(ITIMER_REAL, &t, nullptr);
+        }
+#endif
+    }// namespace
+
+    Harness::Harness(Options opts) : m_opts(std::move(opts)) {
+#ifdef STSTGEN_HARNESS_POSIX
+        m_handle = dlopen(m_opts.library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (m_handle == nullptr) {
+            panic(fmt::format("dlopen {} failed: {}", m_opts.library, dlerror()));
+        }
+        m_target = dlsym(m_handle, m_opts.symbol.c_str());
+        if (m_target == nullptr) {
+            panic(fmt::format("symbol {} not found in {}", m_opts.symbol, m_opts.library));
+        }
+        if (m_opts.coverage) {
+            auto **map = static_cast<uint8_t **>(dlsym(m_handle, "__ststgen_cov_map"));
+            const auto *size = static_cast<const uint32_t *>(dlsym(m_handle, "__ststgen_cov_map_size"));
+            if (map == nullptr || size == nullptr) {
+                panic(fmt::format("{} is not linked with coverage_rt.c", m_opts.library));
+            }
+            // MAP_SHARED使fork出的子进程写入的计数对父进程可见
+            void *shm = mmap(nullptr, *size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (shm == MAP_FAILED) {
+                panic(fmt::format("mmap coverage map failed: {}", std::strerror(errno)));
+            }
+            m_cov_map = static_cast<uint8_t *>(shm);
+            m_cov_size = *size;
+            m_virgin.assign(m_cov_size, 0);
+            *map = m_cov_map;
+        }
+        if (!m_opts.fork_server) {
+            struct sigaction sa{};
+            sa.sa_handler = harness_signal_handler;
+            sa.sa_flags = SA_ONSTACK;
+            sigemptyset(&sa.sa_mask);
+            for (auto sig: HARNESS_SIGNALS) {
+                sigaction(sig, &sa, nullptr);
+            }
+        }
+        if (!m_opts.report.empty()) {
+            // truncate the report of the previous run
+            std::ofstream ofs(m_opts.report, std::ios::trunc);
+        }
+#else
+        panic("in-process harness requires a POSIX platform.");
+#endif
+    }
+
+    Harness::~Harness() {
+#ifdef STSTGEN_HARNESS_POSIX
+        if (m_cov_map != nullptr) {
+            munmap(m_cov_map, m_cov_size);
+        }
+        if (m_handle != nullptr) {
+            dlclose(m_handle);
+        }
+#endif
+    }
+
+    const char *Harness::status_name(Status status) {
+        switch (status) {
+            case Status::Ok:
+                return "ok";
+            case Status::Crash:
+                return "crash";
+            case Status::Timeout:
+                return "timeout";
+        }
+        unreachable();
+    }
+
+    void Harness::marshal(const json &single_case,
+                          const std::vector<std::pair<std::string, SymbolTableEntry>> &params,
+                          const std::unordered_map<std::string, StructBlueprint> &blueprints,
+                          CallFrame &frame) const {
+        auto alloc = [&frame](size_t size) {
+            // operator new[] 的对齐足够任何标量和结构体
+            frame.buffers.push_back(std::make_unique<std::byte[]>(std::max<size_t>(size, 1)));
+            return frame.buffers.back().get();
+        };
+        std::function<void(std::byte *, const SymbolTableEntry &, const json &)> write_value;
+        auto write_elements = [&](std::byte *dst, const SymbolTableEntry &entry, size_t elem_size, const json &arr, size_t capacity) {
+            // 多维数组按行优先展开
+            std::function<void(const json &)> rec = [&](const json &v) {
+                if (v.is_array()) {
+                    for (const auto &e: v) {
+                        rec(e);
+                    }
+                    return;
+                }
+                if (capacity == 0) {
+                    panic("case does not match the declared array shape.");
+                }
+                write_value(dst, entry, v);
+                dst += elem_size;
+                capacity--;
+            };
+            rec(arr);
+        };
+        write_value = [&](std::byte *dst, const SymbolTableEntry &entry, const json &v) {
+            if (entry.type != SymbolTableEntryType::Struct) {
+                write_scalar(dst, entry.type, v);
+                return;
+            }
+            const auto &blueprint = blueprints.at(entry.struct_name);
+            auto layout = struct_layout(blueprint);
+            for (size_t i = 0; i < blueprint.m_member_order.size(); ++i) {
+                const auto &name = blueprint.m_member_order[i];
+                const auto &member = blueprint.m_members.at(name);
+                auto *field = dst + layout.offsets[i];
+                if (member.qualifer == SymbolTableEntryQualifer::Primary) {
+                    write_scalar(field, member.type, v.at(name));
+                } else if (member.qualifer == SymbolTableEntryQualifer::Array) {
+                    write_elements(field, member, scalar_size(member.type), v.at(name), element_count(member.dims));
+                } else {
+                    const auto &arr = v.at(name);
+                    auto elem_size = scalar_size(member.type);
+                    auto *buf = alloc(arr.size() * elem_size);
+                    write_elements(buf, member, elem_size, arr, arr.size());
+                    std::memcpy(field, &buf, sizeof(buf));
+                }
+            }
+        };
+        auto value_size = [&](const SymbolTableEntry &entry) {
+            if (entry.type == SymbolTableEntryType::Struct) {
+                return struct_layout(blueprints.at(entry.struct_name)).size;
+            }
+            return scalar_size(entry.type);
+        };
+
+        for (const auto &[name, entry]: params) {
+            const auto &v = single_case.at(name);
+            if (entry.qualifer == SymbolTableEntryQualifer::Primary) {
+                if (entry.type == SymbolTableEntryType::Struct) {
+                    auto *buf = alloc(value_size(entry));
+                    write_value(buf, entry, v);
+                    frame.int_args.push_back(reinterpret_cast<long>(buf));
+                } else if (entry.type == SymbolTableEntryType::Float32) {
+                    frame.float_args.push_back(register_image(v.get<float>()));
+                } else if (entry.type == SymbolTableEntryType::Float64) {
+                    frame.float_args.push_back(register_image(v.get<double>()));
+                } else if (entry.type == SymbolTableEntryType::UInt32) {
+                    frame.int_args.push_back(static_cast<long>(static_cast<uint32_t>(v.get<int64_t>())));
+                } else if (entry.type == SymbolTableEntryType::Int32) {
+                    frame.int_args.push_back(static_cast<int32_t>(v.get<int64_t>()));
+                } else {
+                    frame.int_args.push_back(v.is_number_unsigned() ? static_cast<long>(v.get<uint64_t>()) : v.get<int64_t>());
+                }
+            } else if (entry.qualifer == SymbolTableEntryQualifer::Array) {
+                auto elem_size = value_size(entry);
+                auto *buf = alloc(element_count(entry.dims) * elem_size);
+                if (SparseArray::is_sparse(v)) {
+                    SparseArray(v, entry.dims, entry.type).fill(0, element_count(entry.dims), buf);
+                } else {
+                    write_elements(buf, entry, elem_size, v, element_count(entry.dims));
+                }
+                frame.int_args.push_back(reinterpret_cast<long>(buf));
+            } else if (entry.qualifer == SymbolTableEntryQualifer::Pointer) {
+                auto elem_size = value_size(entry);
+                auto *buf = alloc(v.size() * elem_size);
+                write_elements(buf, entry, elem_size, v, v.size());
+                frame.int_args.push_back(reinterpret_cast<long>(buf));
+                frame.int_args.push_back(static_cast<long>(v.size()));
+            }
+        }
+        if (frame.int_args.size() > MAX_INT_ARGS || frame.float_args.size() > MAX_FLOAT_ARGS) {
+            panic("too many parameters for the harness calling convention.");
+        }
+    }
+
+    void Harness::call_target(const CallFrame &frame) const {
+#if defined(__x86_64__) || defined(__aarch64__)
+        using Entry = void (*)(long, long, long, long, long, long,
+                               double, double, double, double, double, double, double, double);
+        long i[MAX_INT_ARGS] = {};
+        double d[MAX_FLOAT_ARGS] = {};
+        std::copy(frame.int_args.begin(), frame.int_args.end(), i);
+        // 按位复制，不经过数值转换
+        std::memcpy(d, frame.float_args.data(), frame.float_args.size() * sizeof(double));
+        reinterpret_cast<Entry>(m_target)(i[0], i[1], i[2], i[3], i[4], i[5],
+                                          d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+#else
+        panic("harness calling convention is only implemented for x86-64 and AArch64.");
+#endif
+    }
+
+    Harness::Result Harness::invoke_in_process(const CallFrame &frame) {
+        Result result{};
+#ifdef STSTGEN_HARNESS_POSIX
+        std::lock_guard<std::mutex> lock(m_call_mutex);
+        install_alt_stack();
+        g_calling_thread = pthread_self();
+        int sig = sigsetjmp(g_harness_jmp, 1);
+        if (sig == 0) {
+            g_in_call.store(true);
+            arm_timer(m_opts.timeout_ms);
+            call_target(frame);
+        } else {
+            result.status = sig == SIGALRM ? Status::Timeout : Status::Crash;
+            result.signal = sig;
+        }
+        arm_timer(0);
+        g_in_call.store(false);
+#endif
+        return result;
+    }
+
+    Harness::Result Harness::invoke_forked(const CallFrame &frame) {
+        Result result{};
+#ifdef STSTGEN_HARNESS_POSIX
+        pid_t pid = fork();
+        if (pid < 0) {
+            panic(fmt::format("fork failed: {}", std::strerror(errno)));
+        }
+        if (pid == 0) {
+            // SIGALRM的默认动作直接终止子进程，即为超时
+            signal(SIGALRM, SIG_DFL);
+            arm_timer(m_opts.timeout_ms);
+            call_target(frame);
+            _exit(0);
+        }
+        int wstatus = 0;
+        while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) {}
+        if (WIFSIGNALED(wstatus)) {
+            result.signal = WTERMSIG(wstatus);
+            result.status = result.signal == SIGALRM ? Status::Timeout : Status::Crash;
+        } else if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) != 0) {
+            result.status = Status::Crash;
+        }
+#endif
+        return result;
+    }
+
+    Harness::Result Harness::run(const json &single_case,
+                                 const std::vector<std::pair<std::string, SymbolTableEntry>> &params,
+                                 const std::unordered_map<std::string, StructBlueprint> &blueprints) {
+        CallFrame frame{};
+        marshal(single_case, params, blueprints, frame);
+        if (has_coverage()) {
+            std::lock_guard<std::mutex> lock(m_coverage_mutex);
+            std::memset(m_cov_map, 0, m_cov_size);
+            auto result = m_opts.fork_server ? invoke_forked(frame) : invoke_in_process(frame);
+            result.new_edges = merge_coverage();
+            return result;
+        }
+        if (m_opts.fork_server) {
+            return invoke_forked(frame);
+        }
+        return invoke_in_process(frame);
+    }
+
+    uint32_t Harness::merge_coverage() {
+        uint32_t fresh = 0;
+        for (size_t i = 0; i < m_cov_size; ++i) {
+            if (m_cov_map[i] == 0) {
+                continue;
+            }
+            const auto cls = count_class(m_cov_map[i]);
+            if ((m_virgin[i] & cls) == 0) {
+                if (m_virgin[i] == 0) {
+                    m_edges++;
+                }
+                m_virgin[i] |= cls;
+                fresh++;
+            }
+        }
+        return fresh;
+    }
+
+    void Harness::record(const std::string &case_name, const Result &result) {
+        if (m_opts.report.empty()) {
+            return;
+        }
+        auto line = json{{"case", case_name}, {"status", status_name(result.status)}, {"signal", result.signal}};
+        std::lock_guard<std::mutex> lock(m_report_mutex);
+        std::ofstream ofs(m_opts.report, std::ios::app);
+        ofs << line.dump() << '\n';
+    }
+}// namespace ststgen
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "parser.hpp"
+
+namespace ststgen {
+
+    /// @brief 在进程内直接调用被测函数
+    ///
+    /// 被测函数从用户的共享库中以dlopen/dlsym获得，参数按约束文件中全局变量的声明顺序传递：
+    /// - 标量(int/long/unsigned/float/double)按值传递
+    /// - 数组、结构体变量按指针传递，内存布局与C一致
+    /// - 指针变量传递为(buffer, length)两个参数，length为long
+    /// 例如约束文件声明了 `int a; int b[3]; S1 s[2]; int *p;`，
+    /// 被测函数应为 `void target(int a, int *b, S1 *s, int *p, long p_len);`
+    ///
+    /// 默认在调用线程中直接调用，以SIGALRM实现超时。ITIMER_REAL是整个进程共用的，
+    /// 因此各线程的调用串行化，且调用期间进程中的其他代码不能再使用ITIMER_REAL/SIGALRM。
+    /// fork_server模式下每次调用从多线程的生成器进程fork出子进程，子进程中只有调用线程，
+    /// 其他线程持有的锁不会被释放：被测函数应只依赖fork安全的设施(glibc的malloc可以)。
+    class Harness {
+    public:
+        enum class Status {
+            Ok,
+            Crash,
+            Timeout,
+        };
+        struct Result {
+            Status status = Status::Ok;
+            int signal = 0;
+            // 覆盖反馈模式下，本次调用首次命中的(边, 命中次数档位)数
+            uint32_t new_edges = 0;
+        };
+        struct Options {
+            std::string library{};
+            std::string symbol{};
+            unsigned timeout_ms = 1000;
+            // run each case in a child forked from the already-initialised process
+            bool fork_server = false;
+            // 被测库链接了coverage_rt.c，每次调用后读取覆盖位图
+            bool coverage = false;
+            std::filesystem::path report{};
+        };
+
+        explicit Harness(Options opts);
+        ~Harness();
+        Harness(const Harness &) = delete;
+        Harness &operator=(const Harness &) = delete;
+
+        /// @brief 将一个用例编组为C类型并调用被测函数
+        Result run(const json &single_case,
+                   const std::vector<std::pair<std::string, SymbolTableEntry>> &params,
+                   const std::unordered_map<std::string, StructBlueprint> &blueprints);
+        /// @brief 记录非正常结束的用例
+        void record(const std::string &case_name, const Result &result);
+
+        static const char *status_name(Status status);
+
+        bool has_coverage() const {
+            return m_cov_map != nullptr;
+        }
+        /// @brief 至今命中过的边数
+        size_t edges_covered() const {
+            return m_edges;
+        }
+
+    private:
+        // 参数编组结果，整数类与浮点类参数分别按寄存器顺序排列
+        struct CallFrame {
+            std::vector<long> int_args{};
+            // 浮点寄存器的位模式，float与double的宽度不同，见register_image
+            std::vector<uint64_t> float_args{};
+            std::vector<std::unique_ptr<std::byte[]>> buffers{};
+        };
+        void marshal(const json &single_case,
+                     const std::vector<std::pair<std::string, SymbolTableEntry>> &params,
+                     const std::unordered_map<std::string, StructBlueprint> &blueprints,
+                     CallFrame &frame) const;
+        Result invoke_in_process(const CallFrame &frame);
+        Result invoke_forked(const CallFrame &frame);
+        void call_target(const CallFrame &frame) const;
+        /// @brief 把位图并入已见覆盖，返回新出现的(边, 档位)数
+        uint32_t merge_coverage();
+
+        Options m_opts;
+        void *m_handle = nullptr;
+        void *m_target = nullptr;
+        // 被测函数不一定可重入，调用串行化
+        std::mutex m_call_mutex{};
+        std::mutex m_report_mutex{};
+        // 与fork子进程共享的覆盖位图，及按AFL方式分档后已见过的档位
+        uint8_t *m_cov_map = nullptr;
+        size_t m_cov_size = 0;
+        std::vector<uint8_t> m_virgin{};
+        size_t m_edges = 0;
+        // 位图是全局的，覆盖模式下调用(包括fork)串行化
+        std::mutex m_coverage_mutex{};
+    };
+}// namespace ststgen
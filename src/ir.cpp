@@ -0,0 +1,395 @@
+#include "ir.hpp"
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ststgen::ir {
+
+    namespace {
+        size_t hash_combine(size_t seed, uint64_t v) {
+            return seed ^ (std::hash<uint64_t>{}(v) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+        }
+
+        const char *op_text(Op op) {
+            switch (op) {
+                case Op::Neg:
+                    return "-";
+                case Op::Not:
+                    return "!";
+                case Op::Add:
+                    return "+";
+                case Op::Sub:
+                    return "-";
+                case Op::Mul:
+                    return "*";
+                case Op::Div:
+                    return "/";
+                case Op::Mod:
+                    return "%";
+                case Op::Lt:
+                    return "<";
+                case Op::Le:
+                    return "<=";
+                case Op::Gt:
+                    return ">";
+                case Op::Ge:
+                    return ">=";
+                case Op::Eq:
+                    return "==";
+                case Op::Ne:
+                    return "!=";
+                case Op::And:
+                    return "&&";
+                case Op::Or:
+                    return "||";
+                case Op::Seq:
+                    return ",";
+                case Op::Shl:
+                    return "<<";
+                case Op::Shr:
+                    return ">>";
+                case Op::BitAnd:
+                    return "&";
+                case Op::BitOr:
+                    return "|";
+                case Op::BitXor:
+                    return "^";
+                case Op::BitNot:
+                    return "~";
+                default:
+                    return "?";
+            }
+        }
+    }// namespace
+
+    uint32_t Arena::intern_name(std::string_view name) {
+        auto [it, inserted] = m_name_ids.try_emplace(std::string(name), static_cast<uint32_t>(m_names.size()));
+        if (inserted) {
+            m_names.emplace_back(name);
+        }
+        return it->second;
+    }
+
+    NodeId Arena::intern(Op op, uint32_t name, uint64_t payload, const NodeId *args, size_t n) {
+        size_t h = hash_combine(static_cast<size_t>(op), name);
+        h = hash_combine(h, payload);
+        for (size_t i = 0; i < n; ++i) {
+            h = hash_combine(h, args[i]);
+        }
+        auto [begin, end] = m_index.equal_range(h);
+        for (auto it = begin; it != end; ++it) {
+            const auto &cand = m_nodes[it->second];
+            if (cand.op == op && cand.name == name && cand.payload == payload && cand.arg_count == n &&
+                std::equal(args, args + n, m_args.begin() + cand.arg_begin)) {
+                return it->second;
+            }
+        }
+        Node node{op, name, static_cast<uint32_t>(m_args.size()), static_cast<uint32_t>(n), payload};
+        m_args.insert(m_args.end(), args, args + n);
+        m_nodes.push_back(node);
+        auto id = static_cast<NodeId>(m_nodes.size() - 1);
+        m_index.emplace(h, id);
+        return id;
+    }
+
+    NodeId Arena::var(std::string_view name) {
+        return intern(Op::Var, intern_name(name), 0, nullptr, 0);
+    }
+
+    NodeId Arena::int_const(int64_t v) {
+        uint64_t payload{};
+        std::memcpy(&payload, &v, sizeof(v));
+        return intern(Op::ConstInt, 0, payload, nullptr, 0);
+    }
+
+    NodeId Arena::real_const(double v) {
+        uint64_t payload{};
+        std::memcpy(&payload, &v, sizeof(v));
+        return intern(Op::ConstReal, 0, payload, nullptr, 0);
+    }
+
+    NodeId Arena::field(NodeId base, std::string_view name) {
+        return intern(Op::Field, intern_name(name), 0, &base, 1);
+    }
+
+    NodeId Arena::make(Op op, std::initializer_list<NodeId> args) {
+        return intern(op, 0, 0, args.begin(), args.size());
+    }
+
+    NodeId Arena::make(Op op, const std::vector<NodeId> &args) {
+        return intern(op, 0, 0, args.data(), args.size());
+    }
+
+    int64_t Arena::int_value(NodeId id) const {
+        stst_assert(op(id) == Op::ConstInt);
+        int64_t v{};
+        std::memcpy(&v, &m_nodes[id].payload, sizeof(v));
+        return v;
+    }
+
+    double Arena::real_value(NodeId id) const {
+        if (op(id) == Op::ConstInt) {
+            return static_cast<double>(int_value(id));
+        }
+        stst_assert(op(id) == Op::ConstReal);
+        double v{};
+        std::memcpy(&v, &m_nodes[id].payload, sizeof(v));
+        return v;
+    }
+
+    std::optional<LinearTerm> Arena::linear(NodeId id) const {
+        const auto o = op(id);
+        if (o == Op::ConstInt || o == Op::ConstReal) {
+            return LinearTerm{{}, real_value(id)};
+        }
+        if (is_leaf_term(o)) {
+            return LinearTerm{{{id, 1.0}}, 0.0};
+        }
+        auto scale = [](LinearTerm t, double k) {
+            for (auto &[_, c]: t.coeffs) {
+                c *= k;
+            }
+            t.constant *= k;
+            return t;
+        };
+        if (o == Op::Neg) {
+            auto t = linear(arg(id, 0));
+            return t ? std::optional{scale(std::move(*t), -1.0)} : std::nullopt;
+        }
+        if (o != Op::Add && o != Op::Sub && o != Op::Mul) {
+            return std::nullopt;
+        }
+        auto lhs = linear(arg(id, 0));
+        auto rhs = linear(arg(id, 1));
+        if (!lhs || !rhs) {
+            return std::nullopt;
+        }
+        if (o == Op::Mul) {
+            if (lhs->coeffs.empty()) {
+                return scale(std::move(*rhs), lhs->constant);
+            }
+            if (rhs->coeffs.empty()) {
+                return scale(std::move(*lhs), rhs->constant);
+            }
+            return std::nullopt;
+        }
+        const double sign = o == Op::Add ? 1.0 : -1.0;
+        for (const auto &[v, c]: rhs->coeffs) {
+            if ((lhs->coeffs[v] += sign * c) == 0.0) {
+                lhs->coeffs.erase(v);
+            }
+        }
+        lhs->constant += sign * rhs->constant;
+        return lhs;
+    }
+
+    std::string Arena::to_string(NodeId id) const {
+        switch (op(id)) {
+            case Op::Var:
+                return name(id);
+            case Op::ConstInt:
+                return std::to_string(int_value(id));
+            case Op::ConstReal: {
+                auto s = fmt::format("{}", real_value(id));
+                if (s.find_first_of(".eni") == std::string::npos) {
+                    s += ".0";
+                }
+                return s;
+            }
+            case Op::Index:
+                return to_string(arg(id, 0)) + "[" + to_string(arg(id, 1)) + "]";
+            case Op::Field:
+                return to_string(arg(id, 0)) + "." + name(id);
+            case Op::Length:
+                return "_LENGTH(" + to_string(arg(id, 0)) + ")";
+            case Op::Gaussian:
+                return "GAUSSIAN(" + to_string(arg(id, 0)) + ", " + to_string(arg(id, 1)) + ", " + to_string(arg(id, 2)) + ")";
+            case Op::Neg:
+            case Op::Not:
+            case Op::BitNot:
+                return std::string(op_text(op(id))) + "(" + to_string(arg(id, 0)) + ")";
+            case Op::Cond:
+                return "(" + to_string(arg(id, 0)) + " ? " + to_string(arg(id, 1)) + " : " + to_string(arg(id, 2)) + ")";
+            default: {
+                std::string ret = "(";
+                for (uint32_t i = 0; i < num_args(id); ++i) {
+                    if (i != 0) {
+                        ret += " ";
+                        ret += op_text(op(id));
+                        ret += " ";
+                    }
+                    ret += to_string(arg(id, i));
+                }
+                return ret + ")";
+            }
+        }
+    }
+
+    namespace {
+        constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+        /// @brief JS中的值：数组/对象保存引用，数值与布尔统一为double
+        struct Value {
+            const nlohmann::json *ref = nullptr;
+            double num = NaN;
+        };
+
+        bool truthy(const Value &v) {
+            if (v.ref != nullptr && (v.ref->is_array() || v.ref->is_object())) {
+                return true;
+            }
+            return v.num != 0.0 && !std::isnan(v.num);
+        }
+
+        /// @brief JS的ToInt32
+        int32_t to_int32(double v) {
+            if (!std::isfinite(v)) {
+                return 0;
+            }
+            const double m = std::fmod(std::trunc(v), 4294967296.0);
+            return static_cast<int32_t>(static_cast<uint32_t>(static_cast<int64_t>(m < 0 ? m + 4294967296.0 : m)));
+        }
+
+        Value of_bool(bool b) {
+            return Value{nullptr, b ? 1.0 : 0.0};
+        }
+
+        Value of_json(const nlohmann::json *j) {
+            if (j == nullptr) {
+                return Value{};
+            }
+            if (j->is_number()) {
+                return Value{j, j->get<double>()};
+            }
+            if (j->is_boolean()) {
+                return Value{j, j->get<bool>() ? 1.0 : 0.0};
+            }
+            return Value{j, NaN};
+        }
+
+        Value eval(const Arena &a, NodeId id, const nlohmann::json &env) {
+            switch (a.op(id)) {
+                case Op::Var: {
+                    auto it = env.find(a.name(id));
+                    return it == env.end() ? Value{} : of_json(&*it);
+                }
+                case Op::ConstInt:
+                case Op::ConstReal:
+                    return Value{nullptr, a.real_value(id)};
+                case Op::Index: {
+                    auto base = eval(a, a.arg(id, 0), env);
+                    auto idx = eval(a, a.arg(id, 1), env).num;
+                    if (base.ref != nullptr && base.ref->is_object() && idx >= 0 && idx == std::floor(idx)) {
+                        // 稀疏数组以下标字符串为键，与JS中obj[i]一致
+                        auto it = base.ref->find(std::to_string(static_cast<size_t>(idx)));
+                        return it == base.ref->end() ? Value{} : of_json(&*it);
+                    }
+                    if (base.ref == nullptr || !base.ref->is_array() || !(idx >= 0) || idx != std::floor(idx) || idx >= base.ref->size()) {
+                        return Value{};
+                    }
+                    return of_json(&(*base.ref)[static_cast<size_t>(idx)]);
+                }
+                case Op::Field: {
+                    auto base = eval(a, a.arg(id, 0), env);
+                    if (base.ref == nullptr || !base.ref->is_object()) {
+                        return Value{};
+                    }
+                    auto it = base.ref->find(a.name(id));
+                    return it == base.ref->end() ? Value{} : of_json(&*it);
+                }
+                case Op::Length: {
+                    auto base = eval(a, a.arg(id, 0), env);
+                    if (base.ref != nullptr && base.ref->is_object()) {
+                        auto it = base.ref->find("length");
+                        return it == base.ref->end() ? Value{} : of_json(&*it);
+                    }
+                    if (base.ref == nullptr || !base.ref->is_array()) {
+                        return Value{};
+                    }
+                    return Value{nullptr, static_cast<double>(base.ref->size())};
+                }
+                case Op::Gaussian:
+                    return of_bool(true);
+                case Op::Neg:
+                    return Value{nullptr, -eval(a, a.arg(id, 0), env).num};
+                case Op::Not:
+                    return of_bool(!truthy(eval(a, a.arg(id, 0), env)));
+                case Op::BitNot:
+                    return Value{nullptr, static_cast<double>(~to_int32(eval(a, a.arg(id, 0), env).num))};
+                case Op::And:
+                    for (uint32_t i = 0; i < a.num_args(id); ++i) {
+                        if (!truthy(eval(a, a.arg(id, i), env))) {
+                            return of_bool(false);
+                        }
+                    }
+                    return of_bool(true);
+                case Op::Or:
+                    for (uint32_t i = 0; i < a.num_args(id); ++i) {
+                        if (truthy(eval(a, a.arg(id, i), env))) {
+                            return of_bool(true);
+                        }
+                    }
+                    return of_bool(false);
+                case Op::Cond:
+                    return truthy(eval(a, a.arg(id, 0), env)) ? eval(a, a.arg(id, 1), env) : eval(a, a.arg(id, 2), env);
+                case Op::Seq: {
+                    Value last{};
+                    for (uint32_t i = 0; i < a.num_args(id); ++i) {
+                        last = eval(a, a.arg(id, i), env);
+                    }
+                    return last;
+                }
+                default:
+                    break;
+            }
+            const double l = eval(a, a.arg(id, 0), env).num;
+            const double r = eval(a, a.arg(id, 1), env).num;
+            switch (a.op(id)) {
+                case Op::Add:
+                    return Value{nullptr, l + r};
+                case Op::Sub:
+                    return Value{nullptr, l - r};
+                case Op::Mul:
+                    return Value{nullptr, l * r};
+                case Op::Div:
+                    return Value{nullptr, l / r};
+                case Op::Mod:
+                    return Value{nullptr, std::fmod(l, r)};
+                case Op::Lt:
+                    return of_bool(l < r);
+                case Op::Le:
+                    return of_bool(l <= r);
+                case Op::Gt:
+                    return of_bool(l > r);
+                case Op::Ge:
+                    return of_bool(l >= r);
+                case Op::Eq:
+                    return of_bool(l == r);
+                case Op::Ne:
+                    return of_bool(l != r);
+                case Op::Shl:
+                    return Value{nullptr, static_cast<double>(static_cast<int32_t>(static_cast<uint32_t>(to_int32(l)) << (static_cast<uint32_t>(to_int32(r)) & 31)))};
+                case Op::Shr:
+                    return Value{nullptr, static_cast<double>(to_int32(l) >> (static_cast<uint32_t>(to_int32(r)) & 31))};
+                case Op::BitAnd:
+                    return Value{nullptr, static_cast<double>(to_int32(l) & to_int32(r))};
+                case Op::BitOr:
+                    return Value{nullptr, static_cast<double>(to_int32(l) | to_int32(r))};
+                case Op::BitXor:
+                    return Value{nullptr, static_cast<double>(to_int32(l) ^ to_int32(r))};
+                default:
+                    unreachable();
+            }
+        }
+    }// namespace
+
+    bool evaluate(const Arena &arena, NodeId root, const nlohmann::json &env) {
+        return truthy(eval(arena, root, env));
+    }
+
+    double evaluate_number(const Arena &arena, NodeId root, const nlohmann::json &env) {
+        return eval(arena, root, env).num;
+    }
+}// namespace ststgen::ir
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace ststgen::ir {
+
+    /// @brief 约束IR的运算
+    enum class Op : uint8_t {
+        Var,      // name
+        ConstInt, // payload为int64
+        ConstReal,// payload为double
+        Index,    // a[i]
+        Field,    // a.name
+        Length,   // _LENGTH(a)
+        Gaussian, // GAUSSIAN(v, mu, sigma)
+        Neg,
+        Not,
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Lt,
+        Le,
+        Gt,
+        Ge,
+        Eq,
+        Ne,
+        And,// n元
+        Or, // n元
+        Cond,// c ? a : b
+        Seq, // 逗号表达式，值为最后一项
+        // 位运算，只在位向量模式下能生成z3约束
+        Shl,
+        Shr,
+        BitAnd,
+        BitOr,
+        BitXor,
+        BitNot,
+    };
+
+    using NodeId = uint32_t;
+    constexpr NodeId NONE = UINT32_MAX;
+
+    /// @brief 节点本身不持有子节点，子节点在Arena::m_args中连续存放
+    struct Node {
+        Op op;
+        uint32_t name = 0;
+        uint32_t arg_begin = 0;
+        uint32_t arg_count = 0;
+        uint64_t payload = 0;
+    };
+
+    /// @brief 线性项 sum(coeffs[v] * v) + constant，v为不可再分解的叶子（变量、下标、成员、长度）
+    struct LinearTerm {
+        std::map<NodeId, double> coeffs{};
+        double constant = 0.0;
+    };
+
+    /// @brief 哈希合并的约束IR，结构相同的子表达式只存一份
+    ///
+    /// 节点、子节点下标与名字都放在连续的vector里，NodeId就是下标。
+    /// Arena只增不删，NodeId在其生命周期内稳定，可作为各种分析的数组下标。
+    class Arena {
+    public:
+        NodeId var(std::string_view name);
+        NodeId int_const(int64_t v);
+        NodeId real_const(double v);
+        NodeId field(NodeId base, std::string_view name);
+        NodeId make(Op op, std::initializer_list<NodeId> args);
+        NodeId make(Op op, const std::vector<NodeId> &args);
+
+        const Node &node(NodeId id) const {
+            return m_nodes[id];
+        }
+        Op op(NodeId id) const {
+            return m_nodes[id].op;
+        }
+        NodeId arg(NodeId id, uint32_t i) const {
+            return m_args[m_nodes[id].arg_begin + i];
+        }
+        uint32_t num_args(NodeId id) const {
+            return m_nodes[id].arg_count;
+        }
+        const std::string &name(NodeId id) const {
+            return m_names[m_nodes[id].name];
+        }
+        int64_t int_value(NodeId id) const;
+        double real_value(NodeId id) const;
+        size_t size() const {
+            return m_nodes.size();
+        }
+
+        static bool is_comparison(Op op) {
+            return op >= Op::Lt && op <= Op::Ne;
+        }
+        static bool is_leaf_term(Op op) {
+            return op == Op::Var || op == Op::Index || op == Op::Field || op == Op::Length;
+        }
+
+        /// @brief 分解为线性项，非线性（变量相乘、除法、取模等）时返回nullopt
+        std::optional<LinearTerm> linear(NodeId id) const;
+        /// @brief 转回C语法，与源码中写法一致
+        std::string to_string(NodeId id) const;
+
+    private:
+        NodeId intern(Op op, uint32_t name, uint64_t payload, const NodeId *args, size_t n);
+        uint32_t intern_name(std::string_view name);
+
+        std::vector<Node> m_nodes{};
+        std::vector<NodeId> m_args{};
+        std::vector<std::string> m_names{};
+        std::unordered_map<std::string, uint32_t> m_name_ids{};
+        std::unordered_multimap<size_t, NodeId> m_index{};
+    };
+
+    /// @brief 在一个用例(json)上对约束求值，语义与writeCases中的JS验证一致：
+    /// 数值按double计算，/为实数除法，越界访问得到NaN并使比较为假，位运算先转为int32；
+    /// 对象按下标字符串、length访问，因而稀疏形式的大数组(见SparseArray)也可直接求值
+    bool evaluate(const Arena &arena, NodeId root, const nlohmann::json &env);
+    double evaluate_number(const Arena &arena, NodeId root, const nlohmann::json &env);
+}// namespace ststgen::ir
@@ -1,11 +1,15 @@
 #include "CBaseVisitor.h"
 #include "CLexer.h"
 #include "cmdline.h"
+#include "frontend.hpp"
+#include "harness.hpp"
+#include "manifest.hpp"
 #include "parser.hpp"
 
 #include "utils.hpp"
 #include <filesystem>
 #include <fmt/core.h>
+#include <optional>
 #include <nlohmann/json.hpp>
 #include <z3++.h>
 
@@ -19,39 +23,76 @@
 std::mutex output_buffer_mutex{};
 using PII = std::pair<int, int>;
 
-void core_runner(const std::string &cons_src, const std::string &output, const PII cases, const PII start_case_num, const int thread_i) {
-    antlr4::ANTLRInputStream input_stream(cons_src);
-    c11parser::CLexer lexer(&input_stream);
-    antlr4::CommonTokenStream token_stream(&lexer);
-    c11parser::CParser parser(&token_stream);
-    auto *tree = parser.compilationUnit();
+struct WorkerReport {
+    int thread;
+    bool is_positive;
+    uint64_t seed;
+    ststgen::WorkerMetrics metrics;
+};
+std::vector<WorkerReport> worker_reports{};
+
+void core_runner(antlr4::tree::ParseTree *tree, const std::chrono::nanoseconds parse_time, const std::string &output, const PII cases, const PII start_case_num, const int thread_i, ststgen::Harness *harness, const ststgen::ArrayEncoding array_encoding, const ststgen::PointerEncoding pointer_encoding, const ststgen::StructEncoding struct_encoding, const int max_pointer_len, const bool bitvec, const bool boundary, const std::optional<uint64_t> master_seed, const ststgen::MemoryLimits memory_limits, const ststgen::Incremental incremental) {
+    ststgen::TraceRecorder::instance().set_thread_name(fmt::format("worker {}", thread_i));
+    // the tree is parsed once in main and shared read-only, only the first thread reports it
+    std::chrono::nanoseconds parse_elapsed = thread_i == 1 ? parse_time : std::chrono::nanoseconds{0};
     std::random_device rd;
 
     auto generate_cases = [&](int case_number, int start_i, bool is_positive) {
         auto visitor = ststgen::CConstraintVisitor{case_number, is_positive, start_i};
+        visitor.setHarness(harness);
+        visitor.setArrayEncoding(array_encoding);
+        visitor.setPointerEncoding(pointer_encoding, max_pointer_len);
+        visitor.setStructEncoding(struct_encoding);
+        visitor.setBitvec(bitvec);
+        visitor.setBoundary(boundary);
+        visitor.setMemoryLimits(memory_limits);
+        visitor.setIncremental(incremental);
         auto time_begin = std::chrono::steady_clock::now();
-        visitor.visit(tree);
+        {
+            ststgen::TraceSpan span{"visit", "frontend"};
+            visitor.visit(tree);
+        }
         auto time_parse_cpp = std::chrono::steady_clock::now();
-        unsigned int seed = rd();
-        visitor.setRandomSeed(seed);
-        visitor.mutateEntrance(output);
+        uint64_t seed = 0;
+        if (master_seed) {
+            seed = *master_seed;
+            visitor.setMasterSeed(seed);
+        } else {
+            seed = rd();
+            visitor.setRandomSeed(static_cast<unsigned>(seed));
+        }
+        {
+            ststgen::TraceSpan span{is_positive ? "generate positive" : "generate negative", "generate"};
+            visitor.mutateEntrance(output);
+        }
         auto time_generate = std::chrono::steady_clock::now();
-        visitor.writeCases();
+        {
+            ststgen::TraceSpan span{"validate and write", "write"};
+            visitor.writeCases();
+        }
         auto time_validate_and_write = std::chrono::steady_clock::now();
         std::chrono::nanoseconds parse_cpp_elapsed = time_parse_cpp - time_begin;
         std::chrono::nanoseconds generate_elapsed = time_generate - time_parse_cpp;
         std::chrono::nanoseconds validate_and_write_elapsed = time_validate_and_write - time_generate;
 
+        auto &metrics = visitor.getMetrics();
+        metrics.times.parse = parse_elapsed;
+        metrics.times.visit = parse_cpp_elapsed;
+        metrics.times.generate = generate_elapsed;
         {
             std::lock_guard<std::mutex> lock(output_buffer_mutex);
             fmt::println("\033[1;32mThread {} {} generator(seed: {}) output: \033[0m\n", thread_i, is_positive ? "positive" : "negative", seed);
             visitor.print();
-            fmt::println("\033[34mParse cpp time:\t\t\t{}s\nGenerate cases time:\t\t{}s\nValidate and write cases time:\t{}s\n\033[0m", 
+            fmt::println("\033[34mParse cpp time:\t\t\t{}s\nGenerate cases time:\t\t{}s\n  of which solving:\t\t{}s\n  of which extraction:\t\t{}s\nValidate and write cases time:\t{}s\n\033[0m", 
                 parse_cpp_elapsed.count() / 1e9,
                 generate_elapsed.count() / 1e9,
+                metrics.times.solve.count() / 1e9,
+                metrics.times.extract.count() / 1e9,
                 validate_and_write_elapsed.count() / 1e9
             );
+            worker_reports.push_back({thread_i, is_positive, seed, metrics});
         }
+        parse_elapsed = std::chrono::nanoseconds{0};
     };
 
     if (cases.first > 0) {
@@ -99,6 +140,111 @@ int main(int argc, char **argv) try {
             "number of threads",
             false,
             1);
+    cmd_parser.add<std::string>(
+            "array_encoding",
+            0,
+            "encoding of fixed-size arrays: nested (z3 arrays) or flat (one scalar per element); arrays of 65536+ elements indexed only by constants are always flat",
+            false,
+            "nested",
+            cmdline::oneof<std::string>("flat", "nested"));
+    cmd_parser.add<std::string>(
+            "pointer_encoding",
+            0,
+            "encoding of pointers: seq (z3 sequences) or bounded (length variable plus slots)",
+            false,
+            "seq",
+            cmdline::oneof<std::string>("bounded", "seq"));
+    cmd_parser.add<std::string>(
+            "struct_encoding",
+            0,
+            "encoding of structs: tuple (z3 tuple sorts) or flat (one scalar per member)",
+            false,
+            "tuple",
+            cmdline::oneof<std::string>("flat", "tuple"));
+    cmd_parser.add(
+            "bitvec",
+            '\0',
+            "encode integers as 32/64-bit bit-vectors with wrap-around (machine) semantics");
+    cmd_parser.add(
+            "boundary",
+            '\0',
+            "prefer range and equality boundaries of each variable when mutating");
+    cmd_parser.add<int>(
+            "max_pointer_len",
+            0,
+            "maximum length of a pointer",
+            false,
+            100,
+            cmdline::range(1, 65536));
+    cmd_parser.add<std::string>(
+            "harness_lib",
+            0,
+            "shared object containing the function under test",
+            false,
+            "");
+    cmd_parser.add<std::string>(
+            "harness_sym",
+            0,
+            "symbol of the function under test",
+            false,
+            "ststgen_target");
+    cmd_parser.add<int>(
+            "harness_timeout",
+            0,
+            "timeout of each harness call in milliseconds",
+            false,
+            1000,
+            cmdline::range(1, 3600 * 1000));
+    cmd_parser.add(
+            "harness_fork",
+            0,
+            "run each harness call in a forked child for isolation");
+    cmd_parser.add(
+            "coverage",
+            0,
+            "steer generation by new coverage of the harness target (link it with coverage_rt.c and build with -fsanitize-coverage=trace-pc-guard)");
+    cmd_parser.add(
+            "incremental",
+            0,
+            "keep the cases in the output directory that still satisfy the constraints and only generate the rest; a no-op when the constraint file, seed and case counts are unchanged");
+    cmd_parser.add<int>(
+            "mem_soft",
+            0,
+            "per-worker memory soft limit in MiB; above it cases are written early, the log is trimmed and the solver is rebuilt; the z3 context itself is kept (0: no limit)",
+            false,
+            0,
+            cmdline::range(0, 1 << 20));
+    cmd_parser.add<int>(
+            "mem_hard",
+            0,
+            "per-worker memory hard limit in MiB; a worker still above it after the soft-limit measures stops generating (0: no limit)",
+            false,
+            0,
+            cmdline::range(0, 1 << 20));
+    cmd_parser.add<std::string>(
+            "metrics",
+            0,
+            "write per-worker metrics as json to this file",
+            false,
+            "");
+    cmd_parser.add<std::string>(
+            "trace",
+            0,
+            "write a Chrome trace-event timeline to this file",
+            false,
+            "");
+    cmd_parser.add<std::string>(
+            "seed",
+            0,
+            "master seed; every case is then generated independently from (seed, polarity, case id), regardless of -j",
+            false,
+            "");
+    cmd_parser.add<std::string>(
+            "case",
+            0,
+            "regenerate only this case (e.g. N01234), requires --seed",
+            false,
+            "");
     cmd_parser.parse_check(argc, argv);
     int num_cases = cmd_parser.get<int>("num_cases");
     double pos_ratio = cmd_parser.get<double>("pos_ratio");
@@ -118,8 +264,96 @@ int main(int argc, char **argv) try {
     } else {
         ststgen::g_log_level = 0;
     }
+    const auto trace_path = cmd_parser.get<std::string>("trace");
+    if (!trace_path.empty()) {
+        ststgen::TraceRecorder::instance().enable();
+    }
+    const auto array_encoding = cmd_parser.get<std::string>("array_encoding") == "flat" ? ststgen::ArrayEncoding::Flat : ststgen::ArrayEncoding::Nested;
+    const auto pointer_encoding = cmd_parser.get<std::string>("pointer_encoding") == "bounded" ? ststgen::PointerEncoding::Bounded : ststgen::PointerEncoding::Seq;
+    const auto struct_encoding = cmd_parser.get<std::string>("struct_encoding") == "flat" ? ststgen::StructEncoding::Flat : ststgen::StructEncoding::Tuple;
+    const int max_pointer_len = cmd_parser.get<int>("max_pointer_len");
+    const bool bitvec = cmd_parser.exist("bitvec");
+    const bool boundary = cmd_parser.exist("boundary");
     int thread_num = cmd_parser.get<int>("thread");
     thread_num = std::min(thread_num, 65535);
+    std::optional<uint64_t> master_seed{};
+    if (!cmd_parser.get<std::string>("seed").empty()) {
+        master_seed = std::stoull(cmd_parser.get<std::string>("seed"), nullptr, 0);
+    }
+    ststgen::MemoryLimits memory_limits{};
+    memory_limits.soft = static_cast<size_t>(cmd_parser.get<int>("mem_soft")) << 20;
+    memory_limits.hard = static_cast<size_t>(cmd_parser.get<int>("mem_hard")) << 20;
+    PII first_case_num{0, 0};
+    if (const auto single = cmd_parser.get<std::string>("case"); !single.empty()) {
+        if (!master_seed) {
+            fmt::println("--case requires the --seed the case was generated with");
+            return 1;
+        }
+        if (single.size() < 2 || (single[0] != 'P' && single[0] != 'N')) {
+            fmt::println("--case expects a case name such as P00012 or N01234");
+            return 1;
+        }
+        const int id = std::stoi(single.substr(1));
+        pos_cases = single[0] == 'P' ? 1 : 0;
+        neg_cases = 1 - pos_cases;
+        first_case_num = {id, id};
+        thread_num = 1;
+    }
+
+    const bool single_case = !cmd_parser.get<std::string>("case").empty();
+    auto incremental = cmd_parser.exist("incremental") && !single_case ? ststgen::Incremental::Revalidate : ststgen::Incremental::Off;
+    const auto manifest_path = std::filesystem::path(output) / ststgen::MANIFEST_FILE;
+    const auto manifest = ststgen::make_manifest(cons_src, master_seed, pos_cases, neg_cases);
+    if (incremental != ststgen::Incremental::Off && std::filesystem::exists(manifest_path)) {
+        std::ifstream ifs(manifest_path);
+        const auto previous = nlohmann::json::parse(ifs, nullptr, false);
+        if (previous == manifest && ststgen::corpus_complete(output, pos_cases, neg_cases)) {
+            fmt::println("constraints, seed and case counts unchanged, {} cases are up to date", pos_cases + neg_cases);
+            fmt::println("ALL DONE");
+            return 0;
+        }
+        // 约束文件没变时已有用例都仍成立，不必读入重新验证，只补足缺少的
+        if (previous.is_object() && previous.value("constraints", "") == manifest["constraints"]) {
+            incremental = ststgen::Incremental::Trust;
+        }
+        // 用例数减少时，超出新范围的旧用例不属于任何生成器，直接删除
+        if (previous.is_object()) {
+            for (int i = pos_cases; i < previous.value("positive", 0); ++i) {
+                std::filesystem::remove(std::filesystem::path(output) / fmt::format("P{:05d}.json", i));
+            }
+            for (int i = neg_cases; i < previous.value("negative", 0); ++i) {
+                std::filesystem::remove(std::filesystem::path(output) / fmt::format("N{:05d}.json", i));
+            }
+        }
+    }
+
+    std::unique_ptr<ststgen::Harness> harness{};
+    if (cmd_parser.exist("coverage") && cmd_parser.get<std::string>("harness_lib").empty()) {
+        fmt::println("--coverage requires --harness_lib");
+        return 1;
+    }
+    if (!cmd_parser.get<std::string>("harness_lib").empty()) {
+        ststgen::Harness::Options opts{};
+        opts.library = cmd_parser.get<std::string>("harness_lib");
+        opts.symbol = cmd_parser.get<std::string>("harness_sym");
+        opts.timeout_ms = cmd_parser.get<int>("harness_timeout");
+        opts.fork_server = cmd_parser.exist("harness_fork");
+        opts.coverage = cmd_parser.exist("coverage");
+        opts.report = std::filesystem::path(output) / "harness.jsonl";
+        harness = std::make_unique<ststgen::Harness>(std::move(opts));
+    }
+
+    auto time_parse_begin = std::chrono::steady_clock::now();
+    ststgen::ConstraintFrontend frontend{cons_src};
+    antlr4::tree::ParseTree *tree = nullptr;
+    {
+        ststgen::TraceSpan span{"parse", "frontend"};
+        tree = frontend.parse();
+    }
+    const std::chrono::nanoseconds parse_elapsed = std::chrono::steady_clock::now() - time_parse_begin;
+    if (frontend.used_fallback()) {
+        fmt::println("SLL parse failed, constraint file was reparsed with full LL prediction");
+    }
 
     // schedule threads
     PII case_per_thread = {pos_cases / thread_num, neg_cases / thread_num};
@@ -127,15 +361,16 @@ int main(int argc, char **argv) try {
         return cases_num - per_thread * (thread_num - 1);
     };
     const PII remained_cases = {calculate_remained_cases(pos_cases, case_per_thread.first), calculate_remained_cases(neg_cases, case_per_thread.second)};
-    PII start_case_num{0, 0};
+    PII start_case_num = first_case_num;
     std::vector<std::thread> threads;
+    memory_limits.workers = static_cast<unsigned>(thread_num);
 
     for (auto i = 1; i <= thread_num; i++) {
         if (i == thread_num) {
             // the last thread may not generate the same number of cases
             case_per_thread = remained_cases;
         }
-        threads.emplace_back(core_runner, cons_src, output, case_per_thread, start_case_num, i);
+        threads.emplace_back(core_runner, tree, parse_elapsed, output, case_per_thread, start_case_num, i, harness.get(), array_encoding, pointer_encoding, struct_encoding, max_pointer_len, bitvec, boundary, master_seed, memory_limits, incremental);
         start_case_num.first += case_per_thread.first;
         start_case_num.second += case_per_thread.second;
     }
@@ -143,6 +378,36 @@ int main(int argc, char **argv) try {
     for (auto &t: threads) {
         t.join();
     }
+    ststgen::log_flush();
+    if (!single_case) {
+        std::ofstream ofs(manifest_path);
+        ofs << std::setw(4) << manifest << '\n';
+    }
+    if (!trace_path.empty()) {
+        ststgen::TraceRecorder::instance().write(trace_path);
+    }
+    const auto metrics_path = cmd_parser.get<std::string>("metrics");
+    if (!metrics_path.empty()) {
+        ststgen::WorkerMetrics total{};
+        auto workers = nlohmann::json::array();
+        for (const auto &report: worker_reports) {
+            auto j = report.metrics.to_json();
+            j["thread"] = report.thread;
+            j["polarity"] = report.is_positive ? "positive" : "negative";
+            j["seed"] = report.seed;
+            workers.push_back(std::move(j));
+            total += report.metrics;
+        }
+        std::ofstream ofs(metrics_path);
+        auto total_json = total.to_json();
+        if (harness && harness->has_coverage()) {
+            total_json["coverage"]["edges"] = harness->edges_covered();
+        }
+        ofs << std::setw(4) << nlohmann::json{{"workers", workers}, {"total", total_json}} << '\n';
+    }
+    if (harness && harness->has_coverage()) {
+        fmt::println("coverage: {} edges", harness->edges_covered());
+    }
     fmt::println("ALL DONE");
 
 
@@ -151,5 +416,6 @@ int main(int argc, char **argv) try {
     // _CrtDumpMemoryLeaks();
     return 0;
 } catch (const std::exception &e) {
+    ststgen::log_flush();
     fmt::println("main catch exception: {}", e.what());
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "manifest.hpp"
+
+#include <fmt/core.h>
+
+namespace ststgen {
+
+    std::string content_hash(const std::string &src) {
+        uint64_t h = 14695981039346656037ull;
+        for (auto c: src) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 1099511628211ull;
+        }
+        return fmt::format("{:016x}", h);
+    }
+
+    nlohmann::json make_manifest(const std::string &cons_src, const std::optional<uint64_t> master_seed, const int pos_cases, const int neg_cases) {
+        return nlohmann::json{
+                {"constraints", content_hash(cons_src)},
+                {"seed", master_seed ? nlohmann::json(*master_seed) : nlohmann::json(nullptr)},
+                {"positive", pos_cases},
+                {"negative", neg_cases},
+        };
+    }
+
+    bool corpus_complete(const std::filesystem::path &output, const int pos_cases, const int neg_cases) {
+        for (int i = 0; i < pos_cases; ++i) {
+            if (!std::filesystem::exists(output / fmt::format("P{:05d}.json", i))) {
+                return false;
+            }
+        }
+        for (int i = 0; i < neg_cases; ++i) {
+            if (!std::filesystem::exists(output / fmt::format("N{:05d}.json", i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+}// namespace ststgen
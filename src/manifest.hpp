@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace ststgen {
+
+    /// @brief 输出目录中记录上次生成所用约束与参数的文件，增量模式据此判断能否跳过
+    constexpr auto MANIFEST_FILE = "manifest.json";
+
+    /// @brief 约束文件内容的FNV-1a散列
+    std::string content_hash(const std::string &src);
+    nlohmann::json make_manifest(const std::string &cons_src, std::optional<uint64_t> master_seed, int pos_cases, int neg_cases);
+    /// @brief 输出目录中P/N各编号的用例文件是否都存在
+    bool corpus_complete(const std::filesystem::path &output, int pos_cases, int neg_cases);
+}// namespace ststgen
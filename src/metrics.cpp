@@ -0,0 +1,265 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <fstream>
+#include <iomanip>
+
+namespace ststgen {
+
+    namespace {
+        double seconds(std::chrono::nanoseconds ns) {
+            return ns.count() / 1e9;
+        }
+    }// namespace
+
+    void LatencyHistogram::add(std::chrono::nanoseconds ns) {
+        auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(ns).count());
+        size_t bucket = 0;
+        while (us > 1 && bucket + 1 < BUCKETS) {
+            us >>= 1;
+            bucket++;
+        }
+        counts[bucket]++;
+    }
+
+    LatencyHistogram &LatencyHistogram::operator+=(const LatencyHistogram &other) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            counts[i] += other.counts[i];
+        }
+        return *this;
+    }
+
+    nlohmann::json LatencyHistogram::to_json() const {
+        // 只输出非空的桶，键为桶的下界(微秒)
+        auto ret = nlohmann::json::object();
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            if (counts[i] != 0) {
+                ret[std::to_string(i == 0 ? 0 : 1ull << i)] = counts[i];
+            }
+        }
+        return ret;
+    }
+
+    void SampleHistogram::add(double v) {
+        count++;
+        sum += v;
+        sum_sq += v * v;
+        const double pos = (v - (mu - 5 * sigma)) / (10 * sigma) * BINS;
+        if (!(pos >= 0)) {
+            counts[0]++;
+        } else if (pos >= BINS) {
+            counts[BINS + 1]++;
+        } else {
+            counts[static_cast<size_t>(pos) + 1]++;
+        }
+    }
+
+    SampleHistogram &SampleHistogram::operator+=(const SampleHistogram &other) {
+        if (count == 0) {
+            mu = other.mu;
+            sigma = other.sigma;
+        }
+        count += other.count;
+        sum += other.sum;
+        sum_sq += other.sum_sq;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += other.counts[i];
+        }
+        return *this;
+    }
+
+    nlohmann::json SampleHistogram::to_json() const {
+        const double mean = count ? sum / count : 0.0;
+        const double var = count ? std::max(0.0, sum_sq / count - mean * mean) : 0.0;
+        return {
+                {"mu", mu},
+                {"sigma", sigma},
+                {"count", count},
+                {"mean", mean},
+                {"stddev", std::sqrt(var)},
+                {"bins", counts},
+        };
+    }
+
+    std::string SampleHistogram::to_string() const {
+        constexpr int WIDTH = 50;
+        const auto peak = *std::max_element(counts.begin(), counts.end());
+        std::string ret{};
+        for (size_t i = 0; i < counts.size(); ++i) {
+            std::string label{};
+            if (i == 0) {
+                label = fmt::format("< {:.3g}", mu - 5 * sigma);
+            } else if (i == BINS + 1) {
+                label = fmt::format(">= {:.3g}", mu + 5 * sigma);
+            } else {
+                label = fmt::format("{:.3g}", mu - 5 * sigma + (i - 1) * sigma / 2);
+            }
+            const auto bar = peak ? static_cast<size_t>(counts[i] * WIDTH / peak) : 0;
+            ret += fmt::format("{:>12} | {} {}\n", label, std::string(bar, '#'), counts[i]);
+        }
+        return ret;
+    }
+
+    WorkerMetrics &WorkerMetrics::operator+=(const WorkerMetrics &other) {
+        times.parse += other.times.parse;
+        times.visit += other.times.visit;
+        times.generate += other.times.generate;
+        times.solve += other.times.solve;
+        times.extract += other.times.extract;
+        times.validate += other.times.validate;
+        times.write += other.times.write;
+        checks_sat += other.checks_sat;
+        checks_unsat += other.checks_unsat;
+        checks_unknown += other.checks_unknown;
+        check_latency += other.check_latency;
+        checks_saved += other.checks_saved;
+        cases_produced += other.cases_produced;
+        cases_deduplicated += other.cases_deduplicated;
+        cases_rejected += other.cases_rejected;
+        cases_kept += other.cases_kept;
+        cases_invalidated += other.cases_invalidated;
+        values_wrapped += other.values_wrapped;
+        mutation_cycles += other.mutation_cycles;
+        terms_eliminated += other.terms_eliminated;
+        stalled_cycles += other.stalled_cycles;
+        enumerated_models += other.enumerated_models;
+        space_exhausted += other.space_exhausted;
+        // 各生成器同时运行，峰值按和估计
+        memory_peak += other.memory_peak;
+        memory_z3_peak += other.memory_z3_peak;
+        memory_cases_peak += other.memory_cases_peak;
+        memory_log_peak += other.memory_log_peak;
+        memory_qjs_peak += other.memory_qjs_peak;
+        memory_flushes += other.memory_flushes;
+        solver_resets += other.solver_resets;
+        memory_limited += other.memory_limited;
+        or_combinations_pruned += other.or_combinations_pruned;
+        cases_executed += other.cases_executed;
+        cases_new_coverage += other.cases_new_coverage;
+        boundary_targets += other.boundary_targets;
+        boundary_hits += other.boundary_hits;
+        for (const auto &[name, histogram]: other.gaussian) {
+            gaussian[name] += histogram;
+        }
+        return *this;
+    }
+
+    nlohmann::json WorkerMetrics::to_json() const {
+        nlohmann::json ret{};
+        ret["time"] = {
+                {"parse", seconds(times.parse)},
+                {"visit", seconds(times.visit)},
+                {"generate", seconds(times.generate)},
+                {"solve", seconds(times.solve)},
+                {"extract", seconds(times.extract)},
+                {"validate", seconds(times.validate)},
+                {"write", seconds(times.write)},
+        };
+        ret["checks"] = {
+                {"sat", checks_sat},
+                {"unsat", checks_unsat},
+                {"unknown", checks_unknown},
+                {"saved", checks_saved},
+                {"per_case", cases_produced == 0 ? 0.0 : static_cast<double>(checks_sat + checks_unsat + checks_unknown) / cases_produced},
+                {"latency_us", check_latency.to_json()},
+        };
+        ret["cases"] = {
+                {"produced", cases_produced},
+                {"deduplicated", cases_deduplicated},
+                {"rejected", cases_rejected},
+                {"kept", cases_kept},
+                {"invalidated", cases_invalidated},
+                {"values_wrapped", values_wrapped},
+        };
+        ret["mutation_cycles"] = mutation_cycles;
+        ret["terms_eliminated"] = terms_eliminated;
+        ret["or_combinations_pruned"] = or_combinations_pruned;
+        ret["saturation"] = {
+                {"stalled_cycles", stalled_cycles},
+                {"enumerated_models", enumerated_models},
+                {"space_exhausted", space_exhausted},
+        };
+        ret["memory"] = {
+                {"peak_bytes", memory_peak},
+                {"z3_peak_bytes", memory_z3_peak},
+                {"cases_peak_bytes", memory_cases_peak},
+                {"log_peak_bytes", memory_log_peak},
+                {"qjs_peak_bytes", memory_qjs_peak},
+                {"flushes", memory_flushes},
+                {"solver_resets", solver_resets},
+                {"limited", memory_limited},
+        };
+        if (cases_executed != 0) {
+            ret["coverage"] = {
+                    {"executed", cases_executed},
+                    {"new_coverage", cases_new_coverage},
+            };
+        }
+        if (boundary_targets != 0) {
+            ret["boundary"] = {
+                    {"targets", boundary_targets},
+                    {"hit", boundary_hits},
+            };
+        }
+        if (!gaussian.empty()) {
+            auto &g = ret["gaussian"];
+            for (const auto &[name, histogram]: gaussian) {
+                g[name] = histogram.to_json();
+            }
+        }
+        return ret;
+    }
+
+    TraceRecorder &TraceRecorder::instance() {
+        static TraceRecorder recorder{};
+        return recorder;
+    }
+
+    TraceRecorder::ThreadBuffer &TraceRecorder::local_buffer() {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(m_register_mutex);
+            m_buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = m_buffers.back().get();
+            buffer->tid = static_cast<int>(m_buffers.size());
+        }
+        return *buffer;
+    }
+
+    void TraceRecorder::record(const char *name, const char *category,
+                               std::chrono::steady_clock::time_point begin,
+                               std::chrono::steady_clock::time_point end) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        local_buffer().events.push_back(Event{
+                name,
+                category,
+                duration_cast<microseconds>(begin - m_origin).count(),
+                duration_cast<microseconds>(end - begin).count(),
+        });
+    }
+
+    void TraceRecorder::set_thread_name(const std::string &name) {
+        if (enabled()) {
+            local_buffer().name = name;
+        }
+    }
+
+    void TraceRecorder::write(const std::filesystem::path &path) {
+        // 只应在所有工作线程结束后调用
+        std::lock_guard<std::mutex> lock(m_register_mutex);
+        auto events = nlohmann::json::array();
+        for (const auto &buffer: m_buffers) {
+            if (!buffer->name.empty()) {
+                events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->tid}, {"args", {{"name", buffer->name}}}});
+            }
+            for (const auto &e: buffer->events) {
+                events.push_back({{"name", e.name}, {"cat", e.category}, {"ph", "X"}, {"ts", e.ts_us}, {"dur", e.dur_us}, {"pid", 1}, {"tid", buffer->tid}});
+            }
+        }
+        std::ofstream ofs(path);
+        ofs << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+    }
+}// namespace ststgen
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace ststgen {
+
+    /// @brief 生成器各阶段的累计耗时
+    /// parse/visit/generate由调用方计时，generate中包含solve与extract
+    struct PhaseTimes {
+        std::chrono::nanoseconds parse{0};
+        std::chrono::nanoseconds visit{0};
+        std::chrono::nanoseconds generate{0};
+        std::chrono::nanoseconds solve{0};
+        std::chrono::nanoseconds extract{0};
+        std::chrono::nanoseconds validate{0};
+        std::chrono::nanoseconds write{0};
+    };
+
+    /// @brief 按2的幂分桶的延迟直方图，桶i统计[2^i, 2^(i+1))微秒
+    struct LatencyHistogram {
+        static constexpr size_t BUCKETS = 32;
+        std::array<uint64_t, BUCKETS> counts{};
+
+        void add(std::chrono::nanoseconds ns);
+        LatencyHistogram &operator+=(const LatencyHistogram &other);
+        nlohmann::json to_json() const;
+    };
+
+    /// @brief GAUSSIAN变量取值的直方图，[mu-5sigma, mu+5sigma]等分为BINS个桶，两端各加一个溢出桶
+    struct SampleHistogram {
+        static constexpr size_t BINS = 20;
+        double mu = 0.0;
+        double sigma = 1.0;
+        uint64_t count = 0;
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        std::array<uint64_t, BINS + 2> counts{};
+
+        void add(double v);
+        SampleHistogram &operator+=(const SampleHistogram &other);
+        nlohmann::json to_json() const;
+        /// @brief 文本形式的直方图，每桶一行
+        std::string to_string() const;
+    };
+
+    /// @brief 单个生成器(线程)的计数器
+    struct WorkerMetrics {
+        PhaseTimes times{};
+        uint64_t checks_sat = 0;
+        uint64_t checks_unsat = 0;
+        uint64_t checks_unknown = 0;
+        LatencyHistogram check_latency{};
+        // 直接复用变异时检查所得模型、省去的solve()检查
+        uint64_t checks_saved = 0;
+        // 求解得到并加入用例集合的
+        uint64_t cases_produced = 0;
+        // 与已有用例重复而被丢弃的
+        uint64_t cases_deduplicated = 0;
+        // 未通过QJS验证的
+        uint64_t cases_rejected = 0;
+        // 增量模式下重新验证后保留的已有用例，及不再成立而删除的
+        uint64_t cases_kept = 0;
+        uint64_t cases_invalidated = 0;
+        // 模型中超出声明类型范围而被截断的取值，定义域约束覆盖到的项不会出现
+        uint64_t values_wrapped = 0;
+        uint64_t mutation_cycles = 0;
+        // 由等式确定而在生成前消去的项
+        uint64_t terms_eliminated = 0;
+        // 连续多轮没有新用例而转为枚举的轮数，枚举中得到的模型数，及因解已取尽而提前结束的生成器数
+        uint64_t stalled_cycles = 0;
+        uint64_t enumerated_models = 0;
+        uint64_t space_exhausted = 0;
+        // 估计内存占用(字节)的峰值：合计，及其中按生成器数平摊的z3分配量、用例集合、日志；QJS只在写出时存在，单独统计
+        uint64_t memory_peak = 0;
+        uint64_t memory_z3_peak = 0;
+        uint64_t memory_cases_peak = 0;
+        uint64_t memory_log_peak = 0;
+        uint64_t memory_qjs_peak = 0;
+        // 超过软上限而提前写出用例、重建求解器的次数，及因硬上限提前停止的生成器数
+        uint64_t memory_flushes = 0;
+        uint64_t solver_resets = 0;
+        uint64_t memory_limited = 0;
+        // 因包含已知不可满足的部分组合而未经检查就排除的或分支组合
+        uint64_t or_combinations_pruned = 0;
+        // 覆盖反馈模式下生成时执行的用例，及其中带来新覆盖的
+        uint64_t cases_executed = 0;
+        uint64_t cases_new_coverage = 0;
+        // 边界模式下各变量出现过的边界值总数，及其中命中的
+        uint64_t boundary_targets = 0;
+        uint64_t boundary_hits = 0;
+        // 按约束中的写法(如s[0].c)区分的GAUSSIAN变量
+        std::map<std::string, SampleHistogram> gaussian{};
+
+        WorkerMetrics &operator+=(const WorkerMetrics &other);
+        nlohmann::json to_json() const;
+    };
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(std::chrono::nanoseconds &acc) : m_acc(acc), m_begin(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            m_acc += std::chrono::steady_clock::now() - m_begin;
+        }
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+        std::chrono::nanoseconds &m_acc;
+        std::chrono::steady_clock::time_point m_begin;
+    };
+
+    /// @brief 以Chrome trace-event格式记录各线程的区间
+    /// 每个线程写自己的缓冲区，只在首次记录时注册一次
+    class TraceRecorder {
+    public:
+        static TraceRecorder &instance();
+
+        void enable() {
+            m_enabled.store(true, std::memory_order_relaxed);
+        }
+        bool enabled() const {
+            return m_enabled.load(std::memory_order_relaxed);
+        }
+        void record(const char *name, const char *category,
+                    std::chrono::steady_clock::time_point begin,
+                    std::chrono::steady_clock::time_point end);
+        void set_thread_name(const std::string &name);
+        void write(const std::filesystem::path &path);
+
+    private:
+        struct Event {
+            const char *name;
+            const char *category;
+            int64_t ts_us;
+            int64_t dur_us;
+        };
+        struct ThreadBuffer {
+            int tid = 0;
+            std::string name{};
+            std::vector<Event> events{};
+        };
+        ThreadBuffer &local_buffer();
+
+        std::atomic<bool> m_enabled{false};
+        std::chrono::steady_clock::time_point m_origin = std::chrono::steady_clock::now();
+        std::mutex m_register_mutex{};
+        std::vector<std::unique_ptr<ThreadBuffer>> m_buffers{};
+    };
+
+    /// @brief 作用域结束时向TraceRecorder记录一个区间，未开启时不做任何事
+    class TraceSpan {
+    public:
+        TraceSpan(const char *name, const char *category) : m_name(name), m_category(category) {
+            if (TraceRecorder::instance().enabled()) {
+                m_active = true;
+                m_begin = std::chrono::steady_clock::now();
+            }
+        }
+        ~TraceSpan() {
+            if (m_active) {
+                TraceRecorder::instance().record(m_name, m_category, m_begin, std::chrono::steady_clock::now());
+            }
+        }
+        TraceSpan(const TraceSpan &) = delete;
+        TraceSpan &operator=(const TraceSpan &) = delete;
+
+    private:
+        const char *m_name;
+        const char *m_category;
+        bool m_active = false;
+        std::chrono::steady_clock::time_point m_begin{};
+    };
+}// namespace ststgen
@@ -1,12 +1,99 @@
 #include "parser.hpp"
+#include "harness.hpp"
+#include "sparse_array.hpp"
 #include "utils.hpp"
 #include "z3++.h"
 
+#include <cmath>
+#include <deque>
+#include <fmt/ranges.h>
+#include <functional>
+#include <limits>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 namespace ststgen {
 
     static const char *CONSTRAINT_FUNC_NAME = "_CONSTRAINT";
 
+    /// @brief 标准正态分布的逆CDF，Acklam的有理逼近，相对误差约1e-9
+    static double inverse_normal_cdf(double p) {
+        static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                                   1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+        static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                                   6.680131188771972e+01, -1.328068155288572e+01};
+        static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                                   -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+        static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                                   3.754408661907416e+00};
+        constexpr double low = 0.02425;
+        if (p <= 0) {
+            return -std::numeric_limits<double>::infinity();
+        }
+        if (p >= 1) {
+            return std::numeric_limits<double>::infinity();
+        }
+        if (p < low) {
+            const double q = std::sqrt(-2 * std::log(p));
+            return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                   ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        }
+        if (p > 1 - low) {
+            const double q = std::sqrt(-2 * std::log(1 - p));
+            return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                   ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        }
+        const double q = p - 0.5, r = q * q;
+        return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+               (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+    }
+
+    /// @brief 累积unsigned/long/int等基本类型说明符，得到最终类型
+    struct ScalarTypeSpec {
+        bool seen = false;
+        bool is_unsigned = false;
+        // float为Float32，double与long double为Float64
+        bool is_float = false;
+        bool is_double = false;
+        int longs = 0;
+
+        /// @return 是否为基本类型说明符
+        bool add(c11parser::CParser::TypeSpecifierContext *typ_s) {
+            if (typ_s->Unsigned()) {
+                is_unsigned = true;
+            } else if (typ_s->Long()) {
+                longs++;
+            } else if (typ_s->Float()) {
+                is_float = true;
+            } else if (typ_s->Double()) {
+                is_double = true;
+            } else if (!(typ_s->Char() || typ_s->Short() || typ_s->Int() || typ_s->Signed())) {
+                return false;
+            }
+            seen = true;
+            return true;
+        }
+
+        SymbolTableEntryType type() const {
+            if (!seen) {
+                return SymbolTableEntryType::None;
+            }
+            if (is_float) {
+                return SymbolTableEntryType::Float32;
+            }
+            if (is_double) {
+                return SymbolTableEntryType::Float64;
+            }
+            // LP64：long与long long均为64位
+            if (longs > 0) {
+                return is_unsigned ? SymbolTableEntryType::UInt64 : SymbolTableEntryType::Int64;
+            }
+            return is_unsigned ? SymbolTableEntryType::UInt32 : SymbolTableEntryType::Int32;
+        }
+    };
+
     void array_idx_generator(const std::vector<int> &dims,
                              int depth,
                              std::vector<int> &idx,
@@ -23,16 +110,897 @@ namespace ststgen {
     }
     std::any CConstraintVisitor::visitExpressionStatement(c11parser::CParser::ExpressionStatementContext *ctx) {
         m_process_constraint_statement = true;
-        auto expr = std::any_cast<z3::expr>(visit(ctx->expression()));
-        // guard for gaussian or other function-like constraints
-        if (!expr.is_string_value()) {
-            info("add cons: ", expr.to_string());
-            m_smt_solver.add(expr);
-            m_cons_expressions.push_back(ctx->expression()->getText());
-        }
+        // 先全部下降为IR，等整个_CONSTRAINT分析完后再统一生成z3约束
+        m_pending_statements.emplace_back(lower(ctx->expression()), ctx->expression()->getText());
         m_process_constraint_statement = false;
         return 0;
     }
+    void CConstraintVisitor::emitConstraints() {
+        for (const auto &[root, _]: m_pending_statements) {
+            scan_array_uses(root);
+            scan_struct_uses(root);
+            scan_references(root);
+        }
+        for (auto &[root, text]: m_pending_statements) {
+            auto expr = emit(root);
+            if (!m_pending_guards.empty()) {
+                // 不在比较式中的指针元素访问，条件直接加在整条语句上
+                if (expr.is_bool()) {
+                    for (const auto &guard: m_pending_guards) {
+                        expr = guard && expr;
+                    }
+                }
+                m_pending_guards.clear();
+            }
+            // guard for gaussian or other function-like constraints
+            if (!expr.is_string_value()) {
+                info("add cons: ", expr.to_string());
+                m_smt_solver.add(expr);
+                m_cons_expressions.push_back(std::move(text));
+                m_constraint_roots.push_back(root);
+            }
+        }
+        m_pending_statements.clear();
+        classify_gaussian();
+        if (positive == 'P') {
+            eliminate_defined_terms();
+        }
+    }
+    namespace {
+        bool occurs(const z3::expr &e, const z3::expr &term) {
+            if (z3::eq(e, term)) {
+                return true;
+            }
+            if (!e.is_app()) {
+                return false;
+            }
+            for (unsigned i = 0; i < e.num_args(); ++i) {
+                if (occurs(e.arg(i), term)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        std::optional<int64_t> exact_int(double v) {
+            if (std::abs(v) > 9007199254740992.0 || v != std::round(v)) {
+                return std::nullopt;
+            }
+            return static_cast<int64_t>(v);
+        }
+    }// namespace
+    void CConstraintVisitor::collect_definitions(ir::NodeId root, std::vector<ir::NodeId> &equalities) const {
+        if (m_ir.op(root) == ir::Op::And) {
+            for (uint32_t i = 0; i < m_ir.num_args(root); ++i) {
+                collect_definitions(m_ir.arg(root, i), equalities);
+            }
+        } else if (m_ir.op(root) == ir::Op::Eq) {
+            equalities.push_back(root);
+        }
+    }
+    bool CConstraintVisitor::eliminable(ir::NodeId leaf) {
+        const auto op = m_ir.op(leaf);
+        if (op != ir::Op::Var && op != ir::Op::Index && op != ir::Op::Field) {
+            return false;
+        }
+        auto type = leaf_type(leaf);
+        if (!type || (*type != SymbolTableEntryType::Int32 && *type != SymbolTableEntryType::Int64 &&
+                      *type != SymbolTableEntryType::UInt32 && *type != SymbolTableEntryType::UInt64)) {
+            return false;
+        }
+        if (leaf >= m_z3_cache.size() || !m_z3_cache[leaf] || !json_path(leaf)) {
+            return false;
+        }
+        // 只消去展平的元素：SMT数组/序列中的元素还可能经非常量下标访问到
+        auto base = leaf;
+        while (m_ir.op(base) != ir::Op::Var) {
+            base = m_ir.arg(base, 0);
+        }
+        const auto *entry = m_symbol_table.lookup_entry(m_ir.name(base));
+        if (entry == nullptr || (entry->qualifer != SymbolTableEntryQualifer::Primary && !is_flat_array(m_ir.name(base), *entry))) {
+            return false;
+        }
+        return std::none_of(m_gaussian_cons.begin(), m_gaussian_cons.end(), [&](const GaussianCons &g) {
+            return g.target == leaf;
+        });
+    }
+    void CConstraintVisitor::eliminate_defined_terms() {
+        std::vector<ir::NodeId> equalities{};
+        for (auto root: m_constraint_roots) {
+            collect_definitions(root, equalities);
+        }
+        z3::expr_vector terms{m_solver_context}, definitions{m_solver_context};
+        for (auto eq: equalities) {
+            auto lhs = m_ir.linear(m_ir.arg(eq, 0));
+            auto rhs = m_ir.linear(m_ir.arg(eq, 1));
+            if (!lhs || !rhs) {
+                continue;
+            }
+            // lhs - rhs == 0
+            for (const auto &[v, c]: rhs->coeffs) {
+                if ((lhs->coeffs[v] -= c) == 0.0) {
+                    lhs->coeffs.erase(v);
+                }
+            }
+            lhs->constant -= rhs->constant;
+            // 系数为±1的项可以解出，其余系数与常数须为整数，定义式才保持整数
+            std::optional<ir::NodeId> target{};
+            bool integral = exact_int(lhs->constant).has_value();
+            for (const auto &[v, c]: lhs->coeffs) {
+                integral = integral && exact_int(c).has_value();
+                if (!target && std::abs(c) == 1.0 && eliminable(v)) {
+                    target = v;
+                }
+            }
+            if (!integral || !target) {
+                continue;
+            }
+            const auto term = *m_z3_cache[*target];
+            const auto sign = -lhs->coeffs.at(*target);
+            auto definition = int_value_of(term.get_sort(), *exact_int(sign * lhs->constant));
+            bool same_sort = true;
+            for (const auto &[v, c]: lhs->coeffs) {
+                if (v == *target) {
+                    continue;
+                }
+                if (v >= m_z3_cache.size() || !m_z3_cache[v] || !z3::eq(m_z3_cache[v]->get_sort(), term.get_sort())) {
+                    same_sort = false;
+                    break;
+                }
+                definition = definition + int_value_of(term.get_sort(), *exact_int(sign * c)) * *m_z3_cache[v];
+            }
+            if (!same_sort) {
+                continue;
+            }
+            // 代入已消去的项后仍含自身，说明与之前的定义成环
+            definition = definition.substitute(terms, definitions);
+            if (occurs(definition, term) || std::any_of(m_eliminated.begin(), m_eliminated.end(), [&](const EliminatedTerm &e) {
+                    return z3::eq(e.term, term);
+                })) {
+                continue;
+            }
+            z3::expr_vector from{m_solver_context}, to{m_solver_context};
+            from.push_back(term);
+            to.push_back(definition);
+            // 之前的定义式中出现的本项也要代入
+            z3::expr_vector updated{m_solver_context};
+            for (auto &e: m_eliminated) {
+                e.definition = e.definition.substitute(from, to);
+                updated.push_back(e.definition);
+            }
+            updated.push_back(definition);
+            terms.push_back(term);
+            definitions = updated;
+            m_eliminated.push_back({*target, term, definition, *json_path(*target), *leaf_type(*target)});
+        }
+        if (m_eliminated.empty()) {
+            return;
+        }
+        z3::expr_vector simplified{m_solver_context};
+        for (auto &e: m_eliminated) {
+            e.definition = e.definition.simplify();
+            simplified.push_back(e.definition);
+        }
+        definitions = simplified;
+
+        // 求解器中不再出现被消去的项，定义式恒真后去掉，常量随之折叠
+        auto assertions = m_smt_solver.assertions();
+        m_smt_solver.reset();
+        std::unordered_set<unsigned> rewritten_domain{};
+        for (auto a: assertions) {
+            auto rewritten = a.substitute(terms, definitions).simplify();
+            if (is_domain_constraint(a)) {
+                // 被消去项的取值范围约束变为对定义式的约束，仍需保留
+                std::replace_if(m_domain_constraints.begin(), m_domain_constraints.end(), [&](const z3::expr &d) {
+                    return z3::eq(d, a);
+                }, rewritten);
+                rewritten_domain.insert(rewritten.id());
+            }
+            if (!rewritten.is_true()) {
+                m_smt_solver.add(rewritten);
+            }
+        }
+        m_domain_constraint_ids = std::move(rewritten_domain);
+        // 或分支只代入不化简，var_range依赖其比较式的形式
+        for (auto &e: all_expr_vector) {
+            e = e.substitute(terms, definitions);
+        }
+        // 只变异独立的项，原先由被消去项索引的约束改由定义式中的项索引
+        for (const auto &e: m_eliminated) {
+            auto name = e.term.to_string();
+            constraint_val_list.erase(std::remove_if(constraint_val_list.begin(), constraint_val_list.end(), [&](const z3::expr &v) {
+                return z3::eq(v, e.term);
+            }), constraint_val_list.end());
+            auto ids = constraint_val_expr_idmap.find(name);
+            if (ids == constraint_val_expr_idmap.end()) {
+                continue;
+            }
+            for (const auto &var: constraint_val_list) {
+                if (!occurs(e.definition, var)) {
+                    continue;
+                }
+                auto &dst = constraint_val_expr_idmap[var.to_string()];
+                dst.insert(dst.end(), ids->second.begin(), ids->second.end());
+            }
+            constraint_val_expr_idmap.erase(ids);
+            println_local("eliminated {} := {}", m_ir.to_string(e.target), e.definition.to_string());
+        }
+        m_metrics.terms_eliminated += m_eliminated.size();
+    }
+    void CConstraintVisitor::classify_gaussian() {
+        for (auto &g: m_gaussian_cons) {
+            g.path = json_path(g.target);
+            // 反例模式下上下界可能被翻转，仍交给求解器
+            if (positive != 'P' || !g.path) {
+                continue;
+            }
+            auto type = leaf_type(g.target);
+            g.integral = type == SymbolTableEntryType::Int32 || type == SymbolTableEntryType::Int64 ||
+                         type == SymbolTableEntryType::UInt32 || type == SymbolTableEntryType::UInt64;
+            bool coupled = false;
+            for (auto root: m_constraint_roots) {
+                if (!collect_gaussian_bounds(root, g)) {
+                    coupled = true;
+                    break;
+                }
+            }
+            if (g.integral) {
+                g.lo = std::ceil(g.lo);
+                g.hi = std::floor(g.hi);
+            }
+            g.post_sample = !coupled && g.lo <= g.hi;
+            info("GAUSSIAN var ", m_ir.to_string(g.target), g.post_sample ? " sampled after solving" : " solved with equality");
+        }
+    }
+    bool CConstraintVisitor::collect_gaussian_bounds(ir::NodeId root, GaussianCons &g) {
+        if (!mentions(root, g.target)) {
+            return true;
+        }
+        const auto op = m_ir.op(root);
+        if (op == ir::Op::And) {
+            for (uint32_t i = 0; i < m_ir.num_args(root); ++i) {
+                if (!collect_gaussian_bounds(m_ir.arg(root, i), g)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (!ir::Arena::is_comparison(op) || op == ir::Op::Ne) {
+            return false;
+        }
+        // 统一成 target op c 的形式
+        auto lhs = m_ir.arg(root, 0), rhs = m_ir.arg(root, 1);
+        bool mirrored = false;
+        if (rhs == g.target) {
+            std::swap(lhs, rhs);
+            mirrored = true;
+        }
+        auto c = m_ir.linear(rhs);
+        if (lhs != g.target || !c || !c->coeffs.empty()) {
+            return false;
+        }
+        const double v = c->constant;
+        const double below = g.integral ? std::ceil(v) - 1 : std::nextafter(v, -std::numeric_limits<double>::infinity());
+        const double above = g.integral ? std::floor(v) + 1 : std::nextafter(v, std::numeric_limits<double>::infinity());
+        auto effective = op;
+        if (mirrored) {
+            effective = op == ir::Op::Lt ? ir::Op::Gt : op == ir::Op::Gt ? ir::Op::Lt : op == ir::Op::Le ? ir::Op::Ge : op == ir::Op::Ge ? ir::Op::Le : op;
+        }
+        switch (effective) {
+            case ir::Op::Lt:
+                g.hi = std::min(g.hi, below);
+                break;
+            case ir::Op::Le:
+                g.hi = std::min(g.hi, v);
+                break;
+            case ir::Op::Gt:
+                g.lo = std::max(g.lo, above);
+                break;
+            case ir::Op::Ge:
+                g.lo = std::max(g.lo, v);
+                break;
+            case ir::Op::Eq:
+                g.lo = std::max(g.lo, v);
+                g.hi = std::min(g.hi, v);
+                break;
+            default:
+                unreachable();
+        }
+        return true;
+    }
+    bool CConstraintVisitor::mentions(ir::NodeId id, ir::NodeId target) const {
+        if (id == target) {
+            return true;
+        }
+        for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+            if (mentions(m_ir.arg(id, i), target)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    std::optional<nlohmann::json::json_pointer> CConstraintVisitor::json_path(ir::NodeId id) const {
+        std::string path{};
+        while (m_ir.op(id) != ir::Op::Var) {
+            if (m_ir.op(id) == ir::Op::Field) {
+                path.insert(0, "/" + m_ir.name(id));
+            } else if (m_ir.op(id) == ir::Op::Index && m_ir.op(m_ir.arg(id, 1)) == ir::Op::ConstInt) {
+                path.insert(0, "/" + std::to_string(m_ir.int_value(m_ir.arg(id, 1))));
+            } else {
+                return std::nullopt;
+            }
+            id = m_ir.arg(id, 0);
+        }
+        return nlohmann::json::json_pointer("/" + m_ir.name(id) + path);
+    }
+    double CConstraintVisitor::sample_truncated_normal(GaussianCons &g) {
+        const double mu = g.normal_gen.mean(), sigma = g.normal_gen.stddev();
+        auto fit = [&](double v) {
+            if (g.integral) {
+                v = std::round(v);
+            }
+            return std::clamp(v, g.lo, g.hi);
+        };
+        if (!(sigma > 0)) {
+            return fit(mu);
+        }
+        auto cdf = [&](double x) {
+            return 0.5 * std::erfc(-(x - mu) / (sigma * std::sqrt(2.0)));
+        };
+        const double pa = cdf(g.lo), pb = cdf(g.hi);
+        // 区间内概率质量足够大时直接拒绝采样，否则按逆CDF在[Φ(lo), Φ(hi)]内均匀取
+        if (pb - pa > 0.25) {
+            for (int i = 0; i < 64; ++i) {
+                auto v = g.normal_gen(random_g);
+                if (g.integral) {
+                    v = std::round(v);
+                }
+                if (v >= g.lo && v <= g.hi) {
+                    return v;
+                }
+            }
+        }
+        if (!(pb > pa)) {
+            // 区间远在尾部，概率质量在double下为0
+            return fit(mu);
+        }
+        std::uniform_real_distribution<> u(pa, pb);
+        return fit(mu + sigma * inverse_normal_cdf(u(random_g)));
+    }
+    void CConstraintVisitor::apply_gaussian_samples(json &solve) {
+        for (auto &g: m_gaussian_cons) {
+            if (!g.post_sample || !solve.contains(*g.path)) {
+                continue;
+            }
+            auto v = sample_truncated_normal(g);
+            if (g.integral) {
+                solve[*g.path] = static_cast<int64_t>(v);
+            } else {
+                solve[*g.path] = v;
+            }
+        }
+    }
+    void CConstraintVisitor::record_gaussian_samples(const json &solve) {
+        for (const auto &g: m_gaussian_cons) {
+            if (!g.path || !solve.contains(*g.path) || !solve[*g.path].is_number()) {
+                continue;
+            }
+            auto name = m_ir.to_string(g.target);
+            auto [it, inserted] = m_metrics.gaussian.try_emplace(name);
+            if (inserted) {
+                it->second.mu = g.normal_gen.mean();
+                it->second.sigma = g.normal_gen.stddev();
+            }
+            it->second.add(solve[*g.path].get<double>());
+        }
+    }
+    std::optional<std::pair<ir::NodeId, std::vector<int>>> CConstraintVisitor::constant_index_path(ir::NodeId id) {
+        std::vector<int> idx{};
+        while (m_ir.op(id) == ir::Op::Index) {
+            auto i = m_ir.arg(id, 1);
+            if (m_ir.op(i) != ir::Op::ConstInt) {
+                return std::nullopt;
+            }
+            idx.insert(idx.begin(), static_cast<int>(m_ir.int_value(i)));
+            id = m_ir.arg(id, 0);
+        }
+        if (m_ir.op(id) != ir::Op::Var) {
+            return std::nullopt;
+        }
+        return std::make_pair(id, std::move(idx));
+    }
+    void CConstraintVisitor::scan_array_uses(ir::NodeId id) {
+        // 只有所有使用都是完整的常量下标时，数组才能展平为逐元素的标量
+        if (m_ir.op(id) == ir::Op::Index) {
+            if (auto path = constant_index_path(id)) {
+                const auto *entry = m_symbol_table.lookup_entry(m_ir.name(path->first));
+                if (entry != nullptr && entry->qualifer == SymbolTableEntryQualifer::Array && path->second.size() == entry->dims.size()) {
+                    bool in_bounds = true;
+                    for (size_t d = 0; d < entry->dims.size(); ++d) {
+                        in_bounds = in_bounds && path->second[d] >= 0 && path->second[d] < entry->dims[d];
+                    }
+                    if (in_bounds) {
+                        return;
+                    }
+                }
+            }
+        }
+        if (m_ir.op(id) == ir::Op::Var) {
+            const auto *entry = m_symbol_table.lookup_entry(m_ir.name(id));
+            if (entry != nullptr && entry->qualifer == SymbolTableEntryQualifer::Array) {
+                m_nested_arrays.insert(m_ir.name(id));
+            }
+            return;
+        }
+        for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+            scan_array_uses(m_ir.arg(id, i));
+        }
+    }
+    void CConstraintVisitor::scan_struct_uses(ir::NodeId id) {
+        // 成员都以a[c].m这样的常量路径访问，成员数组也只按完整的常量下标访问时，结构体变量才能展平
+        auto to_tuple = [&](ir::NodeId node) {
+            while (m_ir.op(node) == ir::Op::Index || m_ir.op(node) == ir::Op::Field) {
+                node = m_ir.arg(node, 0);
+            }
+            if (m_ir.op(node) == ir::Op::Var) {
+                m_tuple_structs.insert(m_ir.name(node));
+            }
+        };
+        auto node = id;
+        std::vector<ir::NodeId> indices{};
+        while (m_ir.op(node) == ir::Op::Index) {
+            indices.insert(indices.begin(), m_ir.arg(node, 1));
+            node = m_ir.arg(node, 0);
+        }
+        if (m_ir.op(node) != ir::Op::Field) {
+            for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+                scan_struct_uses(m_ir.arg(id, i));
+            }
+            return;
+        }
+        const SymbolTableEntry *member = nullptr;
+        if (auto path = constant_index_path(m_ir.arg(node, 0))) {
+            const auto *entry = m_symbol_table.lookup_entry(m_ir.name(path->first));
+            if (entry != nullptr && entry->type == SymbolTableEntryType::Struct) {
+                const auto &members = m_struct_blueprints.at(entry->struct_name).m_members;
+                auto it = members.find(m_ir.name(node));
+                member = it == members.end() ? nullptr : &it->second;
+            }
+        }
+        bool flat = member != nullptr && member->type != SymbolTableEntryType::Struct;
+        if (flat && member->qualifer == SymbolTableEntryQualifer::Primary) {
+            flat = indices.empty();
+        } else if (flat && member->qualifer == SymbolTableEntryQualifer::Array) {
+            flat = indices.size() == member->dims.size();
+            for (size_t d = 0; flat && d < indices.size(); ++d) {
+                const auto i = indices[d];
+                flat = m_ir.op(i) == ir::Op::ConstInt && m_ir.int_value(i) >= 0 && m_ir.int_value(i) < member->dims[d];
+            }
+        } else if (flat && member->qualifer == SymbolTableEntryQualifer::Pointer) {
+            // 有界编码下非常量下标经槽位的lambda访问
+            flat = m_pointer_encoding == PointerEncoding::Bounded && indices.size() <= 1;
+        }
+        if (!flat) {
+            to_tuple(node);
+        }
+        for (auto i: indices) {
+            scan_struct_uses(i);
+        }
+        for (auto base = m_ir.arg(node, 0); m_ir.op(base) == ir::Op::Index; base = m_ir.arg(base, 0)) {
+            scan_struct_uses(m_ir.arg(base, 1));
+        }
+    }
+    bool CConstraintVisitor::is_flat_struct(const std::string &name, const SymbolTableEntry &entry) const {
+        return m_struct_encoding == StructEncoding::Flat && entry.type == SymbolTableEntryType::Struct &&
+               m_tuple_structs.count(name) == 0 && m_whole_referenced.count(name) == 0 &&
+               (entry.qualifer == SymbolTableEntryQualifer::Primary || is_flat_array(name, entry));
+    }
+    std::optional<std::pair<std::string, const SymbolTableEntry *>> CConstraintVisitor::flat_member(ir::NodeId field) {
+        if (m_ir.op(field) != ir::Op::Field) {
+            return std::nullopt;
+        }
+        auto path = constant_index_path(m_ir.arg(field, 0));
+        if (!path) {
+            return std::nullopt;
+        }
+        const auto &var = m_ir.name(path->first);
+        const auto *entry = m_symbol_table.lookup_entry(var);
+        if (entry == nullptr || !is_flat_struct(var, *entry)) {
+            return std::nullopt;
+        }
+        const auto &members = m_struct_blueprints.at(entry->struct_name).m_members;
+        auto it = members.find(m_ir.name(field));
+        if (it == members.end()) {
+            panic("no member named \"" + m_ir.name(field) + "\".");
+        }
+        return std::make_pair(make_member_name(var, m_ir.name(field), path->second), &it->second);
+    }
+    void CConstraintVisitor::scan_references(ir::NodeId id) {
+        const auto op = m_ir.op(id);
+        if (op == ir::Op::Field) {
+            // 找到a[i].m或a.m中的a
+            auto base = m_ir.arg(id, 0);
+            while (m_ir.op(base) == ir::Op::Index) {
+                scan_references(m_ir.arg(base, 1));
+                base = m_ir.arg(base, 0);
+            }
+            if (m_ir.op(base) == ir::Op::Var) {
+                m_referenced_vars.insert(m_ir.name(base));
+                m_referenced_members.emplace(m_ir.name(base), m_ir.name(id));
+                return;
+            }
+            scan_references(base);
+            return;
+        }
+        if (op == ir::Op::Var) {
+            m_referenced_vars.insert(m_ir.name(id));
+            m_whole_referenced.insert(m_ir.name(id));
+            return;
+        }
+        for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+            scan_references(m_ir.arg(id, i));
+        }
+    }
+    json CConstraintVisitor::random_value(const SymbolTableEntry &entry, bool element) {
+        if (!element && entry.qualifer == SymbolTableEntryQualifer::Array) {
+            std::function<json(size_t)> fill = [&](size_t depth) {
+                auto ret = json::array();
+                for (int i = 0; i < entry.dims[depth]; ++i) {
+                    ret.push_back(depth + 1 < entry.dims.size() ? fill(depth + 1) : random_value(entry, true));
+                }
+                return ret;
+            };
+            return fill(0);
+        }
+        if (!element && entry.qualifer == SymbolTableEntryQualifer::Pointer) {
+            std::uniform_int_distribution<int> length_dist(1, m_max_pointer_length);
+            auto ret = json::array();
+            for (int i = length_dist(random_g); i > 0; --i) {
+                ret.push_back(random_value(entry, true));
+            }
+            return ret;
+        }
+        switch (entry.type) {
+            case SymbolTableEntryType::Int32:
+                return std::uniform_int_distribution<int32_t>(INT32_MIN, INT32_MAX)(random_g);
+            case SymbolTableEntryType::UInt32:
+                return std::uniform_int_distribution<uint32_t>(0, UINT32_MAX)(random_g);
+            case SymbolTableEntryType::Int64:
+                return std::uniform_int_distribution<int64_t>(INT64_MIN, INT64_MAX)(random_g);
+            case SymbolTableEntryType::UInt64:
+                return std::uniform_int_distribution<uint64_t>(0, UINT64_MAX)(random_g);
+            case SymbolTableEntryType::Float32:
+            case SymbolTableEntryType::Float64:
+                // 浮点不取整个表示范围，与整数变量的取值范围一致
+                return std::uniform_real_distribution<double>(INT32_MIN, INT32_MAX)(random_g);
+            case SymbolTableEntryType::Struct: {
+                auto ret = json::object();
+                for (const auto &[member_name, member_entry]: m_struct_blueprints.at(entry.struct_name).m_members) {
+                    ret[member_name] = random_value(member_entry);
+                }
+                return ret;
+            }
+            default:
+                unreachable();
+        }
+    }
+    z3::expr CConstraintVisitor::emit_arithmetic(ir::NodeId id) {
+        const bool uns = is_unsigned(id);
+        auto [l, r] = unify(emit(m_ir.arg(id, 0)), emit(m_ir.arg(id, 1)), uns);
+        switch (m_ir.op(id)) {
+            case ir::Op::Add:
+                return l + r;
+            case ir::Op::Sub:
+                return l - r;
+            case ir::Op::Mul:
+                return l * r;
+            case ir::Op::Div:
+                return l.is_bv() && uns ? z3::udiv(l, r) : l / r;
+            case ir::Op::Mod:
+                if (l.is_bv()) {
+                    // C的%是截断取余
+                    return uns ? z3::urem(l, r) : z3::srem(l, r);
+                }
+                return l % r;
+            default:
+                unreachable();
+        }
+    }
+    z3::expr CConstraintVisitor::emit_bitwise(ir::NodeId id) {
+        if (!m_bitvec) {
+            panic("bitwise operation not supported since we dont use bitvec theory, try --bitvec.");
+        }
+        if (m_ir.op(id) == ir::Op::BitNot) {
+            auto e = emit(m_ir.arg(id, 0));
+            if (!e.is_bv()) {
+                e = m_solver_context.bv_val(static_cast<int64_t>(e.get_numeral_int64()), 32);
+            }
+            return ~e;
+        }
+        const bool uns = is_unsigned(id);
+        auto [l, r] = unify(emit(m_ir.arg(id, 0)), emit(m_ir.arg(id, 1)), uns);
+        if (!l.is_bv()) {
+            // 两侧都是整数常量，按int处理
+            l = m_solver_context.bv_val(static_cast<int64_t>(l.get_numeral_int64()), 32);
+            r = m_solver_context.bv_val(static_cast<int64_t>(r.get_numeral_int64()), 32);
+        }
+        switch (m_ir.op(id)) {
+            case ir::Op::Shl:
+                return z3::shl(l, r);
+            case ir::Op::Shr:
+                return uns ? z3::lshr(l, r) : z3::ashr(l, r);
+            case ir::Op::BitAnd:
+                return l & r;
+            case ir::Op::BitOr:
+                return l | r;
+            case ir::Op::BitXor:
+                return l ^ r;
+            default:
+                unreachable();
+        }
+    }
+    std::pair<z3::expr, z3::expr> CConstraintVisitor::unify(z3::expr a, z3::expr b, bool is_unsigned) {
+        if (a.is_bv() && b.is_bv()) {
+            // 宽度不同时扩展较窄的一侧
+            const auto wa = a.get_sort().bv_size();
+            const auto wb = b.get_sort().bv_size();
+            if (wa < wb) {
+                a = is_unsigned ? z3::zext(a, wb - wa) : z3::sext(a, wb - wa);
+            } else if (wb < wa) {
+                b = is_unsigned ? z3::zext(b, wa - wb) : z3::sext(b, wa - wb);
+            }
+        } else if (a.is_bv() || b.is_bv()) {
+            auto &bv = a.is_bv() ? a : b;
+            auto &other = a.is_bv() ? b : a;
+            const auto width = bv.get_sort().bv_size();
+            if (other.is_int()) {
+                other = other.is_numeral() ? m_solver_context.bv_val(static_cast<int64_t>(other.get_numeral_int64()), width) : z3::int2bv(width, other);
+            } else if (other.is_real()) {
+                bv = z3::to_real(z3::bv2int(bv, !is_unsigned));
+            }
+        }
+        return {a, b};
+    }
+    z3::expr CConstraintVisitor::as_index(const z3::expr &idx) {
+        return idx.is_bv() ? z3::bv2int(idx, true) : idx;
+    }
+    std::optional<SymbolTableEntryType> CConstraintVisitor::leaf_type(ir::NodeId id) {
+        switch (m_ir.op(id)) {
+            case ir::Op::Var: {
+                const auto *entry = m_symbol_table.lookup_entry(m_ir.name(id));
+                return entry == nullptr ? std::nullopt : std::optional{entry->type};
+            }
+            case ir::Op::Index:
+                return leaf_type(m_ir.arg(id, 0));
+            case ir::Op::Field: {
+                auto base = m_ir.arg(id, 0);
+                while (m_ir.op(base) == ir::Op::Index) {
+                    base = m_ir.arg(base, 0);
+                }
+                if (m_ir.op(base) != ir::Op::Var) {
+                    return std::nullopt;
+                }
+                const auto *entry = m_symbol_table.lookup_entry(m_ir.name(base));
+                if (entry == nullptr || entry->type != SymbolTableEntryType::Struct) {
+                    return std::nullopt;
+                }
+                const auto &members = m_struct_blueprints.at(entry->struct_name).m_members;
+                auto it = members.find(m_ir.name(id));
+                return it == members.end() ? std::nullopt : std::optional{it->second.type};
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+    bool CConstraintVisitor::is_unsigned(ir::NodeId id) {
+        switch (m_ir.op(id)) {
+            case ir::Op::Var:
+            case ir::Op::Index:
+            case ir::Op::Field: {
+                auto type = leaf_type(id);
+                return type == SymbolTableEntryType::UInt32 || type == SymbolTableEntryType::UInt64;
+            }
+            case ir::Op::Neg:
+            case ir::Op::BitNot:
+            case ir::Op::Shl:
+            case ir::Op::Shr:
+                return is_unsigned(m_ir.arg(id, 0));
+            case ir::Op::Add:
+            case ir::Op::Sub:
+            case ir::Op::Mul:
+            case ir::Op::Div:
+            case ir::Op::Mod:
+            case ir::Op::BitAnd:
+            case ir::Op::BitOr:
+            case ir::Op::BitXor:
+                return is_unsigned(m_ir.arg(id, 0)) || is_unsigned(m_ir.arg(id, 1));
+            default:
+                return false;
+        }
+    }
+    std::optional<z3::expr> CConstraintVisitor::emit_bounded_element(ir::NodeId id) {
+        auto base = m_ir.arg(id, 0);
+        std::optional<z3::expr> idx{};
+        std::optional<z3::expr> element{};
+        std::optional<z3::expr> length{};
+        // 指针变量或展平的结构体的指针成员，槽位都是标量
+        std::optional<std::pair<std::string, const SymbolTableEntry *>> pointer{};
+        if (m_ir.op(base) == ir::Op::Var) {
+            pointer.emplace(m_ir.name(base), m_symbol_table.lookup_entry(m_ir.name(base)));
+        } else {
+            pointer = flat_member(base);
+        }
+        if (pointer && (pointer->second == nullptr || pointer->second->qualifer != SymbolTableEntryQualifer::Pointer)) {
+            return std::nullopt;
+        }
+        if (pointer) {
+            const auto &name = pointer->first;
+            const auto *entry = pointer->second;
+            length = bounded_length(base);
+            idx = as_index(emit(m_ir.arg(id, 1)));
+            if (m_ir.op(m_ir.arg(id, 1)) == ir::Op::ConstInt) {
+                auto i = m_ir.int_value(m_ir.arg(id, 1));
+                if (i < 0 || i >= m_max_pointer_length) {
+                    panic("index " + std::to_string(i) + " of \"" + name + "\" exceeds the maximum pointer length.");
+                }
+                element = flat_element(name, *entry, {static_cast<int>(i)});
+            } else {
+                // 非常量下标：对同一指针的所有访问共用一个槽位上的lambda，每次访问只是一个select
+                element = z3::select(bounded_slots(name, *entry), *idx);
+            }
+        } else if (m_ir.op(base) == ir::Op::Field) {
+            auto object = emit(m_ir.arg(base, 0));
+            const auto *blueprint = find_blueprint(object.get_sort());
+            const auto &field = m_ir.name(base);
+            if (blueprint == nullptr || blueprint->m_members.count(field) == 0 ||
+                blueprint->m_members.at(field).qualifer != SymbolTableEntryQualifer::Pointer) {
+                return std::nullopt;
+            }
+            length = bounded_length(base);
+            idx = as_index(emit(m_ir.arg(id, 1)));
+            element = z3::select(find_getter(*blueprint, field)(object), *idx);
+        } else {
+            return std::nullopt;
+        }
+        auto guard = *idx >= 0 && *idx < *length;
+        m_index_guards.emplace(id, guard);
+        m_pending_guards.push_back(guard);
+        return element;
+    }
+    z3::expr CConstraintVisitor::bounded_slots(const std::string &name, const SymbolTableEntry &entry) {
+        auto it = m_slot_arrays.find(name);
+        if (it != m_slot_arrays.end()) {
+            return it->second;
+        }
+        // 约束变量名不会含'!'，不会被lambda捕获
+        auto i = m_solver_context.int_const("!slot");
+        auto body = flat_element(name, entry, {m_max_pointer_length - 1});
+        for (int k = m_max_pointer_length - 2; k >= 0; --k) {
+            body = z3::ite(i == k, flat_element(name, entry, {k}), body);
+        }
+        return m_slot_arrays.emplace(name, z3::lambda(i, body)).first->second;
+    }
+    z3::expr CConstraintVisitor::bounded_length(ir::NodeId pointer) {
+        std::optional<z3::expr> length{};
+        auto member = flat_member(pointer);
+        if (m_ir.op(pointer) == ir::Op::Var || member) {
+            const auto &name = member ? member->first : m_ir.name(pointer);
+            auto it = m_flat_elements.find(make_length_name(name));
+            if (it != m_flat_elements.end()) {
+                return it->second;
+            }
+            const auto *entry = member ? member->second : m_symbol_table.lookup_entry(name);
+            if (entry == nullptr || entry->qualifer != SymbolTableEntryQualifer::Pointer) {
+                panic("_LENGTH expects a pointer.");
+            }
+            length = m_flat_elements.emplace(make_length_name(name), m_solver_context.int_const(make_length_name(name).c_str())).first->second;
+        } else if (m_ir.op(pointer) == ir::Op::Field) {
+            auto object = emit(m_ir.arg(pointer, 0));
+            const auto *blueprint = find_blueprint(object.get_sort());
+            if (blueprint == nullptr) {
+                panic("_LENGTH expects a pointer.");
+            }
+            length = find_getter(*blueprint, make_length_name(m_ir.name(pointer)))(object);
+        } else {
+            panic("_LENGTH expects a pointer.");
+        }
+        if (m_ranged_terms.insert(length->id()).second) {
+            // 与seq编码及random_value中未引用指针的长度一致
+            add_domain_constraint(*length >= 1 && *length <= m_max_pointer_length);
+            m_var_bounds.emplace(length->to_string(), std::make_pair(int64_t{1}, int64_t{m_max_pointer_length}));
+        }
+        return *length;
+    }
+    void CConstraintVisitor::add_domain_constraint(const z3::expr &cons) {
+        m_smt_solver.add(cons);
+        m_domain_constraints.push_back(cons);
+        m_domain_constraint_ids.insert(cons.id());
+    }
+    void CConstraintVisitor::add_type_domain(const z3::expr &term, SymbolTableEntryType type) {
+        // 位向量的宽度本身就是范围
+        if (!term.is_int() || !m_ranged_terms.insert(term.id()).second) {
+            return;
+        }
+        int64_t lo = 0, hi = 0;
+        switch (type) {
+            case SymbolTableEntryType::Int32:
+                lo = INT32_MIN, hi = INT32_MAX;
+                add_domain_constraint(term >= m_solver_context.int_val(lo) && term <= m_solver_context.int_val(hi));
+                break;
+            case SymbolTableEntryType::UInt32:
+                lo = 0, hi = UINT32_MAX;
+                add_domain_constraint(term >= 0 && term <= m_solver_context.int_val(hi));
+                break;
+            case SymbolTableEntryType::Int64:
+                lo = INT64_MIN, hi = INT64_MAX;
+                add_domain_constraint(term >= m_solver_context.int_val(lo) && term <= m_solver_context.int_val(hi));
+                break;
+            case SymbolTableEntryType::UInt64:
+                // mutateVar只在int64范围内取值
+                lo = 0, hi = INT64_MAX;
+                add_domain_constraint(term >= 0 && term <= m_solver_context.int_val(uint64_t{UINT64_MAX}));
+                break;
+            default:
+                return;
+        }
+        m_var_bounds.emplace(term.to_string(), std::make_pair(lo, hi));
+    }
+    z3::expr CConstraintVisitor::int_value_of(const z3::sort &sort, int64_t v) {
+        return sort.is_bv() ? m_solver_context.bv_val(v, sort.bv_size()) : m_solver_context.int_val(v);
+    }
+    void CConstraintVisitor::register_blueprint(const std::string &name, StructBlueprint blueprint) {
+        for (unsigned i = 0; i < blueprint.sym_getters->size(); ++i) {
+            blueprint.m_getter_index.emplace((*blueprint.sym_getters)[i].name().str(), i);
+        }
+        auto [it, inserted] = m_struct_blueprints.insert({name, std::move(blueprint)});
+        if (inserted) {
+            m_blueprint_by_sort.emplace(it->second.sym_constructor->range().id(), &it->second);
+        }
+    }
+    const StructBlueprint *CConstraintVisitor::find_blueprint(const z3::sort &sort) const {
+        auto it = m_blueprint_by_sort.find(sort.id());
+        return it == m_blueprint_by_sort.end() ? nullptr : it->second;
+    }
+    z3::func_decl CConstraintVisitor::find_getter(const StructBlueprint &blueprint, const std::string &field) const {
+        auto it = blueprint.m_getter_index.find(field);
+        if (it == blueprint.m_getter_index.end()) {
+            panic("no member named \"" + field + "\".");
+        }
+        return (*blueprint.sym_getters)[it->second];
+    }
+    bool CConstraintVisitor::is_large_array(const SymbolTableEntry &entry) const {
+        if (entry.qualifer != SymbolTableEntryQualifer::Array || entry.type == SymbolTableEntryType::Struct) {
+            return false;
+        }
+        size_t count = 1;
+        for (auto d: entry.dims) {
+            count *= d;
+        }
+        return count >= LARGE_ARRAY_ELEMENTS;
+    }
+    json CConstraintVisitor::process_sparse_array(const std::string &name, const SymbolTableEntry &entry, const z3::model &model) {
+        // 其余元素写出时由种子生成，用例只保存被约束引用的元素
+        auto ret = SparseArray::make(entry.dims, random_g());
+        if (auto indices = m_flat_indices.find(name); indices != m_flat_indices.end()) {
+            for (const auto &idx: indices->second) {
+                SparseArray::set(ret, entry.dims, idx, z3_value_to_json(model.eval(flat_element(name, entry, idx), true), entry, model));
+            }
+        }
+        return ret;
+    }
+    bool CConstraintVisitor::is_flat_array(const std::string &name, const SymbolTableEntry &entry) const {
+        // 大数组在Nested编码下也展平，否则提取时要逐个元素求值、构造完整的json
+        return (m_array_encoding == ArrayEncoding::Flat || is_large_array(entry)) && entry.qualifer == SymbolTableEntryQualifer::Array &&
+               m_nested_arrays.count(name) == 0;
+    }
+    z3::expr CConstraintVisitor::flat_element(const std::string &name, const SymbolTableEntry &entry, const std::vector<int> &idx) {
+        auto element_name = make_element_name(name, idx);
+        auto it = m_flat_elements.find(element_name);
+        if (it == m_flat_elements.end()) {
+            it = m_flat_elements.emplace(element_name, m_solver_context.constant(element_name.c_str(), element_sort(entry))).first;
+            m_flat_indices[name].push_back(idx);
+        }
+        return it->second;
+    }
     std::any CConstraintVisitor::visitFunctionDefinition(c11parser::CParser::FunctionDefinitionContext *ctx) {
         bool process_constraints = false;
         info("process function definition", ctx->getText());
@@ -54,6 +1022,7 @@ namespace ststgen {
             m_symbol_table.push_scope();
             m_cons_src = ctx->compoundStatement()->getText();
             visit(ctx->compoundStatement());
+            emitConstraints();
             m_symbol_table.pop_scope();
         }
         return 0;
@@ -71,17 +1040,15 @@ namespace ststgen {
         StructBlueprint blueprint{};
         std::vector<z3::sort> member_sorts{};
         std::vector<const char *> member_names{};
+        // 有界编码下指针成员额外的长度字段名，deque保证c_str()不失效
+        std::deque<std::string> length_field_names{};
+
+        ScalarTypeSpec scalar_spec{};
 
         for (auto typ: decl_list->declarationSpecifier()) {
             if (auto typ_s = typ->typeSpecifier()) {
-                if (typ_s->Char() || typ_s->Short() || typ_s->Int() || typ_s->Signed()) {
-                    base_type = SymbolTableEntryType::Int32;
-                } else if (typ_s->Long()) {
-                    base_type = SymbolTableEntryType::Int64;
-                } else if (typ_s->Unsigned()) {
-                    base_type = SymbolTableEntryType::UInt64;
-                } else if (typ_s->Float() || typ_s->Double()) {
-                    base_type = SymbolTableEntryType::Float64;
+                if (scalar_spec.add(typ_s)) {
+                    base_type = scalar_spec.type();
                 } else if (auto p_st = typ_s->structOrUnionSpecifier()) {
                     // 结构体
                     if (m_symbol_table.get_scope_level() > 1) {
@@ -101,29 +1068,14 @@ namespace ststgen {
                         // specifierQualifierList是没展平的列表结构
                         // 处理int a[5];的int部分
                         auto p = p_st_member->specifierQualifierList();
-                        auto base_typ_member = SymbolTableEntryType::None;
+                        ScalarTypeSpec member_spec{};
                         while (p != nullptr) {
                             if (auto typ_s_member = p->typeSpecifier()) {
-                                if (typ_s_member->Char() ||
-                                    typ_s_member->Short() ||
-                                    typ_s_member->Int() ||
-                                    typ_s_member->Signed()) {
-                                    base_typ_member = SymbolTableEntryType::Int32;
-                                    break;
-                                } else if (typ_s_member->Long()) {
-                                    base_typ_member = SymbolTableEntryType::Int64;
-                                    break;
-                                }
-                                else if (typ_s_member->Unsigned()) {
-                                    base_typ_member = SymbolTableEntryType::UInt64;
-                                    break;
-                                } else if (typ_s_member->Float() || typ_s_member->Double()) {
-                                    base_typ_member = SymbolTableEntryType::Float64;
-                                    break;
-                                }
+                                member_spec.add(typ_s_member);
                             }
                             p = p->specifierQualifierList();
                         }
+                        auto base_typ_member = member_spec.type();
                         if (base_typ_member == SymbolTableEntryType::None) {
                             panic("struct member base type not supported.");
                         }
@@ -192,37 +1144,31 @@ namespace ststgen {
 
                     for (const auto &[name, entry]: blueprint.m_members) {
                         member_names.emplace_back(name.c_str());
-                        // 0 for Int, 1 for Real
-                        int base_type = 0;
-                        if (entry.type == SymbolTableEntryType::Int32 ||
-                            entry.type == SymbolTableEntryType::Int64 ||
-                            entry.type == SymbolTableEntryType::UInt32 ||
-                            entry.type == SymbolTableEntryType::UInt64) {
-                            base_type = 0;
-                        } else if (entry.type == SymbolTableEntryType::Float32 || entry.type == SymbolTableEntryType::Float64) {
-                            base_type = 1;
-                        } else {
-                            unreachable();
-                        }
+                        auto base_sort = element_sort(entry);
                         if (entry.qualifer == SymbolTableEntryQualifer::Primary) {
-                            if (base_type == 0) {
-                                member_sorts.emplace_back(m_solver_context.int_sort());
-                            } else {
-                                member_sorts.emplace_back(m_solver_context.real_sort());
-                            }
-                        } else if (entry.qualifer == SymbolTableEntryQualifer::Array) {
-                            auto base_sort = base_type ? m_solver_context.real_sort() : m_solver_context.int_sort();
-                            base_sort = m_solver_context.seq_sort(base_sort);
                             member_sorts.emplace_back(base_sort);
+                        } else if (entry.qualifer == SymbolTableEntryQualifer::Array) {
+                            member_sorts.emplace_back(m_solver_context.seq_sort(base_sort));
                         } else if (entry.qualifer == SymbolTableEntryQualifer::Pointer) {
-                            // seq sort without length constraint
-                            auto base_sort = base_type ? m_solver_context.real_sort() : m_solver_context.int_sort();
-                            base_sort = m_solver_context.seq_sort(base_sort);
-                            member_sorts.emplace_back(base_sort);
+                            if (m_pointer_encoding == PointerEncoding::Bounded) {
+                                member_sorts.emplace_back(m_solver_context.array_sort(m_solver_context.int_sort(), base_sort));
+                            } else {
+                                // seq sort without length constraint
+                                member_sorts.emplace_back(m_solver_context.seq_sort(base_sort));
+                            }
                         } else {
                             unreachable();
                         }
                     }
+                    if (m_pointer_encoding == PointerEncoding::Bounded) {
+                        // 长度字段放在最后，不影响按m_members顺序取getter
+                        for (const auto &[name, entry]: blueprint.m_members) {
+                            if (entry.qualifer == SymbolTableEntryQualifer::Pointer) {
+                                member_names.emplace_back(length_field_names.emplace_back(make_length_name(name)).c_str());
+                                member_sorts.emplace_back(m_solver_context.int_sort());
+                            }
+                        }
+                    }
 
                     if (p_st->Identifier()) {
                         auto struct_name = p_st->Identifier()->getText();
@@ -232,7 +1178,7 @@ namespace ststgen {
                         blueprint.sym_constructor = struct_constructor;
                         info("member getter: ", member_getters.to_string());
                         blueprint.sym_getters = member_getters;
-                        m_struct_blueprints.insert({p_st->Identifier()->getText(), blueprint});
+                        register_blueprint(p_st->Identifier()->getText(), blueprint);
                     } else {
                         // 结构体的名字在typedef struct{...}后面
                         struct_typedef_ctx = true;
@@ -270,7 +1216,7 @@ namespace ststgen {
             blueprint.sym_getters = member_getters;
 
             info("member getter: ", member_getters.to_string());
-            m_struct_blueprints.insert({custom_struct_name, blueprint});
+            register_blueprint(custom_struct_name, blueprint);
             return 0;
         }
 
@@ -360,117 +1306,78 @@ namespace ststgen {
         }
         return 0;
     }
-    std::any CConstraintVisitor::visitPrimaryExpression(c11parser::CParser::PrimaryExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::PrimaryExpressionContext *ctx) {
         if (ctx->Identifier()) {
             auto name = ctx->Identifier()->getText();
             if (std::find(m_primitive.cbegin(), m_primitive.cend(), name) != m_primitive.cend()) {
-                // constraint primitives
-                return m_solver_context.string_val(name);
+                // constraint primitives, resolved by the enclosing call
+                return m_ir.var(name);
             }
-            if (auto sym = m_symbol_table.lookup_entry(name)->sym) {
-                return *sym;
+            if (auto entry = m_symbol_table.lookup_entry(name); entry != nullptr && entry->sym) {
+                return m_ir.var(name);
             }
             panic("can't find symbol \"" + name + "\".");
         }
         if (ctx->Constant()) {
             auto str = ctx->Constant()->getText();
             if (std::find(str.begin(), str.end(), '.') != str.end()) {
-                auto num = std::stod(str);
-                // 实数使用分数表示
-                return m_solver_context.real_val(num * 1000, 1000);
+                return m_ir.real_const(std::stod(str));
             } else {
-                // 整数
-                auto num = std::stoll(str);
-                return m_solver_context.int_val(num);
+                return m_ir.int_const(std::stoll(str));
             }
         }
         if (ctx->expression()) {
-            return visit(ctx->expression());
+            return lower(ctx->expression());
         }
         panic("can't parse expression.");
     }
-    std::any CConstraintVisitor::visitPostfixExpression(c11parser::CParser::PostfixExpressionContext *ctx) {
-        auto prime_expr = std::any_cast<z3::expr>(visit(ctx->primaryExpression()));
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::PostfixExpressionContext *ctx) {
+        auto prime_expr = lower(ctx->primaryExpression());
         for (auto p_post_op: ctx->postfixOp()) {
             if (p_post_op->expression() != nullptr) {
-                // indexing with seq theorem
-                auto idx = std::any_cast<z3::expr>(visit(p_post_op->expression()));
-                info("idx: ", idx.to_string());
-                info("seq: ", prime_expr.to_string());
-                // prime_expr = prime_expr.nth(idx);
-                prime_expr = prime_expr[idx];
+                prime_expr = m_ir.make(ir::Op::Index, {prime_expr, lower(p_post_op->expression())});
             } else if (p_post_op->argumentExpressionList() != nullptr) {
                 // function form constraints
-                if (!prime_expr.is_string_value()) {
+                if (m_ir.op(prime_expr) != ir::Op::Var ||
+                    std::find(m_primitive.cbegin(), m_primitive.cend(), m_ir.name(prime_expr)) == m_primitive.cend()) {
                     panic("not a function");
                 }
-                const auto func_name = prime_expr.get_string();
+                const auto func_name = m_ir.name(prime_expr);
+                auto args = lower(p_post_op->argumentExpressionList());
                 if (func_name == "_LENGTH") {
-                    auto t = visit(p_post_op->argumentExpressionList());
-                    auto args = std::any_cast<std::vector<z3::expr>>(t);
-                    // seq theorem length primitive
-                    prime_expr = args[0].length();
+                    stst_assert(args.size() == 1);
+                    prime_expr = m_ir.make(ir::Op::Length, {args[0]});
                 } else if (func_name == "GAUSSIAN") {
-                    auto t = visit(p_post_op->argumentExpressionList());
-                    auto args = std::any_cast<std::vector<z3::expr>>(t);
                     stst_assert(args.size() == 3);
-                    // stst_assert(args[0].is_const());
-                    stst_assert(args[1].is_numeral());
-                    stst_assert(args[2].is_numeral());
-                    // auto name = args[0].to_string();
-                    // C语法的字段访问似乎和json相似
-                    auto name = p_post_op->argumentExpressionList()->assignmentExpression(0)->getText();
-                    auto miu = args[1].as_double();
-                    auto sigma = args[2].as_double();
-                    // auto vari = m_symbol_table.lookup_entry(name);
-                    // vari->cons |= GAUSSIAN;
-                    // vari->miu = miu;
-                    // vari->sigma = sigma;
-                    m_gaussian_cons.emplace_back(args[0], miu, sigma);
-                    info("Found GAUSSIAN for var: ", args[0].to_string());
-                    return prime_expr;
+                    return m_ir.make(ir::Op::Gaussian, args);
                 } else {
                     info("constraint name: ", func_name);
                     panic("unknown function constraint name");
                 }
             } else if (p_post_op->Identifier() != nullptr) {
-                auto field = p_post_op->Identifier()->getText();
-                auto sort = prime_expr.get_sort();
-                for (const auto &bp: m_struct_blueprints) {
-                    // 找到对应struct/tuple的类型构造器
-                    if (z3::eq(sort, bp.second.sym_constructor->range())) {
-                        for (auto getter: *bp.second.sym_getters) {
-                            if (field == getter.name().str()) {
-                                // 找到对应project函数
-                                prime_expr = getter(prime_expr);
-                                goto field_outter;
-                            }
-                        }
-                    }
-                }
-            field_outter:
-                continue;
+                prime_expr = m_ir.field(prime_expr, p_post_op->Identifier()->getText());
             }
         }
         return prime_expr;
     }
-    std::any CConstraintVisitor::visitArgumentExpressionList(c11parser::CParser::ArgumentExpressionListContext *ctx) {
-        std::vector<z3::expr> args{};
-        for (auto p_expr: ctx->assignmentExpression()) {
-            auto ret = std::any_cast<z3::expr>(visit(p_expr));
-            args.emplace_back(ret);
+    std::vector<ir::NodeId> CConstraintVisitor::lower(c11parser::CParser::ArgumentExpressionListContext *ctx) {
+        std::vector<ir::NodeId> args{};
+        const auto &p_exprs = ctx->assignmentExpression();
+        args.reserve(p_exprs.size());
+        for (auto p_expr: p_exprs) {
+            args.push_back(lower(p_expr));
         }
         return args;
     }
-    std::any CConstraintVisitor::visitUnaryExpression(c11parser::CParser::UnaryExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::UnaryExpressionContext *ctx) {
         if (!ctx->PlusPlus().empty() || !ctx->MinusMinus().empty() || !ctx->Sizeof().empty()) {
             panic("sizeof, ++, -- are not supported.");
         }
         if (ctx->postfixExpression() != nullptr) {
-            return visit(ctx->postfixExpression());
+            return lower(ctx->postfixExpression());
         }
         if (ctx->castExpression() != nullptr) {
-            auto expr = std::any_cast<z3::expr>(visit(ctx->castExpression()));
+            auto expr = lower(ctx->castExpression());
             auto uop = ctx->unaryOperator()->getText();
             if (uop == "&") {
                 unimplemented();
@@ -482,197 +1389,379 @@ namespace ststgen {
                 return expr;
             }
             if (uop == "-") {
-                return -expr;
+                return m_ir.make(ir::Op::Neg, {expr});
             }
             if (uop == "!") {
-                return !expr;
+                return m_ir.make(ir::Op::Not, {expr});
             }
             if (uop == "~") {
-                panic("bitwise operators are not supported.");
+                return m_ir.make(ir::Op::BitNot, {expr});
             }
         }
         unreachable();
     }
 
-    std::any CConstraintVisitor::visitCastExpression(c11parser::CParser::CastExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::CastExpressionContext *ctx) {
         if (ctx->unaryExpression() == nullptr) {
             panic("cast expression is not implemented.");
         }
-        return visit(ctx->unaryExpression());
+        return lower(ctx->unaryExpression());
     }
-    std::any CConstraintVisitor::visitMultiplicativeExpression(c11parser::CParser::MultiplicativeExpressionContext *ctx) {
-        auto e = std::any_cast<z3::expr>(visit(ctx->castExpression(0)));
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::MultiplicativeExpressionContext *ctx) {
+        auto e = lower(ctx->castExpression(0));
         for (int i = 1; i < ctx->castExpression().size(); ++i) {
-            auto e2 = std::any_cast<z3::expr>(visit(ctx->castExpression(i)));
+            auto e2 = lower(ctx->castExpression(i));
             if (ctx->mulop(i - 1)->getText() == "*") {
-                e = e * e2;
+                e = m_ir.make(ir::Op::Mul, {e, e2});
             } else if (ctx->mulop(i - 1)->getText() == "/") {
-                e = e / e2;
+                e = m_ir.make(ir::Op::Div, {e, e2});
             } else {
                 info("% is generated, it might not be solved by z3 effectively.");
-                e = e % e2;
+                e = m_ir.make(ir::Op::Mod, {e, e2});
             }
         }
         return e;
     }
-    std::any CConstraintVisitor::visitAdditiveExpression(c11parser::CParser::AdditiveExpressionContext *ctx) {
-        auto e = std::any_cast<z3::expr>(visit(ctx->multiplicativeExpression(0)));
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::AdditiveExpressionContext *ctx) {
+        auto e = lower(ctx->multiplicativeExpression(0));
         for (int i = 1; i < ctx->multiplicativeExpression().size(); ++i) {
-            auto e2 = std::any_cast<z3::expr>(visit(ctx->multiplicativeExpression(i)));
-            if (ctx->addop(i - 1)->getText() == "+") {
-                e = e + e2;
-            } else {
-                e = e - e2;
-            }
+            auto e2 = lower(ctx->multiplicativeExpression(i));
+            e = m_ir.make(ctx->addop(i - 1)->getText() == "+" ? ir::Op::Add : ir::Op::Sub, {e, e2});
         }
         return e;
     }
-    std::any CConstraintVisitor::visitShiftExpression(c11parser::CParser::ShiftExpressionContext *ctx) {
-        auto p_sub = ctx->additiveExpression();
-        if (p_sub.size() > 1) {
-            panic("bitwise operation not supported since we dont use bitvec theory.");
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::ShiftExpressionContext *ctx) {
+        auto e = lower(ctx->additiveExpression(0));
+        for (int i = 1; i < ctx->additiveExpression().size(); ++i) {
+            auto e2 = lower(ctx->additiveExpression(i));
+            // children: additive (op additive)*
+            e = m_ir.make(ctx->children[2 * i - 1]->getText() == "<<" ? ir::Op::Shl : ir::Op::Shr, {e, e2});
         }
-        return visit(p_sub[0]);
+        return e;
     }
-    std::any CConstraintVisitor::visitRelationalExpression(c11parser::CParser::RelationalExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::RelationalExpressionContext *ctx) {
         if (ctx->shiftExpression().size() > 2) {
             panic("chain < <= > >= not work as expected most of time thus not allowed");
         }
         if (ctx->shiftExpression().size() == 1) {
-            return visit(ctx->shiftExpression().front());
+            return lower(ctx->shiftExpression().front());
         }
-
-        auto clause0 = std::any_cast<z3::expr>(visit(ctx->shiftExpression()[0]));
-        auto clause1 = std::any_cast<z3::expr>(visit(ctx->shiftExpression()[1]));
-        // info(clause0.to_string());
-        // info(clause1.to_string());
-
-        std::any res;
-
-        if (ctx->relop(0)->getText() == "<") {
-            res = clause0 < clause1;
-        } else if (ctx->relop(0)->getText() == "<=") {
-            res = clause0 <= clause1;
-        } else if (ctx->relop(0)->getText() == ">=") {
-            res = clause0 >= clause1;
-        } else if (ctx->relop(0)->getText() == ">") {
-            res = clause0 > clause1;
-        } else {
-            unreachable();
+        auto clause0 = lower(ctx->shiftExpression()[0]);
+        auto clause1 = lower(ctx->shiftExpression()[1]);
+        const auto op = ctx->relop(0)->getText();
+        if (op == "<") {
+            return m_ir.make(ir::Op::Lt, {clause0, clause1});
         }
-
-        all_expr_vector.push_back(std::any_cast<z3::expr>(res));
-        unsigned id = all_expr_vector.size() - 1;
-
-        update_constraint_val_map(clause0, id);
-        update_constraint_val_map(clause1, id);
-
-        return res;
+        if (op == "<=") {
+            return m_ir.make(ir::Op::Le, {clause0, clause1});
+        }
+        if (op == ">=") {
+            return m_ir.make(ir::Op::Ge, {clause0, clause1});
+        }
+        if (op == ">") {
+            return m_ir.make(ir::Op::Gt, {clause0, clause1});
+        }
+        unreachable();
     }
 
-    std::any CConstraintVisitor::visitEqualityExpression(c11parser::CParser::EqualityExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::EqualityExpressionContext *ctx) {
         if (ctx->relationalExpression().size() > 2) {
             panic("chain == != not work as expected most of time thus not allowed");
         }
         if (ctx->relationalExpression().size() == 1) {
-            return visit(ctx->relationalExpression().front());
+            return lower(ctx->relationalExpression().front());
         }
-        auto clause0 = std::any_cast<z3::expr>(visit(ctx->relationalExpression()[0]));
-        auto clause1 = std::any_cast<z3::expr>(visit(ctx->relationalExpression()[1]));
-
-        std::any res;
-        if (ctx->eqop(0)->getText() == "!=") {
-            res = clause0 != clause1;
-        } else if (ctx->eqop(0)->getText() == "==") {
-            res = clause0 == clause1;
-        } else {
-            unreachable();
+        auto clause0 = lower(ctx->relationalExpression()[0]);
+        auto clause1 = lower(ctx->relationalExpression()[1]);
+        const auto op = ctx->eqop(0)->getText();
+        if (op == "!=") {
+            return m_ir.make(ir::Op::Ne, {clause0, clause1});
         }
-        all_expr_vector.push_back(std::any_cast<z3::expr>(res));
-        unsigned id = all_expr_vector.size() - 1;
-        update_constraint_val_map(clause0, id);
-        update_constraint_val_map(clause1, id);
-        return res;
+        if (op == "==") {
+            return m_ir.make(ir::Op::Eq, {clause0, clause1});
+        }
+        unreachable();
     }
-    std::any CConstraintVisitor::visitAndExpression(c11parser::CParser::AndExpressionContext *ctx) {
-        auto p_sub = ctx->equalityExpression();
-        if (p_sub.size() > 1) {
-            panic("bitwise operation not supported since we dont use bitvec theory.");
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::AndExpressionContext *ctx) {
+        auto e = lower(ctx->equalityExpression(0));
+        for (int i = 1; i < ctx->equalityExpression().size(); ++i) {
+            e = m_ir.make(ir::Op::BitAnd, {e, lower(ctx->equalityExpression(i))});
         }
-        return visit(p_sub[0]);
+        return e;
     }
-    std::any CConstraintVisitor::visitExclusiveOrExpression(c11parser::CParser::ExclusiveOrExpressionContext *ctx) {
-        auto p_sub = ctx->andExpression();
-        if (p_sub.size() > 1) {
-            panic("bitwise operation not supported since we dont use bitvec theory.");
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::ExclusiveOrExpressionContext *ctx) {
+        auto e = lower(ctx->andExpression(0));
+        for (int i = 1; i < ctx->andExpression().size(); ++i) {
+            e = m_ir.make(ir::Op::BitXor, {e, lower(ctx->andExpression(i))});
         }
-        return visit(p_sub[0]);
+        return e;
     }
-    std::any CConstraintVisitor::visitInclusiveOrExpression(c11parser::CParser::InclusiveOrExpressionContext *ctx) {
-        auto p_sub = ctx->exclusiveOrExpression();
-        if (p_sub.size() > 1) {
-            panic("bitwise operation not supported since we dont use bitvec theory.");
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::InclusiveOrExpressionContext *ctx) {
+        auto e = lower(ctx->exclusiveOrExpression(0));
+        for (int i = 1; i < ctx->exclusiveOrExpression().size(); ++i) {
+            e = m_ir.make(ir::Op::BitOr, {e, lower(ctx->exclusiveOrExpression(i))});
         }
-        return visit(p_sub[0]);
+        return e;
     }
-    std::any CConstraintVisitor::visitLogicalAndExpression(c11parser::CParser::LogicalAndExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::LogicalAndExpressionContext *ctx) {
         if (ctx->inclusiveOrExpression().size() == 1) {
-            return visit(ctx->inclusiveOrExpression(0));
+            return lower(ctx->inclusiveOrExpression(0));
         }
-        z3::expr expr = m_solver_context.bool_val(true);
+        std::vector<ir::NodeId> clauses{};
         for (auto p_clause: ctx->inclusiveOrExpression()) {
-            auto clause = std::any_cast<z3::expr>(visit(p_clause));
-            // info("&& clause", clause.to_string());
-            expr = expr && clause;
+            clauses.push_back(lower(p_clause));
         }
-        return expr;
+        return m_ir.make(ir::Op::And, clauses);
     }
-    std::any CConstraintVisitor::visitLogicalOrExpression(c11parser::CParser::LogicalOrExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::LogicalOrExpressionContext *ctx) {
         if (ctx->logicalAndExpression().size() == 1) {
-            return visit(ctx->logicalAndExpression(0));
+            return lower(ctx->logicalAndExpression(0));
         }
-        z3::expr expr = m_solver_context.bool_val(false);
+        std::vector<ir::NodeId> clauses{};
         for (auto p_clause: ctx->logicalAndExpression()) {
-            auto clause = std::any_cast<z3::expr>(visit(p_clause));
-            if (clause.is_bool()) {
-                unsigned expr_id = all_expr_vector.size() - 1;
-                assert(all_expr_vector[expr_id].to_string() == clause.to_string());// Debug
-                info("add clause into or_expr_idmap: ", or_class_id, expr_id, clause.to_string());
-                or_expr_idmap.emplace(expr_id, or_class_id);
-            }
-            expr = expr || clause;
+            clauses.push_back(lower(p_clause));
         }
-        or_class_id += 2;
-        return expr;
+        return m_ir.make(ir::Op::Or, clauses);
     }
-    std::any CConstraintVisitor::visitConditionalExpression(c11parser::CParser::ConditionalExpressionContext *ctx) {
-        auto cond = std::any_cast<z3::expr>(visit(ctx->logicalOrExpression()));
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::ConditionalExpressionContext *ctx) {
+        auto cond = lower(ctx->logicalOrExpression());
         if (ctx->expression() != nullptr && ctx->conditionalExpression() != nullptr) {
-            z3::expr true_branch = z3::implies(cond, std::any_cast<z3::expr>(visit(ctx->expression())));
-            z3::expr false_branch = z3::implies(!cond, std::any_cast<z3::expr>(visit(ctx->conditionalExpression())));
-            z3::expr conj = true_branch && false_branch;
-            return conj;
-        } else {
-            return cond;
+            return m_ir.make(ir::Op::Cond, {cond, lower(ctx->expression()), lower(ctx->conditionalExpression())});
         }
+        return cond;
     }
-    std::any CConstraintVisitor::visitAssignmentExpression(c11parser::CParser::AssignmentExpressionContext *ctx) {
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::AssignmentExpressionContext *ctx) {
         if (ctx->assignmentOperator() != nullptr) {
             panic("assignment operator is not allowed");
         }
-        return visitChildren(ctx);
+        if (ctx->conditionalExpression() == nullptr) {
+            panic("can't parse expression.");
+        }
+        return lower(ctx->conditionalExpression());
     }
-    std::any CConstraintVisitor::visitExpression(c11parser::CParser::ExpressionContext *ctx) {
-        std::optional<z3::expr> last_expr = std::nullopt;
-        for (auto p_assign_expr: ctx->assignmentExpression()) {
-            auto ret = std::any_cast<z3::expr>(visit(p_assign_expr));
-            last_expr = std::move(ret);
+    ir::NodeId CConstraintVisitor::lower(c11parser::CParser::ExpressionContext *ctx) {
+        const auto &p_exprs = ctx->assignmentExpression();
+        if (p_exprs.empty()) {
+            unreachable();
         }
-        if (last_expr) {
-            auto t = *last_expr;
-            return t;
+        if (p_exprs.size() == 1) {
+            return lower(p_exprs[0]);
         }
-        unreachable();
+        std::vector<ir::NodeId> items{};
+        for (auto p_expr: p_exprs) {
+            items.push_back(lower(p_expr));
+        }
+        return m_ir.make(ir::Op::Seq, items);
+    }
+
+    z3::expr CConstraintVisitor::emit(ir::NodeId id) {
+        // 比较与布尔连接词每次出现都要登记到all_expr_vector等映射中，不缓存
+        const auto op = m_ir.op(id);
+        const bool cacheable = !ir::Arena::is_comparison(op) && op != ir::Op::And && op != ir::Op::Or &&
+                               op != ir::Op::Not && op != ir::Op::Cond && op != ir::Op::Seq && op != ir::Op::Gaussian;
+        if (cacheable && id < m_z3_cache.size() && m_z3_cache[id]) {
+            if (auto guard = m_index_guards.find(id); guard != m_index_guards.end()) {
+                m_pending_guards.push_back(guard->second);
+            }
+            return *m_z3_cache[id];
+        }
+        auto ret = [&]() -> z3::expr {
+            switch (op) {
+                case ir::Op::Var: {
+                    auto entry = m_symbol_table.lookup_entry(m_ir.name(id));
+                    stst_assert(entry != nullptr && entry->sym);
+                    if (entry->qualifer == SymbolTableEntryQualifer::Pointer && m_pointer_encoding == PointerEncoding::Bounded) {
+                        panic("pointer \"" + m_ir.name(id) + "\" can only be indexed or passed to _LENGTH.");
+                    }
+                    return *entry->sym;
+                }
+                case ir::Op::ConstInt:
+                    return m_solver_context.int_val(m_ir.int_value(id));
+                case ir::Op::ConstReal:
+                    // 实数使用分数表示
+                    return m_solver_context.real_val(m_ir.real_value(id) * 1000, 1000);
+                case ir::Op::Index: {
+                    std::vector<int> inner{};
+                    auto field = id;
+                    while (m_ir.op(field) == ir::Op::Index && m_ir.op(m_ir.arg(field, 1)) == ir::Op::ConstInt) {
+                        inner.insert(inner.begin(), static_cast<int>(m_ir.int_value(m_ir.arg(field, 1))));
+                        field = m_ir.arg(field, 0);
+                    }
+                    if (auto member = flat_member(field); member && member->second->qualifer == SymbolTableEntryQualifer::Array) {
+                        return flat_element(member->first, *member->second, inner);
+                    }
+                    if (auto path = constant_index_path(id)) {
+                        const auto &name = m_ir.name(path->first);
+                        const auto *entry = m_symbol_table.lookup_entry(name);
+                        if (entry != nullptr && is_flat_array(name, *entry)) {
+                            return flat_element(name, *entry, path->second);
+                        }
+                    }
+                    if (m_pointer_encoding == PointerEncoding::Bounded) {
+                        if (auto element = emit_bounded_element(id)) {
+                            return *element;
+                        }
+                    }
+                    auto base = emit(m_ir.arg(id, 0));
+                    auto idx = as_index(emit(m_ir.arg(id, 1)));
+                    info("idx: ", idx.to_string());
+                    info("seq: ", base.to_string());
+                    return base[idx];
+                }
+                case ir::Op::Field: {
+                    if (auto member = flat_member(id)) {
+                        if (member->second->qualifer != SymbolTableEntryQualifer::Primary) {
+                            panic("member \"" + m_ir.to_string(id) + "\" can only be indexed or passed to _LENGTH.");
+                        }
+                        return flat_element(member->first, *member->second, {});
+                    }
+                    auto base = emit(m_ir.arg(id, 0));
+                    const auto *blueprint = find_blueprint(base.get_sort());
+                    if (blueprint == nullptr) {
+                        panic("member access on a non-struct value.");
+                    }
+                    // 找到对应project函数
+                    return find_getter(*blueprint, m_ir.name(id))(base);
+                }
+                case ir::Op::Length: {
+                    if (m_pointer_encoding == PointerEncoding::Bounded) {
+                        return bounded_length(m_ir.arg(id, 0));
+                    }
+                    // seq theorem length primitive
+                    auto length = emit(m_ir.arg(id, 0)).length();
+                    m_var_bounds.emplace(length.to_string(), std::make_pair(int64_t{1}, int64_t{m_max_pointer_length}));
+                    return length;
+                }
+                case ir::Op::Gaussian: {
+                    auto var = emit(m_ir.arg(id, 0));
+                    auto mu = emit(m_ir.arg(id, 1));
+                    auto sigma = emit(m_ir.arg(id, 2));
+                    stst_assert(mu.is_numeral());
+                    stst_assert(sigma.is_numeral());
+                    m_gaussian_cons.emplace_back(var, mu.as_double(), sigma.as_double(), m_ir.arg(id, 0));
+                    info("Found GAUSSIAN for var: ", var.to_string());
+                    return m_solver_context.string_val("GAUSSIAN");
+                }
+                case ir::Op::Neg:
+                    return -emit(m_ir.arg(id, 0));
+                case ir::Op::Not:
+                    return !emit(m_ir.arg(id, 0));
+                case ir::Op::Add:
+                case ir::Op::Sub:
+                case ir::Op::Mul:
+                case ir::Op::Div:
+                case ir::Op::Mod:
+                    return emit_arithmetic(id);
+                case ir::Op::Shl:
+                case ir::Op::Shr:
+                case ir::Op::BitAnd:
+                case ir::Op::BitOr:
+                case ir::Op::BitXor:
+                case ir::Op::BitNot:
+                    return emit_bitwise(id);
+                case ir::Op::Lt:
+                case ir::Op::Le:
+                case ir::Op::Gt:
+                case ir::Op::Ge:
+                case ir::Op::Eq:
+                case ir::Op::Ne: {
+                    const auto guards_begin = m_pending_guards.size();
+                    auto [clause0, clause1] = unify(emit(m_ir.arg(id, 0)), emit(m_ir.arg(id, 1)), is_unsigned(m_ir.arg(id, 0)) || is_unsigned(m_ir.arg(id, 1)));
+                    const bool unsigned_cmp = clause0.is_bv() && (is_unsigned(m_ir.arg(id, 0)) || is_unsigned(m_ir.arg(id, 1)));
+                    auto res = [&, &clause0 = clause0, &clause1 = clause1] {
+                        if (unsigned_cmp) {
+                            switch (op) {
+                                case ir::Op::Lt:
+                                    return z3::ult(clause0, clause1);
+                                case ir::Op::Le:
+                                    return z3::ule(clause0, clause1);
+                                case ir::Op::Gt:
+                                    return z3::ugt(clause0, clause1);
+                                case ir::Op::Ge:
+                                    return z3::uge(clause0, clause1);
+                                default:
+                                    break;
+                            }
+                        }
+                        switch (op) {
+                            case ir::Op::Lt:
+                                return clause0 < clause1;
+                            case ir::Op::Le:
+                                return clause0 <= clause1;
+                            case ir::Op::Gt:
+                                return clause0 > clause1;
+                            case ir::Op::Ge:
+                                return clause0 >= clause1;
+                            case ir::Op::Eq:
+                                return clause0 == clause1;
+                            default:
+                                return clause0 != clause1;
+                        }
+                    }();
+                    all_expr_vector.push_back(res);
+                    unsigned expr_id = all_expr_vector.size() - 1;
+                    update_constraint_val_map(clause0, expr_id);
+                    update_constraint_val_map(clause1, expr_id);
+                    if (m_pending_guards.size() > guards_begin) {
+                        // 访问了指针元素，要求下标在长度之内
+                        z3::expr_vector guards{m_solver_context};
+                        for (auto i = guards_begin; i < m_pending_guards.size(); ++i) {
+                            guards.push_back(m_pending_guards[i]);
+                        }
+                        m_pending_guards.erase(m_pending_guards.begin() + guards_begin, m_pending_guards.end());
+                        return z3::mk_and(guards) && res;
+                    }
+                    return res;
+                }
+                case ir::Op::And: {
+                    z3::expr_vector clauses{m_solver_context};
+                    for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+                        clauses.push_back(emit(m_ir.arg(id, i)));
+                    }
+                    return z3::mk_and(clauses);
+                }
+                case ir::Op::Or: {
+                    z3::expr_vector clauses{m_solver_context};
+                    for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+                        auto clause = emit(m_ir.arg(id, i));
+                        if (clause.is_bool()) {
+                            unsigned expr_id = all_expr_vector.size() - 1;
+                            info("add clause into or_expr_idmap: ", or_class_id, expr_id, clause.to_string());
+                            or_expr_idmap.emplace(expr_id, or_class_id);
+                        }
+                        clauses.push_back(clause);
+                    }
+                    or_class_id += 2;
+                    return z3::mk_or(clauses);
+                }
+                case ir::Op::Cond: {
+                    auto cond = emit(m_ir.arg(id, 0));
+                    z3::expr true_branch = z3::implies(cond, emit(m_ir.arg(id, 1)));
+                    z3::expr false_branch = z3::implies(!cond, emit(m_ir.arg(id, 2)));
+                    return true_branch && false_branch;
+                }
+                case ir::Op::Seq: {
+                    std::optional<z3::expr> last{};
+                    for (uint32_t i = 0; i < m_ir.num_args(id); ++i) {
+                        last = emit(m_ir.arg(id, i));
+                    }
+                    return *last;
+                }
+            }
+            unreachable();
+        }();
+        if (ir::Arena::is_leaf_term(op) && op != ir::Op::Length) {
+            if (auto type = leaf_type(id)) {
+                add_type_domain(ret, *type);
+            }
+        }
+        if (cacheable) {
+            if (m_z3_cache.size() < m_ir.size()) {
+                m_z3_cache.resize(m_ir.size());
+            }
+            m_z3_cache[id] = ret;
+        }
+        return ret;
     }
 
     void CConstraintVisitor::update_constraint_val_map(z3::expr &clause, unsigned expr_id) {
@@ -681,7 +1770,7 @@ namespace ststgen {
         }
         // fmt::println("update_constraint_val_map: clause {}, func kind {}", clause.to_string(), (int)clause.decl().decl_kind());
         auto clause_op = clause.decl().decl_kind();
-        if (clause.is_arith() && clause.num_args() > 1 && clause_op != Z3_OP_SELECT && clause_op != Z3_OP_SEQ_NTH) {
+        if ((clause.is_arith() || clause.is_bv()) && clause.num_args() > 1 && clause_op != Z3_OP_SELECT && clause_op != Z3_OP_SEQ_NTH) {
             for (auto child: clause.args()) {
                 update_constraint_val_map(child, expr_id);
             }
@@ -696,13 +1785,16 @@ namespace ststgen {
         constraint_val_expr_idmap.at(val_name).push_back(expr_id);
     }
 
-    bool CConstraintVisitor::solve() {
+    bool CConstraintVisitor::solve(const z3::expr_vector *assumptions) {
         m_smt_solver.push();
         generate_gaussian();
         // info("checking sat: ", m_smt_solver.to_smt2());
 
-        auto res = m_smt_solver.check();
+        auto res = check_sat(assumptions);
         if (res == z3::unsat) {
+            if (assumptions != nullptr) {
+                m_last_core = m_smt_solver.unsat_core();
+            }
             is_verbose println_local("constraint unsat");
             m_smt_solver.pop();
             return false;
@@ -717,125 +1809,684 @@ namespace ststgen {
         // is_verbose println_local("solver: {}\n", m_smt_solver.to_smt2());
         // is_verbose println_local("model: {}\n", model.to_string());
         m_smt_solver.pop();
+        return extract(model);
+    }
+
+    namespace {
+        // 用例json在内存中的估计字节数：每个值一个json节点，对象成员另计键与红黑树节点
+        size_t json_footprint(const json &j) {
+            size_t bytes = sizeof(json);
+            if (j.is_object()) {
+                bytes += sizeof(json::object_t);
+                for (auto it = j.begin(); it != j.end(); ++it) {
+                    bytes += 4 * sizeof(void *) + sizeof(std::string) + it.key().capacity() + json_footprint(*it);
+                }
+            } else if (j.is_array()) {
+                bytes += sizeof(json::array_t);
+                for (const auto &e: j) {
+                    bytes += json_footprint(e);
+                }
+            } else if (j.is_string()) {
+                bytes += sizeof(std::string) + j.get_ref<const std::string &>().capacity();
+            }
+            return bytes;
+        }
+    }// namespace
+
+    bool CConstraintVisitor::extract(const z3::model &model) {
+        m_last_model = model;
+        TraceSpan span{"extract", "generate"};
+        ScopedTimer extract_timer{m_metrics.times.extract};
         auto solve = json{};
+        const auto case_stream = random_g;
         for (const auto &[name, entry]: m_symbol_table.get_scope(0)) {
+            m_extract_var = name;
+            if (m_master_seed) {
+                // 每个变量用自己的流，一个变量取值的多少不影响其他变量
+                random_g = Philox(*m_master_seed, positive, static_cast<uint32_t>(m_case_id), Philox::stream_of(name));
+            }
+            if (is_large_array(entry) && (m_referenced_vars.count(name) == 0 || is_flat_array(name, entry))) {
+                solve[name] = process_sparse_array(name, entry, model);
+                continue;
+            }
+            if (m_referenced_vars.count(name) == 0) {
+                // 约束中未出现的变量不在查询中，直接按类型随机取值
+                solve[name] = random_value(entry);
+                continue;
+            }
             if (entry.qualifer == SymbolTableEntryQualifer::Primary) {
                 if (entry.type == SymbolTableEntryType::Int32 ||
                     entry.type == SymbolTableEntryType::Int64 ||
                     entry.type == SymbolTableEntryType::UInt32 ||
                     entry.type == SymbolTableEntryType::UInt64) {
-                    auto subst = model.get_const_interp(entry.sym->decl());
-                    auto v = subst.as_int64();
-                    if (entry.type == SymbolTableEntryType::Int32 || entry.type == SymbolTableEntryType::UInt32) {
-                        if (v > INT_MAX || v < INT_MIN) {
-                            throw std::exception();
-                        }
-                    }
-                    solve[name] = v;
+                    // 被消去的变量不在模型中，补全后由下面的定义式覆盖
+                    auto subst = model.eval(*entry.sym, true);
+                    solve[name] = int_to_json(subst, entry_type_2_value_type(entry.type));
                 } else if (entry.type == SymbolTableEntryType::Float32 || entry.type == SymbolTableEntryType::Float64) {
-                    auto subst = model.get_const_interp(entry.sym->decl());
-                    auto v = subst.as_double();
-                    solve[name] = v;
+                    const bool post_sampled = std::any_of(m_gaussian_cons.begin(), m_gaussian_cons.end(), [&](const GaussianCons &g) {
+                        return g.post_sample && g.path && g.path->to_string() == "/" + name;
+                    });
+                    // 求解后采样的变量不在查询中、模型里没有它，占位后由apply_gaussian_samples写入
+                    solve[name] = post_sampled ? 0.0 : model.eval(*entry.sym, true).as_double();
+                } else if (is_flat_struct(name, entry)) {
+                    solve[name] = process_flat_struct(name, entry, {}, model);
                 } else if (entry.type == SymbolTableEntryType::Struct) {
-                    auto subst = model.get_const_interp(entry.sym->decl());
+                    auto subst = model.eval(*entry.sym, true);
                     auto obj_json = process_z3_tuple(entry, model, subst);
                     solve[name] = obj_json;
                 } else {
                     unreachable();
                 }
+            } else if (is_flat_array(name, entry)) {
+                solve[name] = process_flat_array(name, entry, model);
             } else if (entry.qualifer == SymbolTableEntryQualifer::Array) {
-                auto subst = model.get_const_interp(entry.sym->decl());
+                auto subst = model.eval(*entry.sym, true);
                 auto array_json = process_z3_seq(entry.dims, subst, model, entry, entry_type_2_value_type(entry.type));
                 solve[name] = array_json;
+            } else if (entry.qualifer == SymbolTableEntryQualifer::Pointer && m_pointer_encoding == PointerEncoding::Bounded) {
+                solve[name] = process_bounded_pointer(name, entry, model);
             } else if (entry.qualifer == SymbolTableEntryQualifer::Pointer) {
-                auto subst = model.get_const_interp(entry.sym->decl());
+                auto subst = model.eval(*entry.sym, true);
                 auto length = model.eval(subst.length()).as_int64();
                 std::vector dims{static_cast<int>(length)};
                 auto array_json = process_z3_seq(dims, subst, model, entry, entry_type_2_value_type(entry.type));
                 solve[name] = array_json;
             }
         }
-
-        m_cases.emplace(std::move(solve));
-        cur_case = m_cases.size();
+
+        random_g = case_stream;
+        for (const auto &e: m_eliminated) {
+            if (solve.contains(e.path)) {
+                solve[e.path] = int_to_json(model.eval(e.definition, true), entry_type_2_value_type(e.type));
+            }
+        }
+        apply_gaussian_samples(solve);
+        if (m_master_seed) {
+            record_gaussian_samples(solve);
+            m_metrics.cases_produced++;
+            m_case_bytes += json_footprint(solve);
+            m_seeded_cases.insert_or_assign(m_case_id, std::move(solve));
+            return true;
+        }
+        if (!m_flushed_cases.empty() && m_flushed_cases.count(std::hash<json>{}(solve))) {
+            m_metrics.cases_deduplicated++;
+            return true;
+        }
+        if (auto [it, inserted] = m_cases.emplace(std::move(solve)); inserted) {
+            m_case_bytes += json_footprint(*it);
+            record_gaussian_samples(*it);
+            m_metrics.cases_produced++;
+            if (coverage_feedback()) {
+                execute_for_feedback(*it);
+            }
+            if (m_boundary) {
+                for (const auto &[name, value]: constraint_val_cur_value) {
+                    auto targets = m_boundary_targets.find(name);
+                    if (targets != m_boundary_targets.end() && targets->second.count(value)) {
+                        m_boundary_hits[name].insert(value);
+                    }
+                }
+            }
+        } else {
+            m_metrics.cases_deduplicated++;
+        }
+        cur_case = static_cast<unsigned>(m_cases.size() + m_flushed_cases.size() + m_unhashed_kept);
+        return true;
+    }
+
+    bool CConstraintVisitor::random_flip_expr(z3::expr_vector &original_exprs) {
+        // 约束恒真(如只有定义域约束)时任何翻转都不可满足，不能无限重试
+        constexpr int MAX_FLIP_ATTEMPTS = 64;
+        std::uniform_int_distribution<> random_bool(0,5);
+        auto status = z3::unknown;
+        for (int attempt = 0; status != z3::sat; ++attempt) {
+            if (attempt == MAX_FLIP_ATTEMPTS) {
+                return false;
+            }
+            m_smt_solver.reset();
+            for (const auto &cons: m_domain_constraints) {
+                m_smt_solver.add(cons);
+            }
+            for(auto exp : original_exprs) {
+                if (is_domain_constraint(exp)) {
+                    continue;
+                }
+                if (random_bool(random_g)) {
+                    m_smt_solver.add(!exp);
+                } else {
+                    m_smt_solver.add(exp);
+                }
+            }
+            status = check_sat();
+        }
         return true;
     }
 
-    void CConstraintVisitor::random_flip_expr(z3::expr_vector &original_exprs) {
-        std::uniform_int_distribution<> random_bool(0,5);
-        auto status = z3::unknown;
-        while (status != z3::sat) {
+    bool CConstraintVisitor::enumerate_remaining(z3::expr_vector &original_exprs) {
+        TraceSpan span{"enumerate", "generate"};
+        if (positive == 'N') {
+            // 反例的解空间是原约束整体取反，而不是某一种翻转
             m_smt_solver.reset();
-            for(auto exp : original_exprs) {
-                if (random_bool(random_g)) {
-                    m_smt_solver.add(!exp);
-                } else {
+            z3::expr_vector constraints{m_solver_context};
+            for (auto exp: original_exprs) {
+                if (is_domain_constraint(exp)) {
                     m_smt_solver.add(exp);
+                } else {
+                    constraints.push_back(exp);
                 }
             }
-            status = m_smt_solver.check();
+            m_smt_solver.add(!z3::mk_and(constraints));
+        }
+        const auto begin_cases = cur_case;
+        // 解由约束变量的取值决定，逐个排除已得到的取值组合；取值不决定用例时(如非常量下标)以预算的两倍为限
+        const unsigned limit = std::max(64u, 2 * (total_gen_cases - cur_case));
+        bool exhausted = false;
+        unsigned models = 0;
+        m_smt_solver.push();
+        for (; models < limit && cur_case < total_gen_cases; ++models) {
+            constraint_val_cur_value.clear();
+            if (!solve()) {
+                // unknown时不能断定解已取尽
+                exhausted = m_last_check == z3::unsat;
+                break;
+            }
+            z3::expr_vector differ{m_solver_context};
+            for (const auto &var: constraint_val_list) {
+                differ.push_back(var != m_last_model->eval(var, true));
+            }
+            if (differ.empty()) {
+                exhausted = true;
+                ++models;
+                break;
+            }
+            m_smt_solver.add(z3::mk_or(differ));
         }
+        m_smt_solver.pop();
+        m_metrics.enumerated_models += models;
+        println_local("enumerated {} models, {} new cases.", models, cur_case - begin_cases);
+        if (exhausted && cur_case < total_gen_cases) {
+            println_local("space exhausted at {} cases.", cur_case);
+            m_metrics.space_exhausted++;
+            return false;
+        }
+        return cur_case > begin_cases;
     }
 
     void CConstraintVisitor::mutateEntrance(const std::string &outpath) {
         cur_case = 0;
         output_path = outpath;
+        if (m_incremental != Incremental::Off) {
+            revalidate_existing();
+            if (cur_case >= total_gen_cases) {
+                return;
+            }
+        }
         info("after parse: ", m_smt_solver.to_smt2());
         auto original_exprs = m_smt_solver.assertions();
-        if (positive == 'P' && m_smt_solver.check() != z3::sat) {
+        if (positive == 'P' && check_sat() != z3::sat) {
             info("The original constraint can not solve!");
             return;
         }
+        if (m_master_seed) {
+            generate_seeded(original_exprs);
+            return;
+        }
+        if (m_boundary) {
+            // 反例模式会清空约束与变量的对应关系，先记下原约束给出的范围
+            for (const auto &var: constraint_val_list) {
+                auto &bounds = m_original_bounds[var.to_string()];
+                std::tie(bounds.lo, bounds.hi) = var_range(var, &bounds.constants);
+            }
+        }
+
+        m_case_limit = total_gen_cases;
+        // 覆盖反馈模式下或语句的选择由覆盖加权，不做系统枚举
+        if (positive == 'P' && !or_expr_idmap.empty() && !coverage_feedback()) {
+            build_or_combinations();
+        }
 
+        // 连续这么多轮没有新用例时，怀疑解空间已不足-n个，转为逐个枚举剩余的解
+        constexpr int STALL_CYCLES = 8;
+        int stalled_cycles = 0;
         for (int mutate_cycle = 1; cur_case < total_gen_cases; mutate_cycle++) {
+            TraceSpan span{"mutate cycle", "generate"};
+            m_metrics.mutation_cycles++;
             int this_cycle_begin_cases = cur_case;
+            const auto cycle_begin_duplicates = m_metrics.cases_deduplicated;
             assert(constraint_val_cur_value.empty());
             // Rotate the constraint variable order to generate various cases.
             std::shuffle(constraint_val_list.begin(), constraint_val_list.end(), random_g);
+            if (coverage_feedback()) {
+                order_by_coverage(constraint_val_list);
+            }
 
+            bool flipped = true;
             if (positive == 'N') {
-                random_flip_expr(original_exprs);
+                flipped = random_flip_expr(original_exprs);
                 // In negative mode, we do not need to proceed or expr.
                 or_expr_idmap.clear();
                 constraint_val_expr_idmap.clear();
             }
 
-            if (or_expr_idmap.empty()) {
+            if (!flipped) {
+                // 本轮没有可满足的翻转，计入停滞
+            } else if (or_expr_idmap.empty()) {
+                mutateVar(constraint_val_list.begin());
+            } else if (!m_or_combinations.empty()) {
+                auto combo = next_or_combination();
+                if (!combo) {
+                    println_local("every OR-branch combination is infeasible.");
+                    break;
+                }
+                // 剩余预算在尚未排除的组合间平分
+                const auto open = static_cast<unsigned>(std::count_if(m_or_combinations.begin(), m_or_combinations.end(), [](const OrCombination &c) {
+                    return c.state != OrCombination::State::Infeasible;
+                }));
+                const auto remaining = total_gen_cases - cur_case;
+                m_case_limit = cur_case + std::max<unsigned>(1, (remaining + open - 1) / open);
+                m_smt_solver.push();
+                activate_or_combination(m_or_combinations[*combo].choice);
+                // 组合已检查过可满足，不必再检查
                 mutateVar(constraint_val_list.begin());
+                m_smt_solver.pop();
+                m_case_limit = total_gen_cases;
             } else {// 从若干或语句中任意激活一条
                 m_smt_solver.push();
-                int last_or_class = 0;
-                std::vector<std::map<unsigned, int>::iterator> cur_or_exprs;
-                or_expr_idmap.emplace(all_expr_vector.size(), -2);
-                for (auto it = or_expr_idmap.begin(); it != or_expr_idmap.end(); it++) {
-                    int cur_class = it->second >> 1;
-                    if (it->second & 1) {
-                        it->second--;
-                    }
-                    if (cur_class == last_or_class) {
-                        cur_or_exprs.push_back(it);
-                        continue;
-                    }
-                    std::uniform_int_distribution<size_t> rf{0, cur_or_exprs.size() - 1};
-                    size_t choose = rf(random_g);
-                    auto choosed_it = cur_or_exprs[choose];
-                    choosed_it->second++;
-                    info("Add or expr into solver: ", all_expr_vector[choosed_it->first].to_string());
-                    m_smt_solver.add(all_expr_vector[choosed_it->first]);
-                    last_or_class = cur_class;
-                    cur_or_exprs.clear();
-                    // Push the new class's first or_expr
-                    cur_or_exprs.push_back(it);
-                }
-                if (m_smt_solver.check() == z3::sat) {
+                activate_or_exprs();
+                if (check_sat() == z3::sat) {
                     mutateVar(constraint_val_list.begin());
                 }
                 m_smt_solver.pop();
             }
-            println_local("In mutate cycle {}, generated {} cases.", mutate_cycle, cur_case - this_cycle_begin_cases);
+            const auto duplicates = m_metrics.cases_deduplicated - cycle_begin_duplicates;
+            if (!m_quiet_log) {
+                println_local("In mutate cycle {}, generated {} cases, {} duplicates.", mutate_cycle, cur_case - this_cycle_begin_cases, duplicates);
+            }
+            if (!check_memory()) {
+                break;
+            }
+            stalled_cycles = cur_case == this_cycle_begin_cases ? stalled_cycles + 1 : 0;
+            if (stalled_cycles == STALL_CYCLES) {
+                m_metrics.stalled_cycles += stalled_cycles;
+                stalled_cycles = 0;
+                if (!enumerate_remaining(original_exprs)) {
+                    if (cur_case < total_gen_cases && m_metrics.space_exhausted == 0) {
+                        println_local("no new cases after enumeration, stopping at {} cases.", cur_case);
+                    }
+                    break;
+                }
+            }
+        }
+        if (m_boundary) {
+            for (const auto &[name, targets]: m_boundary_targets) {
+                const auto &hits = m_boundary_hits[name];
+                std::vector<int64_t> missed{};
+                std::set_difference(targets.begin(), targets.end(), hits.begin(), hits.end(), std::back_inserter(missed));
+                m_metrics.boundary_targets += targets.size();
+                m_metrics.boundary_hits += hits.size();
+                println_local("boundary {}: hit {}/{} {}, missed {}", name, hits.size(), targets.size(), hits, missed);
+            }
+        }
+        for (const auto &[name, histogram]: m_metrics.gaussian) {
+            auto j = histogram.to_json();
+            println_local("GAUSSIAN({}, {}, {}): {} samples, mean {:.4g}, stddev {:.4g}\n{}", name, histogram.mu, histogram.sigma,
+                          histogram.count, j["mean"].get<double>(), j["stddev"].get<double>(), histogram.to_string());
+        }
+    }
+    void CConstraintVisitor::build_or_combinations() {
+        m_or_classes.clear();
+        int last_class = -1;
+        for (const auto &[expr_id, code]: or_expr_idmap) {
+            if (code < 0) {
+                continue;
+            }
+            if ((code >> 1) != last_class) {
+                m_or_classes.emplace_back();
+                last_class = code >> 1;
+            }
+            m_or_classes.back().push_back(expr_id);
+            // 以跟踪文字作假设，unsat core才能指出是哪些分支冲突
+            auto literal = m_solver_context.bool_const(fmt::format("#or{}", expr_id).c_str());
+            m_smt_solver.add(z3::implies(literal, all_expr_vector[expr_id]));
+            m_or_literals.emplace(literal.id(), std::make_pair(static_cast<uint32_t>(m_or_classes.size() - 1), static_cast<uint32_t>(m_or_classes.back().size() - 1)));
+            m_or_literal_exprs.push_back(literal);
+        }
+        constexpr uint64_t MAX_EXHAUSTIVE_COMBINATIONS = 256;
+        uint64_t total = 1;
+        for (const auto &cls: m_or_classes) {
+            total = std::min<uint64_t>(total * cls.size(), MAX_EXHAUSTIVE_COMBINATIONS + 1);
+        }
+        m_or_combinations.clear();
+        if (total <= MAX_EXHAUSTIVE_COMBINATIONS || m_or_classes.size() < 2) {
+            // 按混合进制逐个枚举
+            std::vector<uint32_t> choice(m_or_classes.size(), 0);
+            for (;;) {
+                m_or_combinations.push_back({choice});
+                size_t k = 0;
+                while (k < choice.size() && ++choice[k] == m_or_classes[k].size()) {
+                    choice[k++] = 0;
+                }
+                if (k == choice.size()) {
+                    break;
+                }
+            }
+        } else {
+            build_pairwise_combinations();
+        }
+        std::shuffle(m_or_combinations.begin(), m_or_combinations.end(), random_g);
+        println_local("{} OR classes, {} branch combinations{}.", m_or_classes.size(), m_or_combinations.size(),
+                      total > MAX_EXHAUSTIVE_COMBINATIONS ? " (pairwise)" : "");
+    }
+    void CConstraintVisitor::build_pairwise_combinations() {
+        // 贪心构造两两覆盖的组合：每行从一个尚未覆盖的分支对出发，其余类取能覆盖最多新对的分支
+        const auto n = m_or_classes.size();
+        std::vector<std::vector<std::vector<bool>>> covered(n, std::vector<std::vector<bool>>(n));
+        size_t uncovered = 0;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                covered[i][j].assign(m_or_classes[i].size() * m_or_classes[j].size(), false);
+                uncovered += covered[i][j].size();
+            }
+        }
+        auto is_covered = [&](size_t i, uint32_t a, size_t j, uint32_t b) {
+            return i < j ? covered[i][j][a * m_or_classes[j].size() + b] : covered[j][i][b * m_or_classes[i].size() + a];
+        };
+        constexpr uint32_t UNSET = UINT32_MAX;
+        while (uncovered > 0) {
+            std::vector<uint32_t> row(n, UNSET);
+            bool seeded = false;
+            for (size_t i = 0; i < n && !seeded; ++i) {
+                for (size_t j = i + 1; j < n && !seeded; ++j) {
+                    for (size_t idx = 0; idx < covered[i][j].size(); ++idx) {
+                        if (!covered[i][j][idx]) {
+                            row[i] = static_cast<uint32_t>(idx / m_or_classes[j].size());
+                            row[j] = static_cast<uint32_t>(idx % m_or_classes[j].size());
+                            seeded = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            for (size_t k = 0; k < n; ++k) {
+                if (row[k] != UNSET) {
+                    continue;
+                }
+                uint32_t best = 0;
+                size_t best_gain = 0;
+                for (uint32_t opt = 0; opt < m_or_classes[k].size(); ++opt) {
+                    size_t gain = 0;
+                    for (size_t o = 0; o < n; ++o) {
+                        if (o != k && row[o] != UNSET && !is_covered(k, opt, o, row[o])) {
+                            gain++;
+                        }
+                    }
+                    if (gain > best_gain) {
+                        best = opt;
+                        best_gain = gain;
+                    }
+                }
+                row[k] = best;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = i + 1; j < n; ++j) {
+                    const auto idx = row[i] * m_or_classes[j].size() + row[j];
+                    if (!covered[i][j][idx]) {
+                        covered[i][j][idx] = true;
+                        uncovered--;
+                    }
+                }
+            }
+            m_or_combinations.push_back({std::move(row)});
+        }
+    }
+    std::optional<size_t> CConstraintVisitor::next_or_combination() {
+        for (size_t tried = 0; tried < m_or_combinations.size(); ++tried) {
+            const auto idx = m_or_cursor;
+            m_or_cursor = (m_or_cursor + 1) % m_or_combinations.size();
+            auto &combo = m_or_combinations[idx];
+            if (combo.state == OrCombination::State::Unknown) {
+                const bool blacklisted = std::any_of(m_or_blacklist.begin(), m_or_blacklist.end(), [&](const auto &partial) {
+                    return std::all_of(partial.begin(), partial.end(), [&](const auto &branch) {
+                        return combo.choice[branch.first] == branch.second;
+                    });
+                });
+                if (blacklisted) {
+                    combo.state = OrCombination::State::Infeasible;
+                    m_metrics.or_combinations_pruned++;
+                    continue;
+                }
+                z3::expr_vector assumptions{m_solver_context};
+                for (size_t c = 0; c < combo.choice.size(); ++c) {
+                    assumptions.push_back(or_literal(c, combo.choice[c]));
+                }
+                if (check_sat(&assumptions) == z3::unsat) {
+                    // unsat core中的分支组合无论其余类怎么选都不可满足
+                    std::vector<std::pair<uint32_t, uint32_t>> partial{};
+                    for (const auto &lit: m_smt_solver.unsat_core()) {
+                        partial.push_back(m_or_literals.at(lit.id()));
+                    }
+                    info("infeasible OR branches: ", partial.size());
+                    m_or_blacklist.push_back(std::move(partial));
+                    combo.state = OrCombination::State::Infeasible;
+                    continue;
+                }
+                combo.state = OrCombination::State::Feasible;
+            }
+            if (combo.state == OrCombination::State::Feasible) {
+                return idx;
+            }
+        }
+        return std::nullopt;
+    }
+    z3::expr CConstraintVisitor::or_literal(size_t cls, uint32_t option) const {
+        size_t offset = 0;
+        for (size_t c = 0; c < cls; ++c) {
+            offset += m_or_classes[c].size();
+        }
+        return m_or_literal_exprs[offset + option];
+    }
+    void CConstraintVisitor::activate_or_combination(const std::vector<uint32_t> &choice) {
+        for (auto &[_, code]: or_expr_idmap) {
+            if (code >= 0) {
+                code &= ~1;
+            }
+        }
+        for (size_t c = 0; c < choice.size(); ++c) {
+            const auto expr_id = m_or_classes[c][choice[c]];
+            or_expr_idmap[expr_id] |= 1;
+            info("Add or expr into solver: ", all_expr_vector[expr_id].to_string());
+            m_smt_solver.add(all_expr_vector[expr_id]);
+        }
+    }
+    void CConstraintVisitor::activate_or_exprs() {
+        int last_or_class = 0;
+        std::vector<std::map<unsigned, int>::iterator> cur_or_exprs;
+        or_expr_idmap.emplace(all_expr_vector.size(), -2);
+        for (auto it = or_expr_idmap.begin(); it != or_expr_idmap.end(); it++) {
+            int cur_class = it->second >> 1;
+            if (it->second & 1) {
+                it->second--;
+            }
+            if (cur_class == last_or_class) {
+                cur_or_exprs.push_back(it);
+                continue;
+            }
+            size_t choose = 0;
+            if (coverage_feedback()) {
+                std::vector<double> weights{};
+                for (auto e: cur_or_exprs) {
+                    auto score = m_or_scores.find(e->first);
+                    weights.push_back(1.0 + (score == m_or_scores.end() ? 0.0 : score->second));
+                }
+                choose = std::discrete_distribution<size_t>(weights.begin(), weights.end())(random_g);
+            } else {
+                std::uniform_int_distribution<size_t> rf{0, cur_or_exprs.size() - 1};
+                choose = rf(random_g);
+            }
+            auto choosed_it = cur_or_exprs[choose];
+            choosed_it->second++;
+            info("Add or expr into solver: ", all_expr_vector[choosed_it->first].to_string());
+            m_smt_solver.add(all_expr_vector[choosed_it->first]);
+            last_or_class = cur_class;
+            cur_or_exprs.clear();
+            // Push the new class's first or_expr
+            cur_or_exprs.push_back(it);
+        }
+    }
+
+    bool CConstraintVisitor::coverage_feedback() const {
+        return m_harness != nullptr && m_harness->has_coverage() && !m_master_seed;
+    }
+
+    void CConstraintVisitor::execute_for_feedback(const json &single_case) {
+        TraceSpan span{"execute", "generate"};
+        auto result = m_harness->run(single_case, getDeclaredVariables(), m_struct_blueprints);
+        m_metrics.cases_executed++;
+        m_executed_cases.emplace(std::hash<json>{}(single_case), std::make_pair(static_cast<int>(result.status), result.signal));
+        if (result.new_edges == 0) {
+            return;
+        }
+        m_metrics.cases_new_coverage++;
+        info("new coverage: ", result.new_edges, " edges");
+        constexpr size_t MAX_PRODUCTIVE_VALUES = 16;
+        for (const auto &[name, value]: constraint_val_cur_value) {
+            m_var_scores[name] += 1;
+            auto &values = m_productive_values[name];
+            if (values.size() < MAX_PRODUCTIVE_VALUES) {
+                values.push_back(value);
+            } else {
+                values[std::uniform_int_distribution<size_t>(0, MAX_PRODUCTIVE_VALUES - 1)(random_g)] = value;
+            }
+        }
+        for (const auto &[expr_id, or_class]: or_expr_idmap) {
+            if (or_class >= 0 && (or_class & 1)) {
+                m_or_scores[expr_id] += 1;
+            }
+        }
+    }
+
+    void CConstraintVisitor::order_by_coverage(std::vector<z3::expr> &vars) {
+        // Efraimidis-Spirakis：键为u^(1/w)，按键降序
+        std::uniform_real_distribution<> u(0.0, 1.0);
+        std::vector<std::pair<double, size_t>> keys{};
+        for (size_t i = 0; i < vars.size(); ++i) {
+            auto score = m_var_scores.find(vars[i].to_string());
+            const double w = 1.0 + (score == m_var_scores.end() ? 0.0 : score->second);
+            keys.emplace_back(std::pow(u(random_g), 1.0 / w), i);
+        }
+        std::sort(keys.begin(), keys.end(), std::greater<>());
+        std::vector<z3::expr> ordered{};
+        for (const auto &[_, i]: keys) {
+            ordered.push_back(vars[i]);
+        }
+        vars = std::move(ordered);
+    }
+
+    int64_t CConstraintVisitor::pick_value(const std::string &var, int64_t lo, int64_t hi, int64_t fallback) {
+        auto it = m_productive_values.find(var);
+        if (it == m_productive_values.end() || std::bernoulli_distribution(0.5)(random_g)) {
+            return fallback;
+        }
+        const auto &values = it->second;
+        const auto base = values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(random_g)];
+        const auto v = base + std::uniform_int_distribution<int64_t>(-1, 1)(random_g);
+        return v >= lo && v <= hi ? v : fallback;
+    }
+
+    void CConstraintVisitor::generate_seeded(z3::expr_vector &original_exprs) {
+        if (positive == 'N') {
+            // 与变异循环一致，反例模式下不处理或语句
+            or_expr_idmap.clear();
+            constraint_val_expr_idmap.clear();
+        }
+        for (int i = 0; i < static_cast<int>(total_gen_cases); ++i) {
+            if (m_kept_ids.count(case_number_start + i)) {
+                continue;
+            }
+            TraceSpan span{"case", "generate"};
+            if (!generate_case(case_number_start + i, original_exprs)) {
+                println_local("case {}{:05d} could not be generated.", positive, case_number_start + i);
+            }
+            if (!check_memory()) {
+                break;
+            }
+        }
+        // 超过软上限时m_seeded_cases会分批写出并清空
+        cur_case = static_cast<unsigned>(m_metrics.cases_produced + m_kept_ids.size());
+    }
+
+    bool CConstraintVisitor::generate_case(int case_id, z3::expr_vector &original_exprs) {
+        // 用例的全部随机选择都来自(主种子, 正反例, 用例编号)确定的流，与其他用例无关
+        random_g = Philox(*m_master_seed, positive, static_cast<uint32_t>(case_id), 0);
+        m_case_id = case_id;
+        constraint_val_cur_value.clear();
+        // 模型与unsat core取决于求解器的历史(学到的子句、变量活跃度、相位)，每个用例换用新的求解器，
+        // 其中只有原约束，使用例不受同一线程中之前生成的用例影响
+        m_smt_solver = z3::solver{m_solver_context};
+        for (const auto &e: original_exprs) {
+            m_smt_solver.add(e);
+        }
+        m_last_core = z3::expr_vector{m_solver_context};
+        m_last_model.reset();
+        if (positive == 'N' && !random_flip_expr(original_exprs)) {
+            return false;
+        }
+        m_smt_solver.push();
+        if (!or_expr_idmap.empty()) {
+            activate_or_exprs();
+        }
+        auto order = constraint_val_list;
+        std::shuffle(order.begin(), order.end(), random_g);
+        // 依次为每个变量在传播得到的范围内取值，作为假设而不是逐个检查
+        z3::expr_vector assumptions{m_solver_context};
+        for (const auto &var: order) {
+            auto [lo, hi] = var_range(var);
+            if (hi < lo) {
+                continue;
+            }
+            auto v = std::uniform_int_distribution<int64_t>(lo, hi)(random_g);
+            constraint_val_cur_value[var.to_string()] = v;
+            assumptions.push_back(var == int_value_of(var.get_sort(), v));
+        }
+        bool ok = false;
+        for (;;) {
+            if (solve(&assumptions)) {
+                ok = true;
+                break;
+            }
+            if (assumptions.empty()) {
+                break;
+            }
+            // 去掉与约束冲突的赋值(unsat core)再试，每轮至少去掉一个
+            std::unordered_set<unsigned> core{};
+            for (const auto &c: m_last_core) {
+                core.insert(c.id());
+            }
+            z3::expr_vector kept{m_solver_context};
+            for (const auto &a: assumptions) {
+                if (core.count(a.id()) == 0) {
+                    kept.push_back(a);
+                }
+            }
+            if (kept.size() == assumptions.size()) {
+                kept = z3::expr_vector{m_solver_context};
+            }
+            assumptions = kept;
         }
+        m_smt_solver.pop();
+        constraint_val_cur_value.clear();
+        return ok;
     }
+
     void CConstraintVisitor::writeCases() {
+        write_pending();
+        println_local("finish validating generated cases with QJS.");
+        if (m_harness != nullptr) {
+            println_local("harness: {} cases run, {} crashed or timed out.", m_cases_written, m_harness_failures);
+        }
+    }
+
+    void CConstraintVisitor::write_pending() {
         // 验证
         auto templ = R"(var f = () => {{
     var _LENGTH = (e) => {{
@@ -863,45 +2514,266 @@ namespace ststgen {
         }
         auto js_runtime = JS_NewRuntime();
         auto js_ctx = JS_NewContext(js_runtime);
-        int cnt = 0;
-        for (auto &single_case : m_cases) {
-            auto js_src = fmt::format(templ, single_case.dump(), constraint_set);
-            auto ret = JS_Eval(js_ctx, js_src.c_str(), js_src.size(), nullptr, 0);
-            bool is_positive = JS_VALUE_GET_TAG(ret) == JS_TAG_BOOL && JS_VALUE_GET_BOOL(ret);
+        auto harness_params = getDeclaredVariables();
+        // 按种子生成的用例以其编号命名，未通过验证的编号空缺；否则按写出顺序连续编号
+        std::vector<std::pair<int, const json *>> ordered{};
+        if (m_master_seed) {
+            for (const auto &[id, c]: m_seeded_cases) {
+                ordered.emplace_back(id, &c);
+            }
+        } else {
+            for (const auto &c: m_cases) {
+                ordered.emplace_back(-1, &c);
+            }
+        }
+        for (const auto &[fixed_id, case_ptr]: ordered) {
+            const auto &single_case = *case_ptr;
+            while (fixed_id < 0 && m_kept_ids.count(case_number_start + m_next_case_offset)) {
+                ++m_next_case_offset;
+            }
+            const int case_id = fixed_id >= 0 ? fixed_id : case_number_start + m_next_case_offset;
+            bool is_positive = false;
+            {
+                TraceSpan span{"validate", "write"};
+                ScopedTimer validate_timer{m_metrics.times.validate};
+                auto js_src = fmt::format(templ, single_case.dump(), constraint_set);
+                auto ret = JS_Eval(js_ctx, js_src.c_str(), js_src.size(), nullptr, 0);
+                is_positive = JS_VALUE_GET_TAG(ret) == JS_TAG_BOOL && JS_VALUE_GET_BOOL(ret);
+                JS_FreeValue(js_ctx, ret);
+                is_verbose {
+                    // 原生求值器与JS验证应当一致
+                    const bool native = std::all_of(m_constraint_roots.cbegin(), m_constraint_roots.cend(), [&](ir::NodeId root) {
+                        return ir::evaluate(m_ir, root, single_case);
+                    });
+                    if (native != is_positive) {
+                        println_local("native evaluator disagrees with QJS ({} vs {}): {}", native, is_positive, single_case.dump());
+                    }
+                }
+            }
             if (positive == 'P' && !is_positive) {
-                println_local("constraint NOT positive but required positive: {}", cnt + case_number_start);
-                println_local("{}", single_case.dump(4));
+                m_metrics.cases_rejected++;
+                println_local("constraint NOT positive but required positive: {}", case_id);
+                if (!m_quiet_log) {
+                    println_local("{}", single_case.dump(4));
+                }
                 continue;
             }
             if (positive == 'N' && is_positive) {
-                println_local("constraint NOT negative but required negative: {}", cnt + case_number_start);
-                println_local("{}", single_case.dump(4));
+                m_metrics.cases_rejected++;
+                println_local("constraint NOT negative but required negative: {}", case_id);
+                if (!m_quiet_log) {
+                    println_local("{}", single_case.dump(4));
+                }
                 continue;
             }
             // Output
-            std::filesystem::path outfile = output_path / fmt::format("{}{:05d}.json", positive, cnt + case_number_start);
-            std::ofstream ofs(outfile);
-            if (ofs.is_open()) {
-                ofs << std::setw(4) << single_case;
-                ofs.close();
+            std::filesystem::path outfile = output_path / fmt::format("{}{:05d}.json", positive, case_id);
+            {
+                TraceSpan span{"write", "write"};
+                ScopedTimer write_timer{m_metrics.times.write};
+                std::ofstream ofs(outfile);
+                if (ofs.is_open()) {
+                    write_case(ofs, single_case, harness_params);
+                    ofs.close();
+                } else {
+                    info("Error: can not open", outfile.string(), "for output!");
+                    write_case(std::cout, single_case, harness_params);
+                }
+            }
+            if (m_harness != nullptr) {
+                Harness::Result result{};
+                if (auto executed = m_executed_cases.find(std::hash<json>{}(single_case)); executed != m_executed_cases.end()) {
+                    result.status = static_cast<Harness::Status>(executed->second.first);
+                    result.signal = executed->second.second;
+                } else {
+                    result = m_harness->run(single_case, harness_params, m_struct_blueprints);
+                }
+                if (result.status != Harness::Status::Ok) {
+                    m_harness_failures++;
+                    m_harness->record(outfile.stem().string(), result);
+                    println_local("harness: case {} {} (signal {})", outfile.stem().string(), Harness::status_name(result.status), result.signal);
+                }
+            }
+            m_cases_written++;
+            m_next_case_offset++;
+        }
+        JSMemoryUsage js_usage{};
+        JS_ComputeMemoryUsage(js_runtime, &js_usage);
+        m_metrics.memory_qjs_peak = std::max(m_metrics.memory_qjs_peak, static_cast<uint64_t>(js_usage.malloc_size));
+        JS_FreeContext(js_ctx);
+        JS_FreeRuntime(js_runtime);
+        // 写出过的用例不再留在内存里，只留hash供去重
+        if (m_master_seed) {
+            m_seeded_cases.clear();
+        } else {
+            for (const auto &c: m_cases) {
+                m_flushed_cases.insert(std::hash<json>{}(c));
+            }
+            m_cases.clear();
+        }
+        m_case_bytes = 0;
+    }
+
+    bool CConstraintVisitor::matches_declaration(const json &value, const SymbolTableEntry &entry, size_t depth) const {
+        if (entry.qualifer == SymbolTableEntryQualifer::Array && depth < entry.dims.size()) {
+            if (!value.is_array() || value.size() != static_cast<size_t>(entry.dims[depth])) {
+                return false;
+            }
+            return std::all_of(value.begin(), value.end(), [&](const json &e) {
+                return matches_declaration(e, entry, depth + 1);
+            });
+        }
+        if (entry.qualifer == SymbolTableEntryQualifer::Pointer && depth == 0) {
+            if (!value.is_array() || (m_pointer_encoding == PointerEncoding::Bounded && value.size() > static_cast<size_t>(m_max_pointer_length))) {
+                return false;
+            }
+            return std::all_of(value.begin(), value.end(), [&](const json &e) {
+                return matches_declaration(e, entry, depth + 1);
+            });
+        }
+        switch (entry.type) {
+            case SymbolTableEntryType::Int32:
+                return value.is_number_integer() && value.get<int64_t>() >= INT32_MIN && value.get<int64_t>() <= INT32_MAX;
+            case SymbolTableEntryType::UInt32:
+                return value.is_number_unsigned() && value.get<uint64_t>() <= UINT32_MAX;
+            case SymbolTableEntryType::Int64:
+                return value.is_number_integer() && (!value.is_number_unsigned() || value.get<uint64_t>() <= INT64_MAX);
+            case SymbolTableEntryType::UInt64:
+                return value.is_number_unsigned();
+            case SymbolTableEntryType::Float32:
+            case SymbolTableEntryType::Float64:
+                return value.is_number();
+            case SymbolTableEntryType::Struct: {
+                auto blueprint = m_struct_blueprints.find(entry.struct_name);
+                if (!value.is_object() || blueprint == m_struct_blueprints.end() || value.size() != blueprint->second.m_members.size()) {
+                    return false;
+                }
+                return std::all_of(blueprint->second.m_members.begin(), blueprint->second.m_members.end(), [&](const auto &member) {
+                    auto it = value.find(member.first);
+                    return it != value.end() && matches_declaration(*it, member.second);
+                });
+            }
+            default:
+                return false;
+        }
+    }
+
+    void CConstraintVisitor::revalidate_existing() {
+        TraceSpan span{"revalidate", "generate"};
+        const auto declared = getDeclaredVariables();
+        for (int id = case_number_start; id < case_number_start + static_cast<int>(total_gen_cases); ++id) {
+            const auto path = output_path / fmt::format("{}{:05d}.json", positive, id);
+            if (m_incremental == Incremental::Trust) {
+                // 不读入用例，因而也不参与去重
+                if (std::filesystem::exists(path)) {
+                    m_kept_ids.insert(id);
+                }
+                continue;
+            }
+            std::ifstream ifs(path);
+            if (!ifs.is_open()) {
+                continue;
+            }
+            const auto existing = json::parse(ifs, nullptr, false);
+            ifs.close();
+            // 变量增删、类型或维数改变的用例不能沿用
+            bool valid = existing.is_object() && existing.size() == declared.size() &&
+                         std::all_of(declared.begin(), declared.end(), [&](const auto &var) {
+                             auto it = existing.find(var.first);
+                             return it != existing.end() && matches_declaration(*it, var.second);
+                         });
+            if (valid) {
+                const bool holds = std::all_of(m_constraint_roots.cbegin(), m_constraint_roots.cend(), [&](ir::NodeId root) {
+                    return ir::evaluate(m_ir, root, existing);
+                });
+                valid = holds == (positive == 'P');
+            }
+            // 未按种子生成时重复的用例只保留一个，其余计入去重
+            if (valid && !m_master_seed) {
+                valid = m_flushed_cases.insert(std::hash<json>{}(existing)).second;
+            }
+            if (valid) {
+                m_kept_ids.insert(id);
             } else {
-                info("Error: can not open", outfile.string(), "for output!");
-                std::cout << std::setw(4) << single_case;
+                m_metrics.cases_invalidated++;
+                std::filesystem::remove(path);
             }
-            cnt++;
         }
-        println_local("finish validating generated cases with QJS.");
+        m_metrics.cases_kept = m_kept_ids.size();
+        if (m_incremental == Incremental::Trust) {
+            m_unhashed_kept = m_kept_ids.size();
+        }
+        cur_case = static_cast<unsigned>(m_kept_ids.size());
+        println_local("incremental: kept {} existing cases, {} no longer hold, {} to generate.",
+                      m_metrics.cases_kept, m_metrics.cases_invalidated, total_gen_cases - cur_case);
+    }
+
+    bool CConstraintVisitor::check_memory() {
+        const uint64_t workers = std::max(1u, m_memory_limits.workers);
+        auto usage = [&] {
+            const uint64_t z3 = Z3_get_estimated_alloc_size() / workers;
+            const uint64_t log = local_log.capacity();
+            m_metrics.memory_z3_peak = std::max(m_metrics.memory_z3_peak, z3);
+            m_metrics.memory_cases_peak = std::max<uint64_t>(m_metrics.memory_cases_peak, m_case_bytes);
+            m_metrics.memory_log_peak = std::max(m_metrics.memory_log_peak, log);
+            const uint64_t total = z3 + m_case_bytes + log;
+            m_metrics.memory_peak = std::max(m_metrics.memory_peak, total);
+            return total;
+        };
+        // 只设了硬上限时，先在硬上限处尝试同样的措施
+        const auto relief = m_memory_limits.soft != 0 ? m_memory_limits.soft : m_memory_limits.hard;
+        if (usage() < relief || relief == 0) {
+            return true;
+        }
+        m_metrics.memory_flushes++;
+        if (!m_quiet_log) {
+            m_quiet_log = true;
+            println_local("memory above {} MiB, writing cases early and omitting per-cycle log.", relief >> 20);
+        }
+        write_pending();
+        // 能释放的只有用例、日志与求解器的搜索状态；z3::context中的项、IR与各映射在生成器的整个生命周期内保留，
+        // 它们的增长只由硬上限约束。两轮变异、两个用例之间求解器都在最外层，z3的分配量自上次重建后增长了才重建
+        const uint64_t z3_now = Z3_get_estimated_alloc_size() / workers;
+        if (z3_now > m_z3_after_reset) {
+            auto assertions = m_smt_solver.assertions();
+            m_smt_solver.reset();
+            for (auto a: assertions) {
+                m_smt_solver.add(a);
+            }
+            m_metrics.solver_resets++;
+            m_z3_after_reset = Z3_get_estimated_alloc_size() / workers;
+        }
+#ifdef __GLIBC__
+        // 释放的内存交还给系统，RSS才会下降
+        malloc_trim(0);
+#endif
+        if (m_memory_limits.hard == 0 || usage() < m_memory_limits.hard) {
+            return true;
+        }
+        m_metrics.memory_limited++;
+        println_local("memory above the {} MiB hard limit, stopping after {} cases.", m_memory_limits.hard >> 20, m_metrics.cases_produced);
+        return false;
+    }
+
+    std::vector<std::pair<std::string, SymbolTableEntry>> CConstraintVisitor::getDeclaredVariables() {
+        std::vector<std::pair<std::string, SymbolTableEntry>> ret{};
+        auto &globals = m_symbol_table.get_scope(0);
+        for (const auto &name: m_symbol_table.get_global_order()) {
+            ret.emplace_back(name, globals.at(name));
+        }
+        return ret;
     }
 
     z3::expr CConstraintVisitor::replaceKnownVar(z3::expr inp, int &unknown_count) {
         auto str = inp.to_string();
-        if (inp.is_numeral()) {
+        // 有界指针的槽位lambda不含待取值的变量
+        if (inp.is_numeral() || !inp.is_app()) {
             return inp;
         }
         if (constraint_val_expr_idmap.count(str)) {
             // 属于原子变量，终止递归
             if (constraint_val_cur_value.count(str)) {
-                return m_solver_context.int_val(constraint_val_cur_value[str]);
+                return int_value_of(inp.get_sort(), constraint_val_cur_value[str]);
             } else {
                 unknown_count++;
                 return inp;
@@ -915,9 +2787,39 @@ namespace ststgen {
         return inp.decl()(inp_args);
     }
 
+    z3::check_result CConstraintVisitor::check_and_extract() {
+        const bool sampled = std::any_of(m_gaussian_cons.begin(), m_gaussian_cons.end(), [](const GaussianCons &g) {
+            return !g.post_sample;
+        });
+        if (!sampled) {
+            auto res = check_sat();
+            if (res == z3::sat) {
+                m_metrics.checks_saved++;
+                extract(m_smt_solver.get_model());
+            }
+            return res;
+        }
+        // 取样值只加在内层作用域，子树中的用例各自重新取样
+        m_smt_solver.push();
+        generate_gaussian();
+        if (check_sat() == z3::sat) {
+            auto model = m_smt_solver.get_model();
+            m_smt_solver.pop();
+            m_metrics.checks_saved++;
+            extract(model);
+            return z3::sat;
+        }
+        m_smt_solver.pop();
+        // 取样值与约束冲突：叶子处的结果只决定是否继续下降，而下面已没有变量，不必再检查一次
+        return z3::unsat;
+    }
+
     void CConstraintVisitor::mutateVar(expr_iter var_i) {
         if (var_i == constraint_val_list.end()) {
-            solve();
+            // 最后一个变量取值时已从同一查询的模型中提取过用例，没有变量时才需要求解
+            if (var_i == constraint_val_list.begin()) {
+                solve();
+            }
             return;
         }
         auto val_name = (*var_i).to_string();
@@ -925,11 +2827,83 @@ namespace ststgen {
         auto next_var_i = var_i;
         ++next_var_i;
 
+        std::vector<int64_t> constants{};
+        auto [val_min, val_max] = var_range(*var_i, m_boundary ? &constants : nullptr);
+        if (val_max < val_min) {
+            info("Empty range, skip!");
+            return;
+        }
+        std::vector<int64_t> boundary{};
+        if (m_boundary) {
+            boundary = boundary_candidates(val_name, val_min, val_max, constants);
+        }
+        // Random choose a number in [val_min, val_max]
+        std::uniform_int_distribution<int64_t> rf(val_min, val_max);
+        constexpr uint64_t DEFAULT_VARIABLE_MUTATE_TIMES = 3;
+        // 区间为整个int64时span + 1会回绕为0，先比较再加一
+        const uint64_t span = static_cast<uint64_t>(val_max) - static_cast<uint64_t>(val_min);
+        const uint64_t tries = span >= DEFAULT_VARIABLE_MUTATE_TIMES - 1 ? DEFAULT_VARIABLE_MUTATE_TIMES : span + 1;
+        for (unsigned i = 0; i < tries && cur_case < m_case_limit; i++) {
+            int64_t assigned_value = rf(random_g);
+            if (i < boundary.size()) {
+                assigned_value = boundary[i];
+            } else if (coverage_feedback()) {
+                assigned_value = pick_value(val_name, val_min, val_max, assigned_value);
+            }
+            constraint_val_cur_value[val_name] = assigned_value;
+            z3::expr cons = (*var_i) == int_value_of(var_i->get_sort(), assigned_value);
+            m_smt_solver.push();
+            m_smt_solver.add(cons);
+            // 只在全部变量都取值后提取用例，中间层的模型里其余变量只是求解器的默认值
+            const auto res = next_var_i == constraint_val_list.end() ? check_and_extract() : check_sat();
+            if (res == z3::sat) {
+                mutateVar(next_var_i);
+            }
+            m_smt_solver.pop();
+        }
+        constraint_val_cur_value.erase(val_name);
+    }
+
+    std::vector<int64_t> CConstraintVisitor::boundary_candidates(const std::string &var, int64_t lo, int64_t hi, const std::vector<int64_t> &constants) {
+        // int64两端不再外延
+        auto step = [](int64_t v, int d) {
+            return (d < 0 && v == INT64_MIN) || (d > 0 && v == INT64_MAX) ? v : v + d;
+        };
+        std::vector<int64_t> points{};
+        if (positive == 'P') {
+            points = {lo, hi, step(lo, 1), step(hi, -1)};
+            for (auto c: constants) {
+                points.insert(points.end(), {step(c, -1), c, step(c, 1)});
+            }
+        } else {
+            // 反例取原约束各边界外侧紧邻的值，当前的[lo, hi]只剩类型范围
+            const auto &orig = m_original_bounds[var];
+            points = {step(orig.lo, -1), step(orig.hi, 1)};
+            for (auto c: orig.constants) {
+                points.insert(points.end(), {step(c, -1), step(c, 1)});
+            }
+        }
+        std::vector<int64_t> fresh{}, seen{};
+        auto &targets = m_boundary_targets[var];
+        const auto &hits = m_boundary_hits[var];
+        for (auto p: points) {
+            if (p < lo || p > hi || std::count(fresh.begin(), fresh.end(), p) || std::count(seen.begin(), seen.end(), p)) {
+                continue;
+            }
+            targets.insert(p);
+            (hits.count(p) ? seen : fresh).push_back(p);
+        }
+        // 尚未命中的边界优先
+        fresh.insert(fresh.end(), seen.begin(), seen.end());
+        return fresh;
+    }
+
+    std::pair<int64_t, int64_t> CConstraintVisitor::var_range(const z3::expr &var, std::vector<int64_t> *constants) {
+        const auto val_name = var.to_string();
         // 更新变量可取范围
         int64_t val_min = INT_MIN, val_max = INT_MAX;
-        if (val_name.find("seq.len") != std::string::npos) {
-            val_min = 1;
-            val_max = 100;
+        if (auto bounds = m_var_bounds.find(val_name); bounds != m_var_bounds.end()) {
+            std::tie(val_min, val_max) = bounds->second;
         }
         for (auto expr_id: constraint_val_expr_idmap[val_name]) {
             auto or_map_find_it = or_expr_idmap.find(expr_id);
@@ -968,6 +2942,9 @@ namespace ststgen {
             int64_t right_value = clause1.get_numeral_int64();
             switch (expr.decl().decl_kind()) {
                 case Z3_OP_EQ:
+                    if (constants != nullptr) {
+                        constants->push_back(right_value);
+                    }
                     if (!is_not_set) {
                         val_max = right_value;
                         val_min = val_max;
@@ -990,37 +2967,33 @@ namespace ststgen {
                     break;
             }
         }
-        if (val_min > INT_MAX || val_max < INT_MIN || val_max < val_min) {
-            info("Overflow, skip!");
-            return;
-        }
-        // Random choose a number in [val_min, val_max]
-        std::uniform_int_distribution<int> rf(val_min, val_max);
-        uint64_t length = val_max - val_min + 1;
-        constexpr uint64_t DEFAULT_VARIABLE_MUTATE_TIMES = 3;
-        for (unsigned i = 0; i < std::min(length, DEFAULT_VARIABLE_MUTATE_TIMES) && cur_case < total_gen_cases; i++) {
-            int assigned_value = rf(random_g);
-            constraint_val_cur_value[val_name] = assigned_value;
-            z3::expr cons = (*var_i) == assigned_value;
-            m_smt_solver.push();
-            m_smt_solver.add(cons);
-            try {
-                if (m_smt_solver.check() == z3::sat) {
-                    solve();
-                    mutateVar(next_var_i);
-                }
-            } catch(std::exception&) {
-                m_smt_solver.pop();
-                break;
-            }
-            m_smt_solver.pop();
+        return {val_min, val_max};
+    }
+
+    z3::check_result CConstraintVisitor::check_sat(const z3::expr_vector *assumptions) {
+        TraceSpan span{"check", "solver"};
+        auto begin = std::chrono::steady_clock::now();
+        auto res = assumptions == nullptr ? m_smt_solver.check() : m_smt_solver.check(*assumptions);
+        m_last_check = res;
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - begin;
+        m_metrics.times.solve += elapsed;
+        m_metrics.check_latency.add(elapsed);
+        if (res == z3::sat) {
+            m_metrics.checks_sat++;
+        } else if (res == z3::unsat) {
+            m_metrics.checks_unsat++;
+        } else {
+            m_metrics.checks_unknown++;
         }
-        constraint_val_cur_value.erase(val_name);
+        return res;
     }
 
     void CConstraintVisitor::generate_gaussian() {
         constexpr int64_t precision = 1e10;
         for (auto &gauss_cons: m_gaussian_cons) {
+            if (gauss_cons.post_sample) {
+                continue;
+            }
             auto expr = gauss_cons.val;
             info(expr.to_string(), (int)expr.get_sort().sort_kind());
             auto rand_value = gauss_cons.normal_gen(random_g);
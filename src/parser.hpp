@@ -1,13 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <bitset>
+#include <set>
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <thread>
 
 #include "CBaseVisitor.h"
+#include "ir.hpp"
+#include "metrics.hpp"
+#include "rng.hpp"
 #include "utils.hpp"
 
 #include "quickjs.h"
@@ -22,6 +28,59 @@ namespace ststgen {
     using json = nlohmann::json;
     /// @brief 为展开的struct各成员命名
     std::string make_member_name(const std::string &var, const std::string &member, const std::vector<int> &idx);
+    /// @brief 为展平的数组各元素命名
+    std::string make_element_name(const std::string &var, const std::vector<int> &idx);
+
+    /// @brief 为有界编码下指针的长度变量/字段命名
+    inline std::string make_length_name(const std::string &var) {
+        // '#'不能出现在C标识符中，不会与约束文件中的变量重名
+        return var + "#len";
+    }
+
+    /// @brief 指针的编码方式
+    enum class PointerEncoding {
+        // 无界的seq，_LENGTH为seq.len
+        Seq,
+        // 显式的长度变量加上至多max_pointer_length个槽位，元素访问要求下标小于长度
+        Bounded,
+    };
+
+    /// @brief 定长数组的编码方式
+    enum class ArrayEncoding {
+        // 嵌套的Array Int (Array Int ...)
+        Nested,
+        // 每个被引用的元素一个标量常量，全部下标为常量时可用，否则该变量退回Nested
+        // 元素不少于LARGE_ARRAY_ELEMENTS的数组在Nested下同样按此规则展平
+        Flat,
+    };
+
+    /// @brief 结构体的编码方式
+    enum class StructEncoding {
+        // z3 tuple sort，成员为getter
+        Tuple,
+        // 每个被引用的成员一个标量常量(make_member_name)，成员都以常量路径访问时可用，否则该变量退回Tuple
+        Flat,
+    };
+
+    /// @brief 单个生成器的内存上限(字节)，0为不限
+    /// z3的分配量是整个进程的，按生成器数平摊后计入
+    struct MemoryLimits {
+        // 超过时释放能释放的部分：写出已有用例、精简日志、重建求解器(丢掉搜索状态)。
+        // z3::context及其中的项不重建，这部分只能由硬上限约束
+        size_t soft = 0;
+        // 上述措施之后仍超过时停止生成
+        size_t hard = 0;
+        unsigned workers = 1;
+    };
+
+    /// @brief 增量模式下如何对待输出目录中已有的用例
+    enum class Incremental {
+        Off,
+        // 约束文件与上次相同(见manifest)：已有用例都仍成立，只看文件是否存在
+        Trust,
+        // 约束文件改变或没有manifest：逐个读入并重新验证
+        Revalidate,
+    };
 
     enum class SymbolTableEntryQualifer {
         Pointer,
@@ -61,16 +120,29 @@ namespace ststgen {
     struct GaussianCons {
         z3::expr val;
         std::normal_distribution<> normal_gen;
-        GaussianCons(const z3::expr &v, double mu, double sigma) : val(v), normal_gen(mu, sigma) {}
+        ir::NodeId target;
+        // 变量在用例json中的位置，下标不是常量时为空
+        std::optional<nlohmann::json::json_pointer> path = std::nullopt;
+        // 变量只受常量上下界约束时，求解后在[lo, hi]内按截断正态分布采样，不进入求解器
+        bool post_sample = false;
+        bool integral = false;
+        double lo = -std::numeric_limits<double>::infinity();
+        double hi = std::numeric_limits<double>::infinity();
+        GaussianCons(const z3::expr &v, double mu, double sigma, ir::NodeId target) : val(v), normal_gen(mu, sigma), target(target) {}
     };
     struct StructBlueprint {
         void push_member(const std::string &name, SymbolTableEntry &&member) {
             m_members.insert({name, std::move(member)});
+            m_member_order.push_back(name);
         }
         // ordered to find getters easier
         std::map<std::string, SymbolTableEntry> m_members{};
+        // declaration order, needed to reproduce the C layout
+        std::vector<std::string> m_member_order{};
         std::optional<z3::func_decl> sym_constructor = std::nullopt;
         std::optional<z3::func_decl_vector> sym_getters = std::nullopt;
+        // 成员名(含有界指针的长度字段) -> sym_getters中的下标
+        std::unordered_map<std::string, unsigned> m_getter_index{};
     };
     class SymbolTable {
     public:
@@ -88,9 +160,17 @@ namespace ststgen {
             return m_table[level];
         }
         void add_entry(const std::string &name, const SymbolTableEntry &entry) {
+            if (m_table.size() == 1 && m_table.back().count(name) == 0) {
+                m_global_order.push_back(name);
+            }
             m_table.back().insert({name, entry});
         }
 
+        /// @brief 全局变量的声明顺序
+        const std::vector<std::string> &get_global_order() const {
+            return m_global_order;
+        }
+
         int get_scope_level() const {
             return m_table.size();
         }
@@ -120,7 +200,9 @@ namespace ststgen {
 
     private:
         std::vector<ScopeTable> m_table{};
+        std::vector<std::string> m_global_order{};
     };
+    class Harness;
     class CConstraintVisitor : public c11parser::CBaseVisitor {
     public:
         CConstraintVisitor(int case_number, bool is_positive, int case_number_start) : total_gen_cases(case_number), case_number_start(case_number_start) {
@@ -132,41 +214,126 @@ namespace ststgen {
         // virtual std::any visitBlockItemList(c11parser::CParser::BlockItemListContext *ctx) override;
         // virtual std::any visitBlockItem(c11parser::CParser::BlockItemContext *ctx) override;
         std::any visitExpressionStatement(c11parser::CParser::ExpressionStatementContext *ctx) override;
-        std::any visitPrimaryExpression(c11parser::CParser::PrimaryExpressionContext *ctx) override;
-
-        std::any visitPostfixExpression(c11parser::CParser::PostfixExpressionContext *ctx) override;
-        std::any visitArgumentExpressionList(c11parser::CParser::ArgumentExpressionListContext *ctx) override;
-        std::any visitUnaryExpression(c11parser::CParser::UnaryExpressionContext *ctx) override;
-
-        std::any visitCastExpression(c11parser::CParser::CastExpressionContext *ctx) override;
-        std::any visitMultiplicativeExpression(c11parser::CParser::MultiplicativeExpressionContext *ctx) override;
-        std::any visitAdditiveExpression(c11parser::CParser::AdditiveExpressionContext *ctx) override;
-        std::any visitShiftExpression(c11parser::CParser::ShiftExpressionContext *ctx) override;
-        std::any visitRelationalExpression(c11parser::CParser::RelationalExpressionContext *ctx) override;
-        std::any visitEqualityExpression(c11parser::CParser::EqualityExpressionContext *ctx) override;
-        std::any visitAndExpression(c11parser::CParser::AndExpressionContext *ctx) override;
-        std::any visitExclusiveOrExpression(c11parser::CParser::ExclusiveOrExpressionContext *ctx) override;
-        std::any visitInclusiveOrExpression(c11parser::CParser::InclusiveOrExpressionContext *ctx) override;
-        std::any visitLogicalAndExpression(c11parser::CParser::LogicalAndExpressionContext *ctx) override;
-        std::any visitLogicalOrExpression(c11parser::CParser::LogicalOrExpressionContext *ctx) override;
-        std::any visitConditionalExpression(c11parser::CParser::ConditionalExpressionContext *ctx) override;
-        std::any visitAssignmentExpression(c11parser::CParser::AssignmentExpressionContext *ctx) override;
-        std::any visitExpression(c11parser::CParser::ExpressionContext *ctx) override;
         using expr_iter = std::vector<z3::expr>::iterator;
-        bool solve();
+        /// @param assumptions 按种子生成时对变量取值的假设，unsat时冲突部分存入m_last_core
+        bool solve(const z3::expr_vector *assumptions = nullptr);
+        /// @brief 从模型提取用例并去重，记入m_cases(按种子生成时记入m_seeded_cases)
+        bool extract(const z3::model &model);
+        /// @brief 检查当前查询，可满足时直接用这次的模型提取用例，不再由solve()重新求解
+        /// 带GAUSSIAN取样值的查询不可满足时返回unsat，不再单独检查不带取样值的约束
+        z3::check_result check_and_extract();
         void update_constraint_val_map(z3::expr &clause, unsigned expr_id);
         void mutateVar(expr_iter var_i);
+        /// @brief 由已取值的变量传播得到var的取值范围，空时lo>hi
+        /// @param constants 非空时收集与var比较相等/不等的常量
+        std::pair<int64_t, int64_t> var_range(const z3::expr &var, std::vector<int64_t> *constants = nullptr);
+        /// @brief 边界模式下var应优先尝试的取值：正例为范围两端及其内侧、等式常量及其两侧，
+        /// 反例为原约束边界外侧紧邻的值；未命中过的排在前面
+        std::vector<int64_t> boundary_candidates(const std::string &var, int64_t lo, int64_t hi, const std::vector<int64_t> &constants);
+        /// @brief 每个或语句类中随机激活一条，调用方负责push/pop
+        void activate_or_exprs();
+        /// @brief 列出要尝试的或分支组合：组合数不多时全部列出，否则取两两覆盖的一组
+        void build_or_combinations();
+        void build_pairwise_combinations();
+        /// @brief 轮转到下一个可满足的组合，首次遇到时检查并把unsat core记入黑名单
+        std::optional<size_t> next_or_combination();
+        z3::expr or_literal(size_t cls, uint32_t option) const;
+        /// @brief 按组合激活各类中的一条，调用方负责push/pop
+        void activate_or_combination(const std::vector<uint32_t> &choice);
+        /// @brief harness的被测库带覆盖插桩时，用新覆盖引导变异(按种子生成时不启用)
+        bool coverage_feedback() const;
+        /// @brief 执行新用例，有新覆盖时给当前激活的或语句与变量取值加分
+        void execute_for_feedback(const json &single_case);
+        /// @brief 加权随机排列，分数高的变量更可能排在前面先被变异
+        void order_by_coverage(std::vector<z3::expr> &vars);
+        /// @brief 以一半概率重试带来过新覆盖的取值(或其相邻值)
+        int64_t pick_value(const std::string &var, int64_t lo, int64_t hi, int64_t fallback);
+        /// @brief 按主种子逐个编号独立生成用例，结果与线程数、其他用例无关
+        void generate_seeded(z3::expr_vector &original_exprs);
+        bool generate_case(int case_id, z3::expr_vector &original_exprs);
         void setRandomSeed(unsigned s) {
-            random_g = std::mt19937_64(s);
+            random_g = Philox(s);
+        }
+        /// @brief 设置后每个用例由(主种子, 正反例, 编号)独立生成，可用--case单独重新生成
+        void setMasterSeed(uint64_t seed) {
+            m_master_seed = seed;
         }
         void mutateEntrance(const std::string &outpath);
+        /// @brief 找出本生成器编号范围内已有的用例：Trust时只看文件是否存在，
+        /// Revalidate时读入并保留仍符合声明与约束的，删除其余
+        void revalidate_existing();
+        /// @brief 用例中的值与变量声明的类型、维数一致
+        bool matches_declaration(const json &value, const SymbolTableEntry &entry, size_t depth = 0) const;
+        /// @brief 验证并写出尚未写出的用例
         void writeCases();
+        /// @brief 估计当前占用并记入指标，超过软上限时写出用例、精简日志、必要时重建求解器
+        /// @return 仍超过硬上限时返回false，调用方应停止生成
+        bool check_memory();
+        void setMemoryLimits(MemoryLimits limits) {
+            m_memory_limits = limits;
+        }
         void generate_gaussian();
+        /// @brief 约束全部生成后，找出只受上下界约束、可以求解后再采样的GAUSSIAN变量
+        void classify_gaussian();
+        /// @brief 收集root中对target的常量上下界，target以其他形式出现时返回false
+        bool collect_gaussian_bounds(ir::NodeId root, GaussianCons &g);
+        bool mentions(ir::NodeId id, ir::NodeId target) const;
+        std::optional<nlohmann::json::json_pointer> json_path(ir::NodeId id) const;
+        double sample_truncated_normal(GaussianCons &g);
+        /// @brief 写入求解后采样的值，并把所有GAUSSIAN变量的取值计入直方图
+        void apply_gaussian_samples(json &solve);
+        void record_gaussian_samples(const json &solve);
         z3::expr replaceKnownVar(z3::expr inp, int &unknown_count);
-        void random_flip_expr(z3::expr_vector &original_exprs);
+        /// @return 若干次随机翻转都不可满足时返回false
+        bool random_flip_expr(z3::expr_vector &original_exprs);
+        /// @brief 变异停滞时逐个排除已得到的解来枚举剩余的解
+        /// @return 解已取尽或没有得到新用例时返回false
+        bool enumerate_remaining(z3::expr_vector &original_exprs);
         void print() {
             fmt::print("{}", fmt::to_string(local_log));
         }
+        /// @brief 须在visit之前设置
+        void setArrayEncoding(ArrayEncoding encoding) {
+            m_array_encoding = encoding;
+        }
+        /// @brief 须在visit之前设置
+        void setStructEncoding(StructEncoding encoding) {
+            m_struct_encoding = encoding;
+        }
+        /// @brief 变异时优先取变量范围的边界值
+        void setBoundary(bool enable) {
+            m_boundary = enable;
+        }
+        /// @brief 生成前保留输出目录中仍成立的已有用例及其编号，只补足其余
+        void setIncremental(Incremental mode) {
+            m_incremental = mode;
+        }
+        /// @brief 须在visit之前设置，整数类型编码为32/64位位向量
+        void setBitvec(bool enable) {
+            m_bitvec = enable;
+        }
+        /// @brief 须在visit之前设置
+        void setPointerEncoding(PointerEncoding encoding, int max_length) {
+            m_pointer_encoding = encoding;
+            m_max_pointer_length = max_length;
+        }
+        void setHarness(Harness *harness) {
+            m_harness = harness;
+        }
+        const std::unordered_map<std::string, StructBlueprint> &getStructBlueprints() const {
+            return m_struct_blueprints;
+        }
+        /// @brief 按声明顺序返回全局变量
+        std::vector<std::pair<std::string, SymbolTableEntry>> getDeclaredVariables();
+        const ir::Arena &getIR() const {
+            return m_ir;
+        }
+        const std::vector<ir::NodeId> &getConstraintRoots() const {
+            return m_constraint_roots;
+        }
+        WorkerMetrics &getMetrics() {
+            return m_metrics;
+        }
 
 
     private:
@@ -176,9 +343,27 @@ namespace ststgen {
         const std::vector<std::string> m_primitive{"_LENGTH", "GAUSSIAN"};
         SymbolTable m_symbol_table{};
         std::unordered_map<std::string, StructBlueprint> m_struct_blueprints{};
+        // tuple sort的id -> 蓝图，指向m_struct_blueprints中的元素
+        std::unordered_map<unsigned, const StructBlueprint *> m_blueprint_by_sort{};
         std::vector<GaussianCons> m_gaussian_cons{};
+        struct EliminatedTerm {
+            ir::NodeId target;
+            z3::expr term;
+            // 只含未消去的项
+            z3::expr definition;
+            nlohmann::json::json_pointer path;
+            SymbolTableEntryType type;
+        };
+        std::vector<EliminatedTerm> m_eliminated{};
         bool m_process_constraint_statement = false;
-        std::mt19937_64 random_g;
+        Philox random_g{};
+        std::optional<uint64_t> m_master_seed = std::nullopt;
+        int m_case_id = 0;
+        // 按种子生成的用例，键为编号
+        std::map<int, json> m_seeded_cases{};
+        z3::expr_vector m_last_core{m_solver_context};
+        std::optional<z3::model> m_last_model = std::nullopt;
+        z3::check_result m_last_check = z3::unknown;
         unsigned total_gen_cases, cur_case;
         char positive;
         std::filesystem::path output_path;
@@ -186,18 +371,194 @@ namespace ststgen {
         std::vector<z3::expr> all_expr_vector{};
         std::map<unsigned, int> or_expr_idmap;
         int or_class_id = 0;// 标识在一个或表达式中的所有子句
+        // 系统枚举或分支：每类的子句expr_id、各子句的跟踪文字
+        std::vector<std::vector<unsigned>> m_or_classes{};
+        std::vector<z3::expr> m_or_literal_exprs{};
+        // 跟踪文字的ast id -> (类, 分支)
+        std::unordered_map<unsigned, std::pair<uint32_t, uint32_t>> m_or_literals{};
+        struct OrCombination {
+            enum class State {
+                Unknown,
+                Feasible,
+                Infeasible,
+            };
+            std::vector<uint32_t> choice;
+            State state = State::Unknown;
+        };
+        std::vector<OrCombination> m_or_combinations{};
+        size_t m_or_cursor = 0;
+        // 已知不可满足的部分组合，含有其中任一个的组合直接跳过
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> m_or_blacklist{};
+        // 本轮变异最多生成到第几个用例，用于在或分支组合间平分预算
+        unsigned m_case_limit = 0;
         std::map<std::string, std::vector<unsigned>> constraint_val_expr_idmap;
-        std::map<std::string, int> constraint_val_cur_value;
+        std::map<std::string, int64_t> constraint_val_cur_value;
 
         std::string m_cons_src{};
         std::vector<std::string> m_cons_expressions{};
+        ir::Arena m_ir{};
+        // 每条约束语句的IR根节点，与m_cons_expressions一一对应
+        std::vector<ir::NodeId> m_constraint_roots{};
+        // _CONSTRAINT中尚未生成z3约束的语句及其源码
+        std::vector<std::pair<ir::NodeId, std::string>> m_pending_statements{};
+        ArrayEncoding m_array_encoding = ArrayEncoding::Nested;
+        // 存在非常量下标等用法、不能展平的数组
+        std::unordered_set<std::string> m_nested_arrays{};
+        std::unordered_map<std::string, z3::expr> m_flat_elements{};
+        // 各变量已生成的展平元素的下标，大数组只提取这些元素
+        std::unordered_map<std::string, std::vector<std::vector<int>>> m_flat_indices{};
+        StructEncoding m_struct_encoding = StructEncoding::Tuple;
+        // 存在整体引用、非常量路径等用法、不能展平的结构体变量
+        std::unordered_set<std::string> m_tuple_structs{};
+        bool m_bitvec = false;
+        PointerEncoding m_pointer_encoding = PointerEncoding::Seq;
+        int m_max_pointer_length = 100;
+        // 有界编码下各指针(或展平的指针成员)槽位的lambda，按名字
+        std::unordered_map<std::string, z3::expr> m_slot_arrays{};
+        // 有界指针元素访问的下标范围条件，按IR节点缓存
+        std::unordered_map<ir::NodeId, z3::expr> m_index_guards{};
+        // 正在生成的比较式中尚未合取的下标范围条件
+        std::vector<z3::expr> m_pending_guards{};
+        // 已加过取值范围约束的项(长度、变量、元素、成员)，按z3 ast id
+        std::unordered_set<unsigned> m_ranged_terms{};
+        // 变量本身的取值范围约束，反例模式下不翻转
+        std::vector<z3::expr> m_domain_constraints{};
+        std::unordered_set<unsigned> m_domain_constraint_ids{};
+        // mutateVar中变量(按to_string)的初始取值范围
+        std::unordered_map<std::string, std::pair<int64_t, int64_t>> m_var_bounds{};
+        // 出现在约束中的全局变量
+        std::unordered_set<std::string> m_referenced_vars{};
+        // 不经成员访问而整体出现的变量，其全部成员都视为被引用
+        std::unordered_set<std::string> m_whole_referenced{};
+        std::set<std::pair<std::string, std::string>> m_referenced_members{};
+        // solve()中正在提取的全局变量
+        std::string m_extract_var{};
+        // 算术项的z3表达式，按NodeId索引，共享子表达式只生成一次
+        std::vector<std::optional<z3::expr>> m_z3_cache{};
         std::unordered_set<json> m_cases{};
+        // 内存超限时已写出并移出m_cases的用例(按hash)，仍参与去重
+        std::unordered_set<size_t> m_flushed_cases{};
+        // m_cases与m_seeded_cases的估计字节数
+        size_t m_case_bytes = 0;
+        // 已写出的用例数与其中harness失败的，分批写出时连续编号
+        int m_cases_written = 0;
+        int m_harness_failures = 0;
+        MemoryLimits m_memory_limits{};
+        // 上次重建求解器后z3的分配量(平摊后)，没有增长时重建也释放不了什么
+        uint64_t m_z3_after_reset = 0;
+        // 超过软上限后不再记录每轮变异与被拒用例的详细日志
+        bool m_quiet_log = false;
 
         fmt::memory_buffer local_log{};
+        Harness *m_harness = nullptr;
+        bool m_boundary = false;
+        Incremental m_incremental = Incremental::Off;
+        // Trust模式下未读入、因而不在m_flushed_cases中的保留用例数
+        size_t m_unhashed_kept = 0;
+        // 增量模式下保留的已有用例编号，新用例跳过这些编号
+        std::set<int> m_kept_ids{};
+        // 未按种子生成时，下一个新用例编号相对case_number_start的偏移
+        int m_next_case_offset = 0;
+        struct VarBounds {
+            int64_t lo = 0;
+            int64_t hi = 0;
+            std::vector<int64_t> constants{};
+        };
+        // 未翻转的约束给出的变量范围，反例边界模式使用
+        std::unordered_map<std::string, VarBounds> m_original_bounds{};
+        // 各变量出现过的边界值与其中已产生用例的
+        std::map<std::string, std::set<int64_t>> m_boundary_targets{};
+        std::map<std::string, std::set<int64_t>> m_boundary_hits{};
+        // 覆盖反馈：带来新覆盖的或语句、变量及其取值
+        std::unordered_map<unsigned, double> m_or_scores{};
+        std::unordered_map<std::string, double> m_var_scores{};
+        std::unordered_map<std::string, std::vector<int64_t>> m_productive_values{};
+        // 生成时已执行过的用例(按hash)及其(Harness::Status, signal)，写出时不再重复执行
+        std::unordered_map<size_t, std::pair<int, int>> m_executed_cases{};
+        WorkerMetrics m_metrics{};
 
     private:
         int case_number_start = 0;
 
+        // 约束表达式先下降为哈希合并的IR，再由emit()生成z3表达式
+        ir::NodeId lower(c11parser::CParser::PrimaryExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::PostfixExpressionContext *ctx);
+        std::vector<ir::NodeId> lower(c11parser::CParser::ArgumentExpressionListContext *ctx);
+        ir::NodeId lower(c11parser::CParser::UnaryExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::CastExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::MultiplicativeExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::AdditiveExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::ShiftExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::RelationalExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::EqualityExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::AndExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::ExclusiveOrExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::InclusiveOrExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::LogicalAndExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::LogicalOrExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::ConditionalExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::AssignmentExpressionContext *ctx);
+        ir::NodeId lower(c11parser::CParser::ExpressionContext *ctx);
+        /// @brief 分析全部约束语句的IR后生成z3约束
+        void emitConstraints();
+        /// @brief 正例模式下消去由线性等式确定的整数项(如a == b + c中的a)，不再变异与求解，提取用例时按定义式还原
+        void eliminate_defined_terms();
+        void collect_definitions(ir::NodeId root, std::vector<ir::NodeId> &equalities) const;
+        bool eliminable(ir::NodeId leaf);
+        /// @brief a[c1][c2]...形式时返回变量节点与下标
+        std::optional<std::pair<ir::NodeId, std::vector<int>>> constant_index_path(ir::NodeId id);
+        void scan_array_uses(ir::NodeId id);
+        bool is_flat_array(const std::string &name, const SymbolTableEntry &entry) const;
+        /// @brief 元素不少于LARGE_ARRAY_ELEMENTS的标量数组，未被引用或已展平时以稀疏形式提取
+        bool is_large_array(const SymbolTableEntry &entry) const;
+        json process_sparse_array(const std::string &name, const SymbolTableEntry &entry, const z3::model &model);
+        void scan_struct_uses(ir::NodeId id);
+        bool is_flat_struct(const std::string &name, const SymbolTableEntry &entry) const;
+        /// @brief 展平的结构体成员a[c].m对应的标量名与成员声明，不是展平的结构体时返回nullopt
+        std::optional<std::pair<std::string, const SymbolTableEntry *>> flat_member(ir::NodeId field);
+        z3::expr emit_arithmetic(ir::NodeId id);
+        z3::expr emit_bitwise(ir::NodeId id);
+        /// @brief 使二元运算两侧sort一致：位向量与整数常量/整数/实数混合、不同宽度的位向量
+        std::pair<z3::expr, z3::expr> unify(z3::expr a, z3::expr b, bool is_unsigned);
+        /// @brief 数组下标统一为Int
+        z3::expr as_index(const z3::expr &idx);
+        /// @brief 变量、数组元素或成员的声明类型
+        std::optional<SymbolTableEntryType> leaf_type(ir::NodeId id);
+        /// @brief 按C的算术转换粗略判断表达式是否无符号
+        bool is_unsigned(ir::NodeId id);
+        /// @brief 有界编码下的指针元素访问，不是指针时返回nullopt
+        std::optional<z3::expr> emit_bounded_element(ir::NodeId id);
+        z3::expr bounded_length(ir::NodeId pointer);
+        /// @brief 指针各槽位组成的lambda，供非常量下标的访问select，每个指针只建一次
+        z3::expr bounded_slots(const std::string &name, const SymbolTableEntry &entry);
+        void add_domain_constraint(const z3::expr &cons);
+        bool is_domain_constraint(const z3::expr &cons) const {
+            return m_domain_constraint_ids.count(cons.id()) != 0;
+        }
+        /// @brief 被约束引用的整数项首次生成时，按声明类型加上取值范围约束
+        void add_type_domain(const z3::expr &term, SymbolTableEntryType type);
+        /// @brief 与sort一致的整数常量
+        z3::expr int_value_of(const z3::sort &sort, int64_t v);
+        void register_blueprint(const std::string &name, StructBlueprint blueprint);
+        const StructBlueprint *find_blueprint(const z3::sort &sort) const;
+        z3::func_decl find_getter(const StructBlueprint &blueprint, const std::string &field) const;
+        /// @brief 记录约束引用了哪些变量与结构体成员
+        void scan_references(ir::NodeId id);
+        bool is_referenced_member(const std::string &var, const std::string &member) const {
+            return m_whole_referenced.count(var) != 0 || m_referenced_members.count({var, member}) != 0;
+        }
+        /// @brief 按声明类型的取值范围随机生成，用于约束中未出现的变量
+        /// @param element 为true时对数组只生成单个元素
+        json random_value(const SymbolTableEntry &entry, bool element = false);
+        z3::expr flat_element(const std::string &name, const SymbolTableEntry &entry, const std::vector<int> &idx);
+        /// @brief IR到z3的下降，同时登记all_expr_vector/or_expr_idmap等变异所需的映射
+        z3::expr emit(ir::NodeId id);
+
+        /// @brief 验证并写出当前内存中的用例，写出后移出m_cases/m_seeded_cases
+        void write_pending();
+        /// @brief m_smt_solver.check()，同时记录耗时与结果
+        z3::check_result check_sat(const z3::expr_vector *assumptions = nullptr);
+
         template<typename... T>
         void println_local(fmt::format_string<T...> fmt, T &&...args) {
             auto iter = fmt::format_to(std::back_inserter(local_log), fmt, args...);
@@ -222,30 +583,27 @@ namespace ststgen {
             }
             dims.insert(dims.cbegin(), dim);
         }
-        void insert_entry(const std::string &name, SymbolTableEntry entry) {
-            // 0 for Int, 1 for Real
-            int base_type = 0;
-            if (entry.type == SymbolTableEntryType::Int32 ||
-                entry.type == SymbolTableEntryType::Int64 ||
-                entry.type == SymbolTableEntryType::UInt32 ||
-                entry.type == SymbolTableEntryType::UInt64) {
-                base_type = 0;
-            } else if (entry.type == SymbolTableEntryType::Float32 || entry.type == SymbolTableEntryType::Float64) {
-                base_type = 1;
-            } else if (entry.type == SymbolTableEntryType::Struct) {
-                base_type = 2;
-            } else {
-                unreachable();
+        /// @brief 数组元素或标量本身的sort
+        z3::sort element_sort(const SymbolTableEntry &entry) {
+            if (entry.type == SymbolTableEntryType::Int32 || entry.type == SymbolTableEntryType::UInt32) {
+                return m_bitvec ? m_solver_context.bv_sort(32) : m_solver_context.int_sort();
             }
-            z3::sort base_sort{m_solver_context};
-            if (base_type == 0) {
-                base_sort = m_solver_context.int_sort();
-            } else if (base_type == 1) {
-                base_sort = m_solver_context.real_sort();
-            } else {
+            if (entry.type == SymbolTableEntryType::Int64 || entry.type == SymbolTableEntryType::UInt64) {
+                return m_bitvec ? m_solver_context.bv_sort(64) : m_solver_context.int_sort();
+            }
+            if (entry.type == SymbolTableEntryType::Float32 || entry.type == SymbolTableEntryType::Float64) {
+                return m_solver_context.real_sort();
+            }
+            if (entry.type == SymbolTableEntryType::Struct) {
                 const auto &tup_constructor = m_struct_blueprints.at(entry.struct_name).sym_constructor;
-                auto tup_sort = tup_constructor->range();
-                base_sort = tup_sort;
+                return tup_constructor->range();
+            }
+            unreachable();
+        }
+        void insert_entry(const std::string &name, SymbolTableEntry entry) {
+            z3::sort base_sort = element_sort(entry);
+            if (base_sort.is_bv()) {
+                entry.cons |= BITVEC;
             }
             if (entry.qualifer == SymbolTableEntryQualifer::Primary) {
                 entry.sym = m_solver_context.constant(name.c_str(), base_sort);
@@ -275,29 +633,133 @@ namespace ststgen {
         enum class ValueType {
             Int,
             Int64,
+            UInt,
+            UInt64,
             Real,
             Struct,
         };
+        static bool is_integral(ValueType value_type) {
+            return value_type != ValueType::Real && value_type != ValueType::Struct;
+        }
+        /// @brief 整数模型值(Int或BitVec)转为json，BitVec按类型的有无符号解释
+        json int_to_json(const z3::expr &v_sym, ValueType value_type) {
+            if (v_sym.is_bv()) {
+                const uint64_t u = v_sym.get_numeral_uint64();
+                if (value_type == ValueType::Int) {
+                    return static_cast<int32_t>(static_cast<uint32_t>(u));
+                }
+                if (value_type == ValueType::UInt) {
+                    return static_cast<uint32_t>(u);
+                }
+                if (value_type == ValueType::Int64) {
+                    return static_cast<int64_t>(u);
+                }
+                return u;
+            }
+            int64_t r = 0;
+            uint64_t u = 0;
+            if (value_type == ValueType::UInt64 && v_sym.is_numeral_u64(u)) {
+                return u;
+            }
+            if (value_type != ValueType::UInt64 && v_sym.is_numeral_i64(r) &&
+                (value_type == ValueType::Int64 ||
+                 (value_type == ValueType::Int && r >= INT32_MIN && r <= INT32_MAX) ||
+                 (value_type == ValueType::UInt && r >= 0 && r <= UINT32_MAX))) {
+                return r;
+            }
+            // 被引用的项都有定义域约束，只有模型中未受约束的部分(如数组的默认值)会越界，按C的整数转换截断
+            m_metrics.values_wrapped++;
+            const unsigned width = value_type == ValueType::Int || value_type == ValueType::UInt ? 32 : 64;
+            return int_to_json(z3::int2bv(width, v_sym).simplify(), value_type);
+        }
         json process_z3_seq(const std::vector<int> &dims, const z3::expr &seq, const z3::model &model, const SymbolTableEntry &entry, ValueType value_type = ValueType::Int) {
             return process_z3_seq_rec(dims, seq, model, entry, value_type, 0);
         }
 
+        json process_flat_array(const std::string &name, const SymbolTableEntry &entry, const z3::model &model) {
+            std::vector<int> idx{};
+            return process_flat_array_rec(name, entry, model, idx);
+        }
+
+        json process_flat_array_rec(const std::string &name, const SymbolTableEntry &entry, const z3::model &model, std::vector<int> &idx) {
+            auto ret = json::array();
+            const auto depth = idx.size();
+            for (int i = 0; i < entry.dims[depth]; ++i) {
+                idx.push_back(i);
+                if (depth + 1 < entry.dims.size()) {
+                    ret.push_back(process_flat_array_rec(name, entry, model, idx));
+                } else if (is_flat_struct(name, entry)) {
+                    ret.push_back(process_flat_struct(name, entry, idx, model));
+                } else {
+                    if (m_flat_elements.count(make_element_name(name, idx)) == 0) {
+                        // 未被约束引用的元素不在查询中
+                        ret.push_back(random_value(entry, true));
+                        idx.pop_back();
+                        continue;
+                    }
+                    ret.push_back(z3_value_to_json(model.eval(flat_element(name, entry, idx), true), entry, model));
+                }
+                idx.pop_back();
+            }
+            return ret;
+        }
+
+        json process_flat_struct(const std::string &name, const SymbolTableEntry &entry, const std::vector<int> &idx, const z3::model &model) {
+            auto ret = json::object();
+            for (const auto &[member_name, member_entry]: m_struct_blueprints.at(entry.struct_name).m_members) {
+                auto flat_name = make_member_name(name, member_name, idx);
+                if (!is_referenced_member(m_extract_var, member_name)) {
+                    ret[member_name] = random_value(member_entry);
+                } else if (member_entry.qualifer == SymbolTableEntryQualifer::Array) {
+                    ret[member_name] = process_flat_array(flat_name, member_entry, model);
+                } else if (member_entry.qualifer == SymbolTableEntryQualifer::Pointer) {
+                    ret[member_name] = process_bounded_pointer(flat_name, member_entry, model);
+                } else if (auto it = m_flat_elements.find(flat_name); it != m_flat_elements.end()) {
+                    ret[member_name] = z3_value_to_json(model.eval(it->second, true), member_entry, model);
+                } else {
+                    // 同一变量的其他元素引用了该成员，这个元素没有
+                    ret[member_name] = random_value(member_entry);
+                }
+            }
+            return ret;
+        }
+
+        json process_bounded_pointer(const std::string &name, const SymbolTableEntry &entry, const z3::model &model) {
+            auto ret = json::array();
+            auto length_it = m_flat_elements.find(make_length_name(name));
+            if (length_it == m_flat_elements.end()) {
+                return random_value(entry);
+            }
+            auto length = model.eval(length_it->second, true).as_int64();
+            for (int i = 0; i < length; ++i) {
+                if (m_flat_elements.count(make_element_name(name, {i})) == 0) {
+                    ret.push_back(random_value(entry, true));
+                } else {
+                    ret.push_back(z3_value_to_json(model.eval(flat_element(name, entry, {i}), true), entry, model));
+                }
+            }
+            return ret;
+        }
+
+        json z3_value_to_json(const z3::expr &v_sym, const SymbolTableEntry &entry, const z3::model &model) {
+            auto value_type = entry_type_2_value_type(entry.type);
+            if (is_integral(value_type)) {
+                return int_to_json(v_sym, value_type);
+            }
+            if (value_type == ValueType::Real) {
+                return v_sym.as_double();
+            }
+            return process_z3_tuple(entry, model, v_sym);
+        }
+
         json process_z3_seq_rec(const std::vector<int> &dims, const z3::expr &seq, const z3::model &model, const SymbolTableEntry &entry, ValueType value_type, int depth) {
             auto ret = json::array();
             if (depth == dims.size() - 1) {
                 for (int i = 0; i < dims[depth]; ++i) {
                     auto idx = m_solver_context.int_val(i);
                     auto v_sym = model.eval(seq[idx]);
-                    if (value_type == ValueType::Int) {
-                        auto r = v_sym.as_int64();
-                        if (r > INT_MAX || r < INT_MIN) {
-                            throw std::exception();
-                        }
-                        ret.push_back(r);
-                    }
-                    if (value_type == ValueType::Int64) {
-                        auto r = v_sym.as_int64();
-                        ret.push_back(r);
+                    if (is_integral(value_type)) {
+                        ret.push_back(int_to_json(v_sym, value_type));
                     }
                     if (value_type == ValueType::Real) {
                         ret.push_back(v_sym.as_double());
@@ -319,10 +781,15 @@ namespace ststgen {
 
         json process_z3_tuple(const SymbolTableEntry &entry, const z3::model &model, const z3::expr &subst) {
             auto ret = json::object();
-            const auto &blueprint = m_struct_blueprints[entry.struct_name];
+            const auto &blueprint = m_struct_blueprints.at(entry.struct_name);
             int idx = 0;
-            dbg(blueprint.sym_getters->size());
             for (const auto &[member_name, member_entry]: blueprint.m_members) {
+                if (!is_referenced_member(m_extract_var, member_name)) {
+                    // 约束中从未出现的成员不必从模型中取值
+                    ret[member_name] = random_value(member_entry);
+                    idx += 1;
+                    continue;
+                }
                 auto getter_sym = (*blueprint.sym_getters)[idx];
                 auto t = getter_sym(subst);
                 auto member_sym = model.eval(t);
@@ -331,13 +798,7 @@ namespace ststgen {
                         member_entry.type == SymbolTableEntryType::Int64 ||
                         member_entry.type == SymbolTableEntryType::UInt32 ||
                         member_entry.type == SymbolTableEntryType::UInt64) {
-                        auto v = member_sym.as_int64();
-                        if (entry.type == SymbolTableEntryType::Int32 || entry.type == SymbolTableEntryType::UInt32) {
-                            if (v > INT_MAX || v < INT_MIN) {
-                                throw std::exception();
-                            }
-                        }
-                        ret[member_name] = v;
+                        ret[member_name] = int_to_json(member_sym, entry_type_2_value_type(member_entry.type));
                     } else if (member_entry.type == SymbolTableEntryType::Float32 ||
                                member_entry.type == SymbolTableEntryType::Float64) {
                         ret[member_name] = member_sym.as_double();
@@ -346,12 +807,14 @@ namespace ststgen {
                     }
                 }
                 if (member_entry.qualifer == SymbolTableEntryQualifer::Array) {
-                    auto member_array_json = process_z3_seq(entry.dims, member_sym, model, entry, entry_type_2_value_type(member_entry.type));
+                    auto member_array_json = process_z3_seq(member_entry.dims, member_sym, model, entry, entry_type_2_value_type(member_entry.type));
                     ret[member_name] = member_array_json;
                 }
                 if (member_entry.qualifer == SymbolTableEntryQualifer::Pointer) {
                     // pointers are actually handled as 1-D arrays
-                    auto length = model.eval(member_sym.length()).as_int64();
+                    auto length = m_pointer_encoding == PointerEncoding::Bounded
+                                          ? model.eval(find_getter(blueprint, make_length_name(member_name))(subst), true).as_int64()
+                                          : model.eval(member_sym.length()).as_int64();
                     std::vector dims{static_cast<int>(length)};
                     auto member_array_json = process_z3_seq(dims, member_sym, model, entry, entry_type_2_value_type(member_entry.type));
                     ret[member_name] = member_array_json;
@@ -363,14 +826,18 @@ namespace ststgen {
         }
 
         static ValueType entry_type_2_value_type(SymbolTableEntryType type) {
-            if (type == SymbolTableEntryType::Int32 ||
-                type == SymbolTableEntryType::UInt32) {
+            if (type == SymbolTableEntryType::Int32) {
                 return ValueType::Int;
             }
-            if (type == SymbolTableEntryType::Int64 ||
-                type == SymbolTableEntryType::UInt64) {
+            if (type == SymbolTableEntryType::UInt32) {
+                return ValueType::UInt;
+            }
+            if (type == SymbolTableEntryType::Int64) {
                 return ValueType::Int64;
             }
+            if (type == SymbolTableEntryType::UInt64) {
+                return ValueType::UInt64;
+            }
             if (type == SymbolTableEntryType::Float32 ||
                 type == SymbolTableEntryType::Float64) {
                 return ValueType::Real;
@@ -383,16 +850,22 @@ namespace ststgen {
     };
 
 
+    // 以C的写法s[1].m、a[0][2]命名，'['与'.'不能出现在标识符中，不会与约束文件中的变量重名
     inline std::string make_member_name(const std::string &var, const std::string &member, const std::vector<int> &idx) {
-        auto ret = std::string{var};
-        ret += "__m__";
+        auto ret = make_element_name(var, idx);
+        ret += '.';
         ret += member;
+        return ret;
+    }
+
+    inline std::string make_element_name(const std::string &var, const std::vector<int> &idx) {
+        auto ret = std::string{var};
         for (auto i: idx) {
-            ret += "__i";
+            ret += '[';
             ret += std::to_string(i);
+            ret += ']';
         }
         return ret;
     }
 
-
 }// namespace ststgen
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+namespace ststgen {
+
+    /// @brief Philox4x32-10计数器随机数发生器，满足UniformRandomBitGenerator
+    ///
+    /// 输出完全由(key, 计数器)决定，不依赖之前取过多少个数。
+    /// 计数器的128位分为：块序号(32) | 流号(32) | 用例编号(32) | 正反例(32)，
+    /// 因此任意一个用例、用例中任意一个变量的随机流都能直接定位，不必重放前面的序列。
+    class Philox {
+    public:
+        using result_type = uint64_t;
+
+        Philox() = default;
+        explicit Philox(uint64_t seed) : m_key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+        /// @param polarity 'P'或'N'
+        /// @param stream 0为用例本身的流，变量的流见stream_of
+        Philox(uint64_t seed, char polarity, uint32_t case_id, uint32_t stream) : Philox(seed) {
+            m_counter[1] = stream;
+            m_counter[2] = case_id;
+            m_counter[3] = static_cast<uint32_t>(polarity);
+        }
+
+        static constexpr result_type min() {
+            return 0;
+        }
+        static constexpr result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        result_type operator()() {
+            if (m_used == m_block.size()) {
+                m_block = generate(m_counter);
+                m_counter[0]++;
+                m_used = 0;
+            }
+            const uint64_t lo = m_block[m_used++];
+            const uint64_t hi = m_block[m_used++];
+            return lo | hi << 32;
+        }
+
+        /// @brief 从流的开头数第offset个32位字起连续生成n个字，与从头逐个调用operator()得到的低、高位依次相同
+        /// 各块只依赖自己的计数器，可以从任意位置开始
+        void fill(uint64_t offset, uint32_t *out, size_t n) const {
+            Block ctr = m_counter;
+            for (size_t i = 0; i < n;) {
+                const uint64_t word = offset + i;
+                ctr[0] = static_cast<uint32_t>(word / 4);
+                const auto block = generate(ctr);
+                for (auto lane = static_cast<size_t>(word % 4); lane < 4 && i < n; ++lane, ++i) {
+                    out[i] = block[lane];
+                }
+            }
+        }
+
+        /// @brief 变量名对应的流号(FNV-1a)，与平台的std::hash无关
+        static uint32_t stream_of(std::string_view name) {
+            uint32_t h = 2166136261u;
+            for (auto c: name) {
+                h ^= static_cast<uint8_t>(c);
+                h *= 16777619u;
+            }
+            // 0留给用例本身
+            return h == 0 ? 1 : h;
+        }
+
+    private:
+        using Block = std::array<uint32_t, 4>;
+
+        static void mulhilo(uint32_t a, uint32_t b, uint32_t &hi, uint32_t &lo) {
+            const uint64_t p = static_cast<uint64_t>(a) * b;
+            hi = static_cast<uint32_t>(p >> 32);
+            lo = static_cast<uint32_t>(p);
+        }
+
+        Block generate(Block ctr) const {
+            constexpr uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+            constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+            auto key = m_key;
+            for (int round = 0; round < 10; ++round) {
+                uint32_t hi0, lo0, hi1, lo1;
+                mulhilo(M0, ctr[0], hi0, lo0);
+                mulhilo(M1, ctr[2], hi1, lo1);
+                ctr = {hi1 ^ ctr[1] ^ key[0], lo1, hi0 ^ ctr[3] ^ key[1], lo0};
+                key[0] += W0;
+                key[1] += W1;
+            }
+            return ctr;
+        }
+
+        std::array<uint32_t, 2> m_key{};
+        Block m_counter{};
+        Block m_block{};
+        size_t m_used = 4;
+    };
+}// namespace ststgen
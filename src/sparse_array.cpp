@@ -0,0 +1,207 @@
+#include "sparse_array.hpp"
+#include "rng.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <string>
+
+#include <fmt/format.h>
+
+namespace ststgen {
+
+    namespace {
+        // 每次生成、格式化的元素数
+        constexpr size_t CHUNK = 4096;
+
+        bool is_reserved_key(const std::string &key) {
+            return key == "__sparse" || key == "__seed" || key == "length";
+        }
+    }// namespace
+
+    bool SparseArray::is_sparse(const nlohmann::json &v) {
+        return v.is_object() && v.contains("__sparse");
+    }
+
+    nlohmann::json SparseArray::make(const std::vector<int> &dims, uint64_t seed) {
+        return nlohmann::json{{"__sparse", true}, {"__seed", seed}, {"length", dims.front()}};
+    }
+
+    void SparseArray::set(nlohmann::json &sparse, const std::vector<int> &dims, const std::vector<int> &idx, nlohmann::json value) {
+        stst_assert(idx.size() == dims.size());
+        auto *node = &sparse;
+        for (size_t k = 0; k + 1 < idx.size(); ++k) {
+            auto &row = (*node)[std::to_string(idx[k])];
+            if (row.is_null()) {
+                row = nlohmann::json{{"length", dims[k + 1]}};
+            }
+            node = &row;
+        }
+        (*node)[std::to_string(idx.back())] = std::move(value);
+    }
+
+    SparseArray::SparseArray(const nlohmann::json &sparse, std::vector<int> dims, SymbolTableEntryType type)
+        : m_dims(std::move(dims)), m_strides(m_dims.size() + 1, 1), m_type(type), m_seed(sparse.at("__seed").get<uint64_t>()) {
+        for (auto k = m_dims.size(); k > 0; --k) {
+            m_strides[k - 1] = m_strides[k] * m_dims[k - 1];
+        }
+        std::function<void(const nlohmann::json &, size_t, size_t)> collect = [&](const nlohmann::json &node, size_t depth, size_t base) {
+            for (auto it = node.begin(); it != node.end(); ++it) {
+                if (is_reserved_key(it.key())) {
+                    continue;
+                }
+                const auto linear = base + std::stoull(it.key()) * m_strides[depth + 1];
+                if (depth + 1 == m_dims.size()) {
+                    m_values.emplace_back(linear, &*it);
+                } else {
+                    collect(*it, depth + 1, linear);
+                }
+            }
+        };
+        collect(sparse, 0, 0);
+        std::sort(m_values.begin(), m_values.end(), [](const auto &a, const auto &b) {
+            return a.first < b.first;
+        });
+    }
+
+    size_t SparseArray::element_size() const {
+        switch (m_type) {
+            case SymbolTableEntryType::Int32:
+            case SymbolTableEntryType::UInt32:
+            case SymbolTableEntryType::Float32:
+                return 4;
+            case SymbolTableEntryType::Int64:
+            case SymbolTableEntryType::UInt64:
+            case SymbolTableEntryType::Float64:
+                return 8;
+            default:
+                unreachable();
+        }
+    }
+
+    template<typename T>
+    void SparseArray::generate(size_t begin, size_t n, T *out) const {
+        // 与random_value相同的分布：整数取整个类型范围，浮点数在int32范围内均匀
+        constexpr size_t words = sizeof(T) / 4;
+        uint32_t raw[CHUNK * 2];
+        stst_assert(n <= CHUNK);
+        Philox{m_seed}.fill(begin * words, raw, n * words);
+        for (size_t i = 0; i < n; ++i) {
+            if constexpr (std::is_same_v<T, double>) {
+                const uint64_t u = raw[2 * i] | static_cast<uint64_t>(raw[2 * i + 1]) << 32;
+                out[i] = INT32_MIN + static_cast<double>(u >> 11) * 0x1p-53 * (static_cast<double>(INT32_MAX) - INT32_MIN);
+            } else if constexpr (words == 2) {
+                out[i] = static_cast<T>(raw[2 * i] | static_cast<uint64_t>(raw[2 * i + 1]) << 32);
+            } else {
+                out[i] = static_cast<T>(raw[i]);
+            }
+        }
+        auto it = std::lower_bound(m_values.begin(), m_values.end(), begin, [](const auto &v, size_t i) {
+            return v.first < i;
+        });
+        for (; it != m_values.end() && it->first < begin + n; ++it) {
+            out[it->first - begin] = it->second->template get<T>();
+        }
+    }
+
+    template<typename F>
+    void SparseArray::with_type(F &&f) const {
+        switch (m_type) {
+            case SymbolTableEntryType::Int32:
+                f(int32_t{});
+                break;
+            case SymbolTableEntryType::UInt32:
+                f(uint32_t{});
+                break;
+            case SymbolTableEntryType::Int64:
+                f(int64_t{});
+                break;
+            case SymbolTableEntryType::UInt64:
+                f(uint64_t{});
+                break;
+            case SymbolTableEntryType::Float32:
+            case SymbolTableEntryType::Float64:
+                f(double{});
+                break;
+            default:
+                unreachable();
+        }
+    }
+
+    void SparseArray::fill(size_t begin, size_t n, std::byte *out) const {
+        with_type([&](auto tag) {
+            using T = decltype(tag);
+            T chunk[CHUNK];
+            for (size_t done = 0; done < n; done += CHUNK) {
+                const auto count = std::min(CHUNK, n - done);
+                generate(begin + done, count, chunk);
+                if (m_type == SymbolTableEntryType::Float32) {
+                    for (size_t i = 0; i < count; ++i) {
+                        const auto f = static_cast<float>(chunk[i]);
+                        std::memcpy(out + (done + i) * sizeof(float), &f, sizeof(float));
+                    }
+                } else {
+                    std::memcpy(out + done * sizeof(T), chunk, count * sizeof(T));
+                }
+            }
+        });
+    }
+
+    void SparseArray::write_json(std::ostream &os) const {
+        with_type([&](auto tag) {
+            using T = decltype(tag);
+            T chunk[CHUNK];
+            fmt::memory_buffer buf{};
+            const auto depth = m_dims.size();
+            for (size_t begin = 0; begin < size(); begin += CHUNK) {
+                const auto count = std::min(CHUNK, size() - begin);
+                generate(begin, count, chunk);
+                for (size_t i = begin; i < begin + count; ++i) {
+                    if (i != 0) {
+                        buf.push_back(',');
+                    }
+                    // 从i开始的每一维都要开一层，从内向外数
+                    for (size_t k = depth; k > 0 && i % m_strides[k - 1] == 0; --k) {
+                        buf.push_back('[');
+                    }
+                    fmt::format_to(std::back_inserter(buf), "{}", chunk[i - begin]);
+                    for (size_t k = depth; k > 0 && (i + 1) % m_strides[k - 1] == 0; --k) {
+                        buf.push_back(']');
+                    }
+                }
+                os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+                buf.clear();
+            }
+        });
+    }
+
+    void write_case(std::ostream &os, const nlohmann::json &single_case,
+                    const std::vector<std::pair<std::string, SymbolTableEntry>> &variables) {
+        if (!single_case.is_object() || single_case.empty()) {
+            os << std::setw(4) << single_case;
+            return;
+        }
+        os << "{\n";
+        size_t written = 0;
+        for (auto it = single_case.begin(); it != single_case.end(); ++it) {
+            os << "    " << nlohmann::json(it.key()).dump() << ": ";
+            auto var = std::find_if(variables.begin(), variables.end(), [&](const auto &v) {
+                return v.first == it.key();
+            });
+            if (SparseArray::is_sparse(*it) && var != variables.end()) {
+                SparseArray(*it, var->second.dims, var->second.type).write_json(os);
+            } else {
+                // 与整体dump(4)的缩进一致
+                auto text = it->dump(4);
+                for (size_t pos = text.find('\n'); pos != std::string::npos; pos = text.find('\n', pos + 5)) {
+                    text.insert(pos + 1, "    ");
+                }
+                os << text;
+            }
+            os << (++written == single_case.size() ? "\n" : ",\n");
+        }
+        os << "}";
+    }
+}// namespace ststgen
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "parser.hpp"
+
+namespace ststgen {
+
+    /// @brief 元素总数不少于此的定长标量数组在用例中以稀疏形式保存
+    constexpr size_t LARGE_ARRAY_ELEMENTS = 1 << 16;
+
+    /// @brief 大数组在用例json中的稀疏形式
+    ///
+    /// 只保存约束引用到的元素，其余元素在写出、传给harness时由种子按下标批量生成：
+    ///   {"__sparse": true, "__seed": s, "length": n, "i": 元素或下一维的同样形式}
+    /// 以下标字符串为键、带length，在QJS与ir::evaluate中按下标、_LENGTH访问的结果与完整数组一致。
+    class SparseArray {
+    public:
+        static bool is_sparse(const nlohmann::json &v);
+        static nlohmann::json make(const std::vector<int> &dims, uint64_t seed);
+        /// @brief 写入idx处的元素，idx须为完整下标
+        static void set(nlohmann::json &sparse, const std::vector<int> &dims, const std::vector<int> &idx, nlohmann::json value);
+
+        SparseArray(const nlohmann::json &sparse, std::vector<int> dims, SymbolTableEntryType type);
+
+        size_t size() const {
+            return m_strides.front();
+        }
+        size_t element_size() const;
+        /// @brief 按C的内存布局生成[begin, begin + n)的元素
+        void fill(size_t begin, size_t n, std::byte *out) const;
+        /// @brief 以嵌套数组的形式流式写出，每次只生成一块元素
+        void write_json(std::ostream &os) const;
+
+    private:
+        /// @brief 生成[begin, begin + n)的元素，n不超过一块
+        template<typename T>
+        void generate(size_t begin, size_t n, T *out) const;
+        /// @brief 以元素类型的值调用f，浮点数统一为double
+        template<typename F>
+        void with_type(F &&f) const;
+
+        std::vector<int> m_dims;
+        // m_strides[k]为第k维及以后各维元素数之积
+        std::vector<size_t> m_strides{};
+        SymbolTableEntryType m_type;
+        uint64_t m_seed = 0;
+        // 按行优先下标排序的已知元素
+        std::vector<std::pair<size_t, const nlohmann::json *>> m_values{};
+    };
+
+    /// @brief 与std::setw(4)输出相同的格式写出用例，其中的稀疏数组展开为完整数组
+    void write_case(std::ostream &os, const nlohmann::json &single_case,
+                    const std::vector<std::pair<std::string, SymbolTableEntry>> &variables);
+}// namespace ststgen
@@ -0,0 +1,436 @@
+#include "subset_parser.hpp"
+
+#include <cctype>
+#include <cstring>
+
+namespace ststgen::subset {
+
+    namespace {
+        enum class Tok : uint8_t {
+            End,
+            Ident,
+            Number,
+            Punct,
+        };
+
+        struct Token {
+            Tok kind = Tok::End;
+            std::string_view text{};
+            int line = 1;
+        };
+
+        // 按长度从长到短匹配
+        constexpr const char *PUNCTS[] = {
+                "<<=", ">>=", "...", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+                "+=", "-=", "*=", "/=", "%=", "&=", "^=", "|=",
+        };
+
+        const std::unordered_set<std::string_view> BASE_TYPES = {
+                "void", "char", "short", "int", "long", "float", "double", "signed", "unsigned", "_Bool",
+        };
+        const std::unordered_set<std::string_view> QUALIFIERS = {
+                "const", "volatile", "static", "extern", "register", "inline",
+        };
+
+        class Lexer {
+        public:
+            explicit Lexer(std::string_view src) : m_src(src) {}
+
+            Token next() {
+                skip_space();
+                Token tok{};
+                tok.line = m_line;
+                if (m_pos >= m_src.size()) {
+                    return tok;
+                }
+                const auto begin = m_pos;
+                const char c = m_src[m_pos];
+                if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                    while (m_pos < m_src.size() && (std::isalnum(static_cast<unsigned char>(m_src[m_pos])) || m_src[m_pos] == '_')) {
+                        m_pos++;
+                    }
+                    tok.kind = Tok::Ident;
+                } else if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && m_pos + 1 < m_src.size() && std::isdigit(static_cast<unsigned char>(m_src[m_pos + 1])))) {
+                    // 数字连同后缀、指数符号一起取出，交给后续阶段解释
+                    while (m_pos < m_src.size()) {
+                        const char d = m_src[m_pos];
+                        if (std::isalnum(static_cast<unsigned char>(d)) || d == '.') {
+                            m_pos++;
+                        } else if ((d == '+' || d == '-') && (m_src[m_pos - 1] == 'e' || m_src[m_pos - 1] == 'E') && !is_hex(begin)) {
+                            m_pos++;
+                        } else {
+                            break;
+                        }
+                    }
+                    tok.kind = Tok::Number;
+                } else {
+                    tok.kind = Tok::Punct;
+                    m_pos++;
+                    for (const auto *p: PUNCTS) {
+                        const auto len = std::strlen(p);
+                        if (m_src.compare(begin, len, p) == 0) {
+                            m_pos = begin + len;
+                            break;
+                        }
+                    }
+                }
+                tok.text = m_src.substr(begin, m_pos - begin);
+                return tok;
+            }
+
+        private:
+            bool is_hex(size_t begin) const {
+                return m_src.size() > begin + 1 && m_src[begin] == '0' && (m_src[begin + 1] == 'x' || m_src[begin + 1] == 'X');
+            }
+
+            void skip_space() {
+                while (m_pos < m_src.size()) {
+                    const char c = m_src[m_pos];
+                    if (c == '\n') {
+                        m_line++;
+                        m_pos++;
+                    } else if (std::isspace(static_cast<unsigned char>(c))) {
+                        m_pos++;
+                    } else if (c == '#') {
+                        // 预处理指令整行忽略
+                        while (m_pos < m_src.size() && m_src[m_pos] != '\n') {
+                            m_pos++;
+                        }
+                    } else if (m_src.compare(m_pos, 2, "//") == 0) {
+                        while (m_pos < m_src.size() && m_src[m_pos] != '\n') {
+                            m_pos++;
+                        }
+                    } else if (m_src.compare(m_pos, 2, "/*") == 0) {
+                        const auto end = m_src.find("*/", m_pos + 2);
+                        const auto stop = end == std::string_view::npos ? m_src.size() : end + 2;
+                        for (; m_pos < stop; m_pos++) {
+                            m_line += m_src[m_pos] == '\n';
+                        }
+                    } else {
+                        break;
+                    }
+                }
+            }
+
+            std::string_view m_src;
+            size_t m_pos = 0;
+            int m_line = 1;
+        };
+
+        class Parser {
+        public:
+            explicit Parser(std::string_view src) : m_lexer(src) {
+                m_cur = m_lexer.next();
+                m_peek = m_lexer.next();
+            }
+
+            Unit run() {
+                while (m_cur.kind != Tok::End) {
+                    external_declaration();
+                }
+                return std::move(m_unit);
+            }
+
+        private:
+            void advance() {
+                m_cur = m_peek;
+                m_peek = m_lexer.next();
+            }
+
+            bool is(std::string_view text) const {
+                return m_cur.kind != Tok::End && m_cur.text == text;
+            }
+
+            bool accept(std::string_view text) {
+                if (is(text)) {
+                    advance();
+                    return true;
+                }
+                return false;
+            }
+
+            void expect(std::string_view text) {
+                if (!accept(text)) {
+                    fail("expected '" + std::string(text) + "'");
+                }
+            }
+
+            [[noreturn]] void fail(const std::string &msg) const {
+                const auto near = m_cur.kind == Tok::End ? std::string("<EOF>") : std::string(m_cur.text);
+                throw SyntaxError(msg + " near '" + near + "'", m_cur.line);
+            }
+
+            std::string_view identifier() {
+                if (m_cur.kind != Tok::Ident) {
+                    fail("expected identifier");
+                }
+                auto text = m_cur.text;
+                advance();
+                return text;
+            }
+
+            bool starts_type() const {
+                if (m_cur.kind != Tok::Ident) {
+                    return false;
+                }
+                return m_cur.text == "typedef" || m_cur.text == "struct" || BASE_TYPES.count(m_cur.text) || QUALIFIERS.count(m_cur.text) || m_typedefs.count(m_cur.text);
+            }
+
+            void specifiers(Declaration &decl) {
+                bool named = false;
+                while (m_cur.kind == Tok::Ident) {
+                    if (m_cur.text == "typedef") {
+                        decl.is_typedef = true;
+                        advance();
+                    } else if (QUALIFIERS.count(m_cur.text)) {
+                        advance();
+                    } else if (BASE_TYPES.count(m_cur.text)) {
+                        decl.type.push_back(m_cur.text);
+                        named = true;
+                        advance();
+                    } else if (m_cur.text == "struct") {
+                        advance();
+                        decl.is_struct = true;
+                        named = true;
+                        if (m_cur.kind == Tok::Ident) {
+                            decl.type.push_back(identifier());
+                        }
+                        if (accept("{")) {
+                            while (!accept("}")) {
+                                Declaration member{};
+                                specifiers(member);
+                                declarator_list(member);
+                                expect(";");
+                                decl.members.push_back(std::move(member));
+                            }
+                        }
+                    } else if (!named && m_typedefs.count(m_cur.text)) {
+                        decl.type.push_back(m_cur.text);
+                        named = true;
+                        advance();
+                    } else {
+                        break;
+                    }
+                }
+                if (!named) {
+                    fail("expected type specifier");
+                }
+            }
+
+            Declarator declarator() {
+                Declarator d{};
+                while (accept("*")) {
+                    d.pointer++;
+                    while (m_cur.kind == Tok::Ident && QUALIFIERS.count(m_cur.text)) {
+                        advance();
+                    }
+                }
+                // 原型中的参数可以省略名字
+                if (m_cur.kind == Tok::Ident) {
+                    d.name = identifier();
+                }
+                while (true) {
+                    if (accept("[")) {
+                        if (m_cur.kind != Tok::Number) {
+                            fail("array dimension must be an integer constant");
+                        }
+                        d.dims.push_back(std::stoi(std::string(m_cur.text), nullptr, 0));
+                        advance();
+                        expect("]");
+                    } else if (accept("(")) {
+                        d.is_function = true;
+                        parameters();
+                    } else {
+                        break;
+                    }
+                }
+                return d;
+            }
+
+            void parameters() {
+                if (accept(")")) {
+                    return;
+                }
+                do {
+                    if (accept("...")) {
+                        break;
+                    }
+                    Declaration param{};
+                    specifiers(param);
+                    declarator();
+                } while (accept(","));
+                expect(")");
+            }
+
+            void declarator_list(Declaration &decl) {
+                if (is(";")) {
+                    return;
+                }
+                do {
+                    decl.declarators.push_back(declarator());
+                } while (accept(","));
+            }
+
+            void skip_block() {
+                expect("{");
+                int depth = 1;
+                while (depth > 0) {
+                    if (m_cur.kind == Tok::End) {
+                        fail("unterminated function body");
+                    }
+                    depth += is("{");
+                    depth -= is("}");
+                    advance();
+                }
+            }
+
+            void external_declaration() {
+                if (accept(";")) {
+                    return;
+                }
+                Declaration decl{};
+                specifiers(decl);
+                declarator_list(decl);
+                if (decl.declarators.size() == 1 && decl.declarators[0].is_function && is("{")) {
+                    if (decl.declarators[0].name == "_CONSTRAINT") {
+                        constraint_body();
+                    } else {
+                        skip_block();
+                    }
+                } else {
+                    expect(";");
+                }
+                if (decl.is_typedef) {
+                    for (const auto &d: decl.declarators) {
+                        m_typedefs.insert(d.name);
+                    }
+                }
+                m_unit.declarations.push_back(std::move(decl));
+            }
+
+            void constraint_body() {
+                expect("{");
+                while (!accept("}")) {
+                    if (m_cur.kind == Tok::End) {
+                        fail("unterminated _CONSTRAINT body");
+                    }
+                    if (accept(";")) {
+                        continue;
+                    }
+                    m_unit.constraints.push_back(conditional());
+                    expect(";");
+                }
+            }
+
+            uint32_t make(NodeKind kind, std::string_view text, std::vector<uint32_t> args = {}) {
+                m_unit.nodes.push_back(Node{kind, text, std::move(args)});
+                return static_cast<uint32_t>(m_unit.nodes.size() - 1);
+            }
+
+            uint32_t conditional() {
+                auto cond = binary(0);
+                if (is("?")) {
+                    auto text = m_cur.text;
+                    advance();
+                    auto then_expr = conditional();
+                    expect(":");
+                    auto else_expr = conditional();
+                    return make(NodeKind::Conditional, text, {cond, then_expr, else_expr});
+                }
+                return cond;
+            }
+
+            /// @brief 返回二元运算符的优先级，越大越紧，-1表示不是二元运算符
+            int precedence() const {
+                if (m_cur.kind != Tok::Punct) {
+                    return -1;
+                }
+                static constexpr std::pair<std::string_view, int> TABLE[] = {
+                        {"||", 0}, {"&&", 1}, {"|", 2}, {"^", 3}, {"&", 4},
+                        {"==", 5}, {"!=", 5},
+                        {"<", 6}, {">", 6}, {"<=", 6}, {">=", 6},
+                        {"<<", 7}, {">>", 7},
+                        {"+", 8}, {"-", 8},
+                        {"*", 9}, {"/", 9}, {"%", 9},
+                };
+                for (const auto &[op, prec]: TABLE) {
+                    if (m_cur.text == op) {
+                        return prec;
+                    }
+                }
+                return -1;
+            }
+
+            // 优先级爬升，所有二元运算符左结合
+            uint32_t binary(int min_prec) {
+                auto lhs = unary();
+                for (int prec = precedence(); prec >= min_prec; prec = precedence()) {
+                    auto op = m_cur.text;
+                    advance();
+                    auto rhs = binary(prec + 1);
+                    lhs = make(NodeKind::Binary, op, {lhs, rhs});
+                }
+                return lhs;
+            }
+
+            uint32_t unary() {
+                if (is("-") || is("+") || is("!") || is("~")) {
+                    auto op = m_cur.text;
+                    advance();
+                    return make(NodeKind::Unary, op, {unary()});
+                }
+                return postfix(primary());
+            }
+
+            uint32_t primary() {
+                if (m_cur.kind == Tok::Ident) {
+                    return make(NodeKind::Identifier, identifier());
+                }
+                if (m_cur.kind == Tok::Number) {
+                    auto text = m_cur.text;
+                    advance();
+                    return make(NodeKind::Constant, text);
+                }
+                if (accept("(")) {
+                    auto inner = conditional();
+                    expect(")");
+                    return inner;
+                }
+                fail("expected expression");
+            }
+
+            uint32_t postfix(uint32_t base) {
+                while (true) {
+                    if (accept("[")) {
+                        auto index = conditional();
+                        expect("]");
+                        base = make(NodeKind::Index, {}, {base, index});
+                    } else if (accept("(")) {
+                        std::vector<uint32_t> args{base};
+                        if (!accept(")")) {
+                            do {
+                                args.push_back(conditional());
+                            } while (accept(","));
+                            expect(")");
+                        }
+                        base = make(NodeKind::Call, {}, std::move(args));
+                    } else if (accept(".")) {
+                        base = make(NodeKind::Field, identifier(), {base});
+                    } else {
+                        return base;
+                    }
+                }
+            }
+
+            Lexer m_lexer;
+            Token m_cur{};
+            Token m_peek{};
+            Unit m_unit{};
+            std::unordered_set<std::string_view> m_typedefs{};
+        };
+    }// namespace
+
+    Unit parse(std::string_view src) {
+        return Parser(src).run();
+    }
+}// namespace ststgen::subset
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace ststgen::subset {
+
+    /// @brief 约束文件所用C子集的手写递归下降解析器
+    ///
+    /// 只接受CConstraintVisitor能处理的形式：顶层变量声明、typedef struct、函数原型，
+    /// 以及_CONSTRAINT函数体内的表达式语句。其余函数体被跳过。
+    /// 只编译进ststgen_bench，与ANTLR前端对比性能，见其frontend部分；生成器本身只使用ConstraintFrontend。
+
+    enum class NodeKind : uint8_t {
+        Identifier,
+        Constant,
+        Index,  // args[0][args[1]]
+        Call,   // args[0](args[1..])
+        Field,  // args[0].text
+        Unary,  // text args[0]
+        Binary, // args[0] text args[1]
+        Conditional,
+    };
+
+    struct Node {
+        NodeKind kind;
+        std::string_view text;
+        std::vector<uint32_t> args{};
+    };
+
+    struct Declarator {
+        std::string_view name;
+        int pointer = 0;
+        std::vector<int> dims{};
+        bool is_function = false;
+    };
+
+    struct Declaration {
+        bool is_typedef = false;
+        // 基本类型关键字序列，或结构体/typedef名
+        std::vector<std::string_view> type{};
+        bool is_struct = false;
+        std::vector<Declaration> members{};
+        std::vector<Declarator> declarators{};
+    };
+
+    struct Unit {
+        std::vector<Declaration> declarations{};
+        // _CONSTRAINT中每条语句的根节点
+        std::vector<uint32_t> constraints{};
+        std::vector<Node> nodes{};
+    };
+
+    class SyntaxError : public std::runtime_error {
+    public:
+        SyntaxError(const std::string &msg, int line) : std::runtime_error(msg + " at line " + std::to_string(line)), line(line) {}
+        int line;
+    };
+
+    /// @brief 解析整个约束文件，返回的Unit引用src中的字符，src须比Unit活得久
+    Unit parse(std::string_view src);
+}// namespace ststgen::subset
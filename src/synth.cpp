@@ -0,0 +1,67 @@
+#include "synth.hpp"
+
+#include <algorithm>
+#include <fmt/core.h>
+
+namespace ststgen {
+
+    std::string make_synthetic_constraints(const SynthParams &params) {
+        std::string decls{};
+        std::string cons{};
+        if (params.chain > 0) {
+            for (int i = 0; i <= params.chain; ++i) {
+                decls += fmt::format("int x{};\n", i);
+            }
+            for (int i = 0; i < params.chain; ++i) {
+                cons += fmt::format("    x{} < x{};\n", i, i + 1);
+            }
+        }
+        if (params.disjunction > 0) {
+            decls += "int da;\nint db;\n";
+            cons += "    ";
+            for (int i = 0; i < params.disjunction; ++i) {
+                if (i > 0) {
+                    cons += " || ";
+                }
+                cons += fmt::format("da == db + {}", i * 7);
+            }
+            cons += ";\n    db > 0 && db < 1000;\n";
+        }
+        for (int i = 0; i < params.or_density; ++i) {
+            decls += fmt::format("int oa{};\nint ob{};\n", i, i);
+            cons += fmt::format("    oa{} < ob{} || oa{} > ob{} + 100;\n", i, i, i, i);
+        }
+        if (params.array > 0) {
+            const int k = params.array;
+            decls += fmt::format("int m[{}][{}];\n", k, k);
+            for (int i = 0; i < k; ++i) {
+                for (int j = 0; j + 1 < k; ++j) {
+                    cons += fmt::format("    m[{}][{}] < m[{}][{}];\n", i, j, i, j + 1);
+                }
+            }
+        }
+        if (params.struct_array > 0) {
+            const int fields = std::max(params.struct_fields, 2);
+            decls += "typedef struct {\n";
+            for (int f = 0; f < fields; ++f) {
+                decls += fmt::format("    int f{};\n", f);
+            }
+            decls += "} SynthS;\n";
+            decls += fmt::format("SynthS rs[{}];\n", params.struct_array);
+            for (int i = 0; i < params.struct_array; ++i) {
+                cons += fmt::format("    rs[{}].f0 > 0 && rs[{}].f0 < 100000;\n", i, i);
+                for (int f = 1; f + 1 < fields; ++f) {
+                    cons += fmt::format("    rs[{}].f{} < rs[{}].f{};\n", i, f, i, f + 1);
+                }
+                if (i + 1 < params.struct_array) {
+                    cons += fmt::format("    rs[{}].f0 == rs[{}].f0 + rs[{}].f1;\n", i + 1, i, i);
+                }
+            }
+        }
+        if (cons.empty()) {
+            decls += "int x0;\n";
+            cons += "    x0 > 0;\n";
+        }
+        return decls + "\nvoid _CONSTRAINT()\n{\n" + cons + "}\n";
+    }
+}// namespace ststgen
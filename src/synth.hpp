@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+namespace ststgen {
+
+    /// @brief 合成约束文件的规模参数，各部分使用互不相交的变量，为0表示不生成
+    struct SynthParams {
+        // x0 < x1 < ... < x{chain}：chain+1个变量，chain条约束
+        int chain = 0;
+        // 一条 disjunction 路的析取式
+        int disjunction = 0;
+        // or_density条两路析取语句
+        int or_density = 0;
+        // K x K 的二维数组，每行严格递增
+        int array = 0;
+        // 长度为L的结构体数组，相邻元素首尾相接
+        int struct_array = 0;
+        // 结构体成员数，成员之间逐个约束（解析器不支持嵌套结构体，以成员链长度代替深度）
+        int struct_fields = 4;
+    };
+
+    /// @brief 生成可直接被main读取的约束文件内容
+    std::string make_synthetic_constraints(const SynthParams &params);
+}// namespace ststgen
@@ -0,0 +1,35 @@
+#include "cmdline.h"
+#include "synth.hpp"
+
+#include <fmt/core.h>
+#include <fstream>
+
+int main(int argc, char **argv) {
+    cmdline::parser cmd_parser;
+    cmd_parser.add<int>("chain", 0, "length of the x0 < x1 < ... chain", false, 0, cmdline::range(0, 1 << 20));
+    cmd_parser.add<int>("disjunction", 0, "width of a single disjunction", false, 0, cmdline::range(0, 1 << 20));
+    cmd_parser.add<int>("or_density", 0, "number of two-way disjunctions", false, 0, cmdline::range(0, 1 << 20));
+    cmd_parser.add<int>("array", 0, "K of a K x K array", false, 0, cmdline::range(0, 4096));
+    cmd_parser.add<int>("struct_array", 0, "length of a struct array", false, 0, cmdline::range(0, 1 << 20));
+    cmd_parser.add<int>("struct_fields", 0, "number of members of the struct", false, 4, cmdline::range(2, 1024));
+    cmd_parser.add<std::string>("output", 'o', "write to this file instead of stdout", false, "");
+    cmd_parser.parse_check(argc, argv);
+
+    ststgen::SynthParams params{};
+    params.chain = cmd_parser.get<int>("chain");
+    params.disjunction = cmd_parser.get<int>("disjunction");
+    params.or_density = cmd_parser.get<int>("or_density");
+    params.array = cmd_parser.get<int>("array");
+    params.struct_array = cmd_parser.get<int>("struct_array");
+    params.struct_fields = cmd_parser.get<int>("struct_fields");
+    auto src = ststgen::make_synthetic_constraints(params);
+
+    const auto output = cmd_parser.get<std::string>("output");
+    if (output.empty()) {
+        fmt::print("{}", src);
+    } else {
+        std::ofstream ofs(output);
+        ofs << src;
+    }
+    return 0;
+}
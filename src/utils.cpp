@@ -1,6 +1,113 @@
 #include "utils.hpp"
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace ststgen {
-    int g_log_level = 1;
-    std::mutex g_log_mutex;
-}// namespace ststgen
\ No newline at end of file
+    std::atomic<int> g_log_level = 1;
+
+    namespace {
+        /// @brief 后台写日志的线程，持有所有线程的环形缓冲区
+        class LogSink {
+        public:
+            static LogSink &instance() {
+                static LogSink sink{};
+                return sink;
+            }
+
+            LogRing &local_ring() {
+                // shared_ptr让线程退出后未写出的日志仍能被取出
+                thread_local std::shared_ptr<LogRing> ring{};
+                if (!ring) {
+                    ring = std::make_shared<LogRing>();
+                    std::lock_guard<std::mutex> lock(m_rings_mutex);
+                    m_rings.push_back(ring);
+                    if (!m_worker.joinable()) {
+                        m_worker = std::thread([this] { run(); });
+                    }
+                }
+                return *ring;
+            }
+
+            void flush() {
+                auto target = m_submitted.load(std::memory_order_acquire);
+                while (m_written.load(std::memory_order_acquire) < target) {
+                    std::this_thread::yield();
+                }
+            }
+
+            void submitted() {
+                m_submitted.fetch_add(1, std::memory_order_release);
+            }
+
+            ~LogSink() {
+                m_stop.store(true, std::memory_order_release);
+                if (m_worker.joinable()) {
+                    m_worker.join();
+                }
+                drain_all();
+            }
+
+        private:
+            void run() {
+                while (!m_stop.load(std::memory_order_acquire)) {
+                    if (drain_all() == 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    }
+                }
+            }
+
+            size_t drain_all() {
+                std::vector<std::shared_ptr<LogRing>> rings{};
+                {
+                    std::lock_guard<std::mutex> lock(m_rings_mutex);
+                    rings = m_rings;
+                }
+                size_t n = 0;
+                for (auto &ring: rings) {
+                    ring->drain([&n](const std::string &line) {
+                        std::fwrite(line.data(), 1, line.size(), stderr);
+                        n++;
+                    });
+                }
+                if (n != 0) {
+                    std::fflush(stderr);
+                    m_written.fetch_add(n, std::memory_order_release);
+                }
+                return n;
+            }
+
+            std::mutex m_rings_mutex{};
+            std::vector<std::shared_ptr<LogRing>> m_rings{};
+            std::thread m_worker{};
+            std::atomic<bool> m_stop{false};
+            std::atomic<uint64_t> m_submitted{0};
+            std::atomic<uint64_t> m_written{0};
+        };
+    }// namespace
+
+    void LogRing::push(std::string &&line) {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        // 满时只等待后台线程，不与其他工作线程竞争
+        while (head - m_tail.load(std::memory_order_acquire) >= CAPACITY) {
+            std::this_thread::yield();
+        }
+        m_slots[head % CAPACITY] = std::move(line);
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    void _log_submit(std::string &&line) {
+        auto &sink = LogSink::instance();
+        sink.submitted();
+        sink.local_ring().push(std::move(line));
+    }
+
+    void log_flush() {
+        LogSink::instance().flush();
+    }
+}// namespace ststgen
@@ -1,36 +1,86 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <exception>
 #include <fmt/core.h>
-#include <mutex>
+#include <fmt/format.h>
 #include <stdexcept>
+#include <string>
+
+// 编译期日志级别，0时info/dbg完全不生成代码（参数也不会求值）
+#ifndef STSTGEN_LOG_COMPILE_LEVEL
+#define STSTGEN_LOG_COMPILE_LEVEL 1
+#endif
 
 namespace ststgen {
-    extern int g_log_level;
-    extern std::mutex g_log_mutex;
+    extern std::atomic<int> g_log_level;
+
+    inline bool log_enabled() {
+        return g_log_level.load(std::memory_order_relaxed) > 0;
+    }
+
+    /// @brief 单生产者单消费者的无锁环形缓冲区，每个线程一个，由后台线程取出写到stderr
+    class LogRing {
+    public:
+        static constexpr size_t CAPACITY = 1024;
+
+        void push(std::string &&line);
+        /// @brief 只由后台线程调用
+        template<typename F>
+        void drain(F &&sink) {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            const auto head = m_head.load(std::memory_order_acquire);
+            while (tail != head) {
+                auto &slot = m_slots[tail % CAPACITY];
+                sink(slot);
+                slot.clear();
+                ++tail;
+            }
+            m_tail.store(tail, std::memory_order_release);
+        }
+
+    private:
+        std::array<std::string, CAPACITY> m_slots{};
+        std::atomic<size_t> m_head{0};
+        std::atomic<size_t> m_tail{0};
+    };
+
+    /// @brief 把一行日志交给当前线程的环形缓冲区，首次调用时启动后台线程
+    void _log_submit(std::string &&line);
+    /// @brief 等待后台线程写出已提交的全部日志
+    void log_flush();
+
     template<typename T1, typename... T2>
-    void _log1(const T1 &x, const T2 &...xs) {
-        fmt::print(stderr, "{} ", x);
+    void _log1(fmt::memory_buffer &buf, const T1 &x, const T2 &...xs) {
+        fmt::format_to(std::back_inserter(buf), "{} ", x);
         if constexpr (sizeof...(xs) > 0) {
-            _log1(xs...);
+            _log1(buf, xs...);
         }
     }
 
     template<typename T1, typename... T2>
     void _log(const char *file, int line, const T1 &x, const T2 &...xs) {
-        std::lock_guard<std::mutex> lock(g_log_mutex);
-        if (g_log_level > 0) {
-            fmt::print(stderr, "{}:{} ", file, line);
-            fmt::print(stderr, "{} ", x);
-            if constexpr (sizeof...(xs) > 0) {
-                _log1(xs...);
-            }
-            fmt::println(stderr, "\n");
+        if (!log_enabled()) {
+            return;
         }
+        fmt::memory_buffer buf{};
+        fmt::format_to(std::back_inserter(buf), "{}:{} ", file, line);
+        _log1(buf, x, xs...);
+        fmt::format_to(std::back_inserter(buf), "\n\n");
+        _log_submit(fmt::to_string(buf));
     }
 
-#define info(...) ststgen::_log(__FILE__, __LINE__, __VA_ARGS__)
-#define dbg(var) ststgen::_log(__FILE__, __LINE__, #var ": ", var)
+// 参数只在日志开启时求值
+#define info(...)                                                  \
+    do {                                                           \
+        if constexpr (STSTGEN_LOG_COMPILE_LEVEL > 0) {             \
+            if (ststgen::log_enabled()) {                          \
+                ststgen::_log(__FILE__, __LINE__, __VA_ARGS__);    \
+            }                                                      \
+        }                                                          \
+    } while (0)
+#define dbg(var) info(#var ": ", var)
 
 #define panic(hint)                                         \
     do {                                                    \
@@ -47,6 +97,6 @@ namespace ststgen {
 #define unimplemented() panic("unimplemented")
 #define unreachable() panic("unreachable")
 #define todo() panic("todo")
-#define is_verbose if(g_log_level > 0)
+#define is_verbose if (STSTGEN_LOG_COMPILE_LEVEL > 0 && ststgen::log_enabled())
 
 }// namespace ststgen
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    test::GenerationOptions with_bitvec(bool positive = true) {
+        test::GenerationOptions opts{};
+        opts.cases = 10;
+        opts.positive = positive;
+        opts.configure = [](CConstraintVisitor &v) { v.setBitvec(true); };
+        return opts;
+    }
+}// namespace
+
+TEST(Bitvec, BitwiseOperatorsHoldInEveryCase) {
+    const char *src = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    (a & 255) == 18;
+    (b >> 4) == 3;
+    (a | b) != 0 && (a ^ b) > 100;
+    ~a < 0;
+}
+)";
+    test::Generation gen{src, with_bitvec()};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        EXPECT_EQ(c["a"].get<int64_t>() & 255, 18);
+        EXPECT_EQ(c["b"].get<int64_t>() >> 4, 3);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_EQ(gen.metrics().cases_rejected, 0u);
+}
+
+TEST(Bitvec, UnsignedComparisonsAreUnsigned) {
+    const char *src = R"(
+unsigned u;
+int i;
+
+void _CONSTRAINT()
+{
+    u > 4000000000;
+    i < -5;
+}
+)";
+    test::Generation gen{src, with_bitvec()};
+    for (const auto &c: gen.cases()) {
+        EXPECT_GT(c["u"].get<int64_t>(), 4000000000LL);
+        EXPECT_LE(c["u"].get<int64_t>(), UINT32_MAX);
+        EXPECT_LT(c["i"].get<int64_t>(), -5);
+    }
+}
+
+TEST(Bitvec, NegativeCasesViolateBitwiseConstraints) {
+    test::Generation gen{"int a;\nvoid _CONSTRAINT()\n{\n    (a & 7) == 5;\n}\n", with_bitvec(false)};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_NE(c["a"].get<int64_t>() & 7, 5);
+    }
+}
+
+TEST(Bitvec, BitwiseOperatorsNeedBitvecMode) {
+    test::GenerationOptions opts{};
+    opts.cases = 1;
+    EXPECT_THROW(test::Generation("int a;\nvoid _CONSTRAINT()\n{\n    (a & 7) == 5;\n}\n", opts), std::logic_error);
+}
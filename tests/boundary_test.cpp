@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    const char *RANGES = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    a >= 10 && a <= 20;
+    b > -5 && b < 1000;
+}
+)";
+
+    test::GenerationOptions with_boundary(bool positive) {
+        test::GenerationOptions opts{};
+        opts.cases = 10;
+        opts.positive = positive;
+        opts.configure = [](CConstraintVisitor &v) { v.setBoundary(true); };
+        return opts;
+    }
+
+    std::set<int64_t> values_of(const std::vector<json> &cases, const char *var) {
+        std::set<int64_t> ret{};
+        for (const auto &c: cases) {
+            ret.insert(c[var].get<int64_t>());
+        }
+        return ret;
+    }
+}// namespace
+
+TEST(Boundary, PositiveCasesHitBothEndsOfEachRange) {
+    test::Generation gen{RANGES, with_boundary(true)};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    auto a = values_of(cases, "a");
+    auto b = values_of(cases, "b");
+    EXPECT_TRUE(a.count(10) && a.count(20));
+    EXPECT_TRUE(b.count(-4) && b.count(999));
+    const auto &m = gen.metrics();
+    EXPECT_GT(m.boundary_targets, 0u);
+    EXPECT_GT(m.boundary_hits, 0u);
+    EXPECT_LE(m.boundary_hits, m.boundary_targets);
+}
+
+TEST(Boundary, NegativeCasesSitJustOutsideTheRange) {
+    test::Generation gen{RANGES, with_boundary(false)};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_FALSE(gen.satisfies(c)) << c.dump();
+    }
+    auto a = values_of(cases, "a");
+    auto b = values_of(cases, "b");
+    EXPECT_TRUE(a.count(9) || a.count(21) || b.count(-5) || b.count(1000));
+    EXPECT_GT(gen.metrics().boundary_hits, 0u);
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    void expect_in_range(const json &v, int64_t lo, int64_t hi, const json &c) {
+        ASSERT_TRUE(v.is_number_integer()) << c.dump();
+        EXPECT_GE(v.get<int64_t>(), lo) << c.dump();
+        EXPECT_LE(v.get<int64_t>(), hi) << c.dump();
+    }
+}// namespace
+
+TEST(Domain, NegatedConstraintsStayWithinTheDeclaredType) {
+    const char *src = R"(
+unsigned u;
+unsigned arr[3];
+int a;
+
+void _CONSTRAINT()
+{
+    u < 5;
+    arr[0] < 3;
+    a > 2147483000;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    opts.positive = false;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        // 不能靠取负数或超出int32来违反约束
+        expect_in_range(c["u"], 0, UINT32_MAX, c);
+        expect_in_range(c["arr"][0], 0, UINT32_MAX, c);
+        expect_in_range(c["a"], INT32_MIN, INT32_MAX, c);
+        EXPECT_FALSE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_EQ(gen.metrics().values_wrapped, 0u);
+}
+
+TEST(Domain, WideArithmeticDoesNotLeaveTheTypeRange) {
+    const char *src = R"(
+int a;
+long b;
+
+void _CONSTRAINT()
+{
+    b > 3000000000;
+    a * 1000 > b;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        expect_in_range(c["a"], INT32_MIN, INT32_MAX, c);
+        EXPECT_GT(c["b"].get<int64_t>(), 3000000000LL);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_EQ(gen.metrics().values_wrapped, 0u);
+}
+
+TEST(Domain, UnsatisfiableWithinTheTypeGivesNoCases) {
+    test::GenerationOptions opts{};
+    opts.cases = 5;
+    test::Generation gen{"unsigned u;\nvoid _CONSTRAINT()\n{\n    u < 0;\n}\n", opts};
+    EXPECT_TRUE(gen.cases().empty());
+}
+
+TEST(Domain, UnboundedLongsAreStillMutated) {
+    // 整个int64范围的取值个数在uint64中回绕为0，不能因此不做变异
+    const char *src = R"(
+long x;
+long y;
+int z;
+
+void _CONSTRAINT()
+{
+    x != 0;
+    y > 5;
+    z > 0 && z < 100;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 20u);
+    std::set<int64_t> xs{}, ys{}, zs{};
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        xs.insert(c["x"].get<int64_t>());
+        ys.insert(c["y"].get<int64_t>());
+        zs.insert(c["z"].get<int64_t>());
+    }
+    EXPECT_GT(xs.size(), 1u);
+    EXPECT_GT(ys.size(), 1u);
+    EXPECT_GT(zs.size(), 1u);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+TEST(Elimination, DefinedTermsAreComputedFromTheRest) {
+    const char *src = R"(
+int a;
+int b;
+int c;
+
+void _CONSTRAINT()
+{
+    a > 0 && a < 100;
+    b == a + 3;
+    c == 2 * a - b;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 20u);
+    for (const auto &c: cases) {
+        const auto a = c["a"].get<int64_t>();
+        EXPECT_EQ(c["b"].get<int64_t>(), a + 3);
+        EXPECT_EQ(c["c"].get<int64_t>(), a - 3);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    // 消去哪一项取决于项的顺序，第二个等式可能因与第一个成环而保留
+    EXPECT_GE(gen.metrics().terms_eliminated, 1u);
+}
+
+TEST(Elimination, FlatArrayElementsAreEliminated) {
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    opts.configure = [](CConstraintVisitor &v) { v.setArrayEncoding(ArrayEncoding::Flat); };
+    test::Generation gen{test::example("free_array.c"), opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_GT(gen.metrics().terms_eliminated, 0u);
+}
+
+TEST(Elimination, RedundantEquationsDoNotFormACycle) {
+    const char *src = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    b == a + 1;
+    a == b - 1;
+    a > 10 && a < 20;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 5;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 5u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_EQ(gen.metrics().terms_eliminated, 1u);
+}
+
+TEST(Elimination, EliminatedTermsKeepTheirTypeRange) {
+    const char *src = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    a > 2147483000;
+    b == a + 1000;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 3;
+    test::Generation gen{src, opts};
+    // b超出int32，整个约束在声明类型下不可满足
+    EXPECT_TRUE(gen.cases().empty());
+}
@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    /// @brief 嵌套json数组的各维长度，各行长度不一致时返回空
+    std::vector<size_t> shape(const json &v) {
+        if (!v.is_array()) {
+            return {};
+        }
+        std::vector<size_t> ret{v.size()};
+        if (v.empty() || !v[0].is_array()) {
+            return ret;
+        }
+        auto inner = shape(v[0]);
+        for (const auto &e: v) {
+            if (shape(e) != inner) {
+                return {};
+            }
+        }
+        ret.insert(ret.end(), inner.begin(), inner.end());
+        return ret;
+    }
+
+    test::GenerationOptions with_array_encoding(ArrayEncoding encoding, int cases = 10) {
+        test::GenerationOptions opts{};
+        opts.cases = cases;
+        opts.configure = [encoding](CConstraintVisitor &v) { v.setArrayEncoding(encoding); };
+        return opts;
+    }
+}// namespace
+
+class ArrayEncodingTest : public testing::TestWithParam<ArrayEncoding> {};
+
+TEST_P(ArrayEncodingTest, ConstantIndicesKeepShapeAndConstraints) {
+    test::Generation gen{test::example("ndim_array.c"), with_array_encoding(GetParam())};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        EXPECT_EQ(shape(c["a"]), (std::vector<size_t>{3, 4, 5}));
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+TEST_P(ArrayEncodingTest, SymbolicIndexFallsBackToNested) {
+    const char *src = R"(
+int a[4];
+int i;
+
+void _CONSTRAINT()
+{
+    i >= 0 && i < 4;
+    a[i] == 7;
+    a[0] != 7;
+}
+)";
+    test::Generation gen{src, with_array_encoding(GetParam())};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_EQ(shape(c["a"]), std::vector<size_t>{4});
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        EXPECT_NE(c["i"], 0);
+    }
+}
+
+TEST_P(ArrayEncodingTest, NegativeCasesViolateAnArrayConstraint) {
+    auto opts = with_array_encoding(GetParam());
+    opts.positive = false;
+    test::Generation gen{test::example("free_array.c"), opts};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_EQ(shape(c["a"]), std::vector<size_t>{10});
+        EXPECT_FALSE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Encodings, ArrayEncodingTest, testing::Values(ArrayEncoding::Nested, ArrayEncoding::Flat),
+                         [](const testing::TestParamInfo<ArrayEncoding> &info) {
+                             return info.param == ArrayEncoding::Flat ? "Flat" : "Nested";
+                         });
+
+namespace {
+    test::GenerationOptions with_pointer_encoding(PointerEncoding encoding, int max_length, int cases = 10) {
+        test::GenerationOptions opts{};
+        opts.cases = cases;
+        opts.configure = [encoding, max_length](CConstraintVisitor &v) { v.setPointerEncoding(encoding, max_length); };
+        return opts;
+    }
+}// namespace
+
+class PointerEncodingTest : public testing::TestWithParam<PointerEncoding> {};
+
+TEST_P(PointerEncodingTest, LengthAndElementConstraints) {
+    const char *src = R"(
+int _LENGTH(void* ptr);
+int *p;
+
+void _CONSTRAINT()
+{
+    _LENGTH(p) > 2 && _LENGTH(p) < 6;
+    p[1] == p[0] + 1;
+}
+)";
+    test::Generation gen{src, with_pointer_encoding(GetParam(), 8)};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        EXPECT_GT(c["p"].size(), 2u);
+        EXPECT_LT(c["p"].size(), 6u);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+TEST_P(PointerEncodingTest, SymbolicIndexWithinTheLength) {
+    const char *src = R"(
+int _LENGTH(void* ptr);
+int *p;
+int i;
+
+void _CONSTRAINT()
+{
+    i >= 1 && i < _LENGTH(p);
+    p[i] == 42;
+    p[0] != 42;
+}
+)";
+    test::Generation gen{src, with_pointer_encoding(GetParam(), 6)};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_LE(c["p"].size(), 6u);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+TEST(PointerEncoding, BoundedLengthStaysWithinTheMaximum) {
+    const char *src = R"(
+int *p;
+
+void _CONSTRAINT()
+{
+    p[0] > 3;
+}
+)";
+    test::Generation gen{src, with_pointer_encoding(PointerEncoding::Bounded, 4, 20)};
+    for (const auto &c: gen.cases()) {
+        EXPECT_GE(c["p"].size(), 1u);
+        EXPECT_LE(c["p"].size(), 4u);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+TEST_P(PointerEncodingTest, PointerMembersOfStructArrays) {
+    test::Generation gen{test::example("cons1.c"), with_pointer_encoding(GetParam(), 12)};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Encodings, PointerEncodingTest, testing::Values(PointerEncoding::Seq, PointerEncoding::Bounded),
+                         [](const testing::TestParamInfo<PointerEncoding> &info) {
+                             return info.param == PointerEncoding::Bounded ? "Bounded" : "Seq";
+                         });
+
+namespace {
+    test::GenerationOptions with_struct_encoding(StructEncoding encoding, int cases = 10) {
+        test::GenerationOptions opts{};
+        opts.cases = cases;
+        opts.configure = [encoding](CConstraintVisitor &v) { v.setStructEncoding(encoding); };
+        return opts;
+    }
+}// namespace
+
+class StructEncodingTest : public testing::TestWithParam<StructEncoding> {};
+
+TEST_P(StructEncodingTest, ExamplesWithStructs) {
+    for (auto file: {"cons5.c", "cons_complex.c"}) {
+        test::Generation gen{test::example(file), with_struct_encoding(GetParam())};
+        auto cases = gen.cases();
+        EXPECT_EQ(cases.size(), 10u) << file;
+        for (const auto &c: cases) {
+            EXPECT_TRUE(gen.satisfies(c)) << file << ": " << c.dump();
+        }
+    }
+}
+
+TEST_P(StructEncodingTest, MembersDoNotCollideWithSimilarlyNamedGlobals) {
+    const char *src = R"(
+typedef struct {
+    int a;
+} S;
+
+S s;
+S arr[2];
+int s__m__a;
+int s_a;
+int arr__i1__m__a;
+int arr__i1;
+
+void _CONSTRAINT()
+{
+    s.a == 1;
+    s__m__a == 2;
+    s_a == 3;
+    arr[1].a == 4;
+    arr__i1__m__a == 5;
+    arr__i1 == 6;
+}
+)";
+    test::Generation gen{src, with_struct_encoding(GetParam(), 3)};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_EQ(c["s"]["a"], 1);
+        EXPECT_EQ(c["s__m__a"], 2);
+        EXPECT_EQ(c["s_a"], 3);
+        EXPECT_EQ(c["arr"][1]["a"], 4);
+        EXPECT_EQ(c["arr__i1__m__a"], 5);
+        EXPECT_EQ(c["arr__i1"], 6);
+    }
+}
+
+TEST_P(StructEncodingTest, SymbolicIndexFallsBackToTuple) {
+    const char *src = R"(
+typedef struct {
+    int a;
+    int b;
+} S;
+
+S t[3];
+int i;
+
+void _CONSTRAINT()
+{
+    i >= 0 && i < 3;
+    t[i].a == 9;
+    t[0].b > t[1].b;
+}
+)";
+    test::Generation gen{src, with_struct_encoding(GetParam())};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_EQ(c["t"].size(), 3u);
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Encodings, StructEncodingTest, testing::Values(StructEncoding::Tuple, StructEncoding::Flat),
+                         [](const testing::TestParamInfo<StructEncoding> &info) {
+                             return info.param == StructEncoding::Flat ? "Flat" : "Tuple";
+                         });
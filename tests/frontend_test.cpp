@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "frontend.hpp"
+#include "generation.hpp"
+#include "subset_parser.hpp"
+
+using namespace ststgen;
+
+namespace {
+    const char *EXAMPLES[] = {"cons1.c", "cons2.c", "cons3.c", "cons4.c", "cons5.c",
+                              "cons_complex.c", "free_array.c", "ndim_array.c", "simple_val.c"};
+}// namespace
+
+TEST(Frontend, ExamplesParseInSllWithoutFallback) {
+    for (auto file: EXAMPLES) {
+        auto src = test::example(file);
+        ConstraintFrontend sll{src};
+        auto *fast = sll.parse();
+        ASSERT_NE(fast, nullptr) << file;
+        EXPECT_FALSE(sll.used_fallback()) << file;
+        // SLL成功时得到的树与LL相同
+        ConstraintFrontend ll{src};
+        EXPECT_EQ(fast->toStringTree(), ll.parse(false)->toStringTree()) << file;
+    }
+}
+
+TEST(SubsetParser, ParsesDeclarationsAndConstraints) {
+    auto src = test::example("cons1.c");
+    auto unit = subset::parse(src);
+    // 两个函数原型、typedef、三个变量，以及_CONSTRAINT的定义
+    ASSERT_EQ(unit.declarations.size(), 7u);
+    EXPECT_EQ(unit.declarations.back().declarators[0].name, "_CONSTRAINT");
+    const auto &s1 = unit.declarations[2];
+    EXPECT_TRUE(s1.is_typedef);
+    EXPECT_TRUE(s1.is_struct);
+    ASSERT_EQ(s1.members.size(), 4u);
+    EXPECT_EQ(s1.members[3].declarators[0].name, "d");
+    EXPECT_EQ(s1.members[3].declarators[0].pointer, 1);
+    EXPECT_EQ(s1.declarators[0].name, "S1");
+    const auto &b = unit.declarations[4];
+    EXPECT_EQ(b.declarators[0].name, "b");
+    EXPECT_EQ(b.declarators[0].dims, std::vector<int>{3});
+    EXPECT_TRUE(unit.declarations[0].declarators[0].is_function);
+
+    ASSERT_EQ(unit.constraints.size(), 7u);
+    // a > 5 && a < 10
+    const auto &root = unit.nodes[unit.constraints[0]];
+    EXPECT_EQ(root.kind, subset::NodeKind::Binary);
+    EXPECT_EQ(root.text, "&&");
+    const auto &lhs = unit.nodes[root.args[0]];
+    EXPECT_EQ(lhs.text, ">");
+    EXPECT_EQ(unit.nodes[lhs.args[0]].kind, subset::NodeKind::Identifier);
+    EXPECT_EQ(unit.nodes[lhs.args[1]].kind, subset::NodeKind::Constant);
+}
+
+TEST(SubsetParser, RespectsPrecedenceAndPostfix) {
+    auto unit = subset::parse("int a; int *p; void _CONSTRAINT() { a + 2 * p[a].x == 3; }");
+    ASSERT_EQ(unit.constraints.size(), 1u);
+    const auto &eq = unit.nodes[unit.constraints[0]];
+    EXPECT_EQ(eq.text, "==");
+    const auto &sum = unit.nodes[eq.args[0]];
+    EXPECT_EQ(sum.text, "+");
+    const auto &product = unit.nodes[sum.args[1]];
+    EXPECT_EQ(product.text, "*");
+    const auto &field = unit.nodes[product.args[1]];
+    EXPECT_EQ(field.kind, subset::NodeKind::Field);
+    EXPECT_EQ(field.text, "x");
+    EXPECT_EQ(unit.nodes[field.args[0]].kind, subset::NodeKind::Index);
+}
+
+TEST(SubsetParser, ExamplesAgreeWithConstraintCount) {
+    for (auto file: EXAMPLES) {
+        auto src = test::example(file);
+        subset::Unit unit{};
+        ASSERT_NO_THROW(unit = subset::parse(src)) << file;
+        EXPECT_FALSE(unit.constraints.empty()) << file;
+    }
+}
+
+TEST(SubsetParser, ReportsTheLineOfASyntaxError) {
+    try {
+        subset::parse("int a;\nvoid _CONSTRAINT()\n{\n    a > ;\n}\n");
+        FAIL() << "expected a syntax error";
+    } catch (const subset::SyntaxError &e) {
+        EXPECT_EQ(e.line, 4);
+    }
+}
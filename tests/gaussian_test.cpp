@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+TEST(Gaussian, BoundedScalarIsSampledAfterSolving) {
+    const char *src = R"(
+void GAUSSIAN(double VAR, double mu, double sigma);
+double x;
+int k;
+
+void _CONSTRAINT()
+{
+    GAUSSIAN(x, 10.0, 2.0);
+    x > 4 && x < 20;
+    k > 0 && k < 100000;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 200;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 200u);
+    double sum = 0.0;
+    for (const auto &c: cases) {
+        // 顶层变量同样要写入采样值，不能是null
+        ASSERT_TRUE(c["x"].is_number()) << c.dump();
+        const double x = c["x"].get<double>();
+        EXPECT_GT(x, 4.0);
+        EXPECT_LT(x, 20.0);
+        sum += x;
+    }
+    // 截断在[mu-3sigma, mu+5sigma]，均值略高于mu
+    EXPECT_NEAR(sum / cases.size(), 10.0, 0.6);
+    const auto &histogram = gen.metrics().gaussian.at("x");
+    EXPECT_GE(histogram.count, cases.size());
+    EXPECT_EQ(histogram.mu, 10.0);
+}
+
+TEST(Gaussian, StructMemberIsSampled) {
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    test::Generation gen{test::example("cons1.c"), opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 10u);
+    for (const auto &c: cases) {
+        ASSERT_TRUE(c["s"][0]["c"].is_number()) << c.dump();
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_TRUE(gen.metrics().gaussian.count("s[0].c"));
+}
+
+TEST(Gaussian, VariableInOtherConstraintsIsStillSolved) {
+    const char *src = R"(
+void GAUSSIAN(double VAR, double mu, double sigma);
+double x;
+double y;
+
+void _CONSTRAINT()
+{
+    GAUSSIAN(y, 0.0, 1.0);
+    x > 0 && x < 1;
+    y + x > 2;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        ASSERT_TRUE(c["y"].is_number()) << c.dump();
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+}
@@ -0,0 +1,69 @@
+#include "generation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+#include <unistd.h>
+
+namespace ststgen::test {
+
+    std::filesystem::path fresh_dir(const std::string &name) {
+        static std::atomic<int> serial{0};
+        auto dir = std::filesystem::temp_directory_path() /
+                   fmt::format("ststgen_test_{}_{}_{}", getpid(), name, serial++);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        return dir;
+    }
+
+    std::string example(const std::string &file) {
+        std::ifstream in{std::filesystem::path{STSTGEN_EXAMPLES_DIR} / file};
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    Generation::Generation(const std::string &src, GenerationOptions opts)
+        : m_frontend(src), m_visitor(opts.cases, opts.positive, opts.start),
+          m_out(opts.out.empty() ? fresh_dir("gen") : opts.out), m_prefix(opts.positive ? 'P' : 'N') {
+        g_log_level = 0;
+        if (opts.configure) {
+            opts.configure(m_visitor);
+        }
+        m_visitor.visit(m_frontend.parse());
+        if (opts.master_seed) {
+            m_visitor.setMasterSeed(*opts.master_seed);
+        } else {
+            m_visitor.setRandomSeed(opts.seed);
+        }
+        m_visitor.mutateEntrance(m_out.string());
+        m_visitor.writeCases();
+    }
+
+    std::vector<std::string> Generation::case_names() const {
+        std::vector<std::string> names{};
+        for (const auto &e: std::filesystem::directory_iterator(m_out)) {
+            const auto name = e.path().filename().string();
+            if (name.front() == m_prefix && e.path().extension() == ".json") {
+                names.push_back(name);
+            }
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::vector<json> Generation::cases() const {
+        std::vector<json> ret{};
+        for (const auto &name: case_names()) {
+            std::ifstream in{m_out / name};
+            ret.push_back(json::parse(in));
+        }
+        return ret;
+    }
+
+    bool Generation::satisfies(const json &single_case) const {
+        const auto &roots = m_visitor.getConstraintRoots();
+        return std::all_of(roots.cbegin(), roots.cend(), [&](ir::NodeId root) {
+            return ir::evaluate(m_visitor.getIR(), root, single_case);
+        });
+    }
+}// namespace ststgen::test
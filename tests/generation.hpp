@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "frontend.hpp"
+#include "parser.hpp"
+
+namespace ststgen::test {
+
+    /// @brief 返回一个新建的空临时目录
+    std::filesystem::path fresh_dir(const std::string &name);
+    /// @brief 读入constraint-examples下的约束文件
+    std::string example(const std::string &file);
+
+    struct GenerationOptions {
+        int cases = 20;
+        bool positive = true;
+        int start = 0;
+        unsigned seed = 2025;
+        // 设置后按主种子逐个编号生成
+        std::optional<uint64_t> master_seed = std::nullopt;
+        // 在visit之前调用，用于设置编码等选项
+        std::function<void(CConstraintVisitor &)> configure{};
+        // 为空时使用新建的临时目录
+        std::filesystem::path out{};
+    };
+
+    /// @brief 与core_runner相同的流程：解析、visit、生成并写出用例
+    class Generation {
+    public:
+        Generation(const std::string &src, GenerationOptions opts = {});
+        Generation(const Generation &) = delete;
+        Generation &operator=(const Generation &) = delete;
+
+        /// @brief 按文件名顺序读回写出的用例
+        std::vector<json> cases() const;
+        std::vector<std::string> case_names() const;
+        /// @brief 用原生求值器检查用例是否满足全部约束
+        bool satisfies(const json &single_case) const;
+        const WorkerMetrics &metrics() {
+            return m_visitor.getMetrics();
+        }
+        CConstraintVisitor &visitor() {
+            return m_visitor;
+        }
+        const std::filesystem::path &out() const {
+            return m_out;
+        }
+
+    private:
+        ConstraintFrontend m_frontend;
+        CConstraintVisitor m_visitor;
+        std::filesystem::path m_out;
+        char m_prefix;
+    };
+}// namespace ststgen::test
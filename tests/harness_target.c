@@ -0,0 +1,77 @@
+// 被测库样例：记录收到的参数，供harness_test检查编组结果
+#include <stddef.h>
+#include <stdint.h>
+
+double g_seen_float[4];
+long g_seen_int[4];
+
+void record_scalars(int a, float f, double d, float g, long b) {
+    g_seen_int[0] = a;
+    g_seen_int[1] = b;
+    g_seen_float[0] = f;
+    g_seen_float[1] = d;
+    g_seen_float[2] = g;
+}
+
+void record_pointer(int *arr, int *p, long p_len) {
+    long sum = 0;
+    for (long i = 0; i < p_len; ++i) {
+        sum += p[i];
+    }
+    g_seen_int[0] = arr[0] + arr[5];
+    g_seen_int[1] = sum;
+    g_seen_int[2] = p_len;
+}
+
+typedef struct {
+    float a;
+    int b;
+    float c[2];
+} FloatMembers;
+
+// float按4字节传入寄存器低位、在结构体与数组中占4字节
+void record_floats(float f, FloatMembers *s, float *buf) {
+    g_seen_float[0] = f;
+    g_seen_float[1] = s->a;
+    g_seen_float[2] = s->c[1];
+    g_seen_float[3] = buf[2];
+    g_seen_int[0] = s->b;
+    g_seen_int[1] = (long) sizeof(FloatMembers);
+}
+
+void crash_on_negative(int a) {
+    if (a < 0) {
+        *(volatile int *) 0 = a;
+    }
+}
+
+void spin_on_positive(int a) {
+    while (a > 0) {
+        *(volatile int *) &a = a;
+    }
+}
+
+// 手工调用SanitizerCoverage的回调，不依赖编译器的插桩选项
+void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop);
+void __sanitizer_cov_trace_pc_guard(uint32_t *guard);
+
+static uint32_t g_guards[4];
+
+static void edge(int i) {
+    __sanitizer_cov_trace_pc_guard_init(g_guards, g_guards + 4);
+    __sanitizer_cov_trace_pc_guard(&g_guards[i]);
+}
+
+void branchy(int a) {
+    edge(0);
+    if (a > 100) {
+        edge(1);
+    } else {
+        edge(2);
+    }
+    for (int i = 0; i < a && i < 20; ++i) {
+        if (a == 4242 || i == 9) {
+            edge(3);
+        }
+    }
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <dlfcn.h>
+#include <csignal>
+
+#include "generation.hpp"
+#include "harness.hpp"
+
+using namespace ststgen;
+
+namespace {
+    SymbolTableEntry scalar(SymbolTableEntryType type) {
+        SymbolTableEntry entry{};
+        entry.qualifer = SymbolTableEntryQualifer::Primary;
+        entry.type = type;
+        return entry;
+    }
+
+    Harness::Options target_options(const std::string &symbol) {
+        Harness::Options opts{};
+        opts.library = STSTGEN_TEST_TARGET;
+        opts.symbol = symbol;
+        opts.timeout_ms = 200;
+        return opts;
+    }
+
+    // 与Harness打开的是同一个库，可以直接读取被测函数记录下的参数
+    template<typename T>
+    T *target_global(const char *name) {
+        void *handle = dlopen(STSTGEN_TEST_TARGET, RTLD_NOW);
+        EXPECT_NE(handle, nullptr);
+        return static_cast<T *>(dlsym(handle, name));
+    }
+}// namespace
+
+TEST(Harness, PassesScalarsInDeclarationOrder) {
+    Harness harness(target_options("record_scalars"));
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{
+            {"a", scalar(SymbolTableEntryType::Int32)},
+            {"f", scalar(SymbolTableEntryType::Float32)},
+            {"d", scalar(SymbolTableEntryType::Float64)},
+            {"g", scalar(SymbolTableEntryType::Float32)},
+            {"b", scalar(SymbolTableEntryType::Int64)},
+    };
+    json single_case = {{"a", -7}, {"f", 1.5}, {"d", -2.25}, {"g", 3.75}, {"b", 1LL << 40}};
+    auto result = harness.run(single_case, params, {});
+    EXPECT_EQ(result.status, Harness::Status::Ok);
+
+    auto *seen_float = target_global<double>("g_seen_float");
+    auto *seen_int = target_global<long>("g_seen_int");
+    // float参数只占寄存器的低32位，按double传入会被被测函数读成别的值
+    EXPECT_EQ(seen_float[0], 1.5);
+    EXPECT_EQ(seen_float[1], -2.25);
+    EXPECT_EQ(seen_float[2], 3.75);
+    EXPECT_EQ(seen_int[0], -7);
+    EXPECT_EQ(seen_int[1], 1LL << 40);
+}
+
+TEST(Harness, PassesParsedFloatsAsFloat) {
+    const char *src = R"(
+typedef struct {
+    float a;
+    int b;
+    float c[2];
+} FloatMembers;
+
+float f;
+FloatMembers s;
+float buf[3];
+
+void _CONSTRAINT()
+{
+    f > 1 && f < 2;
+    s.a > 3 && s.a < 4;
+    s.b == 7;
+    s.c[1] > -5 && s.c[1] < -4;
+    buf[2] > 5 && buf[2] < 6;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 3;
+    test::Generation gen{src, opts};
+    auto params = gen.visitor().getDeclaredVariables();
+    const auto &blueprints = gen.visitor().getStructBlueprints();
+    ASSERT_EQ(params.size(), 3u);
+    EXPECT_EQ(params[0].second.type, SymbolTableEntryType::Float32);
+    EXPECT_EQ(params[2].second.type, SymbolTableEntryType::Float32);
+    EXPECT_EQ(blueprints.at("FloatMembers").m_members.at("a").type, SymbolTableEntryType::Float32);
+    EXPECT_EQ(blueprints.at("FloatMembers").m_members.at("c").type, SymbolTableEntryType::Float32);
+
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    Harness harness(target_options("record_floats"));
+    auto *seen_float = target_global<double>("g_seen_float");
+    auto *seen_int = target_global<long>("g_seen_int");
+    for (const auto &c: cases) {
+        // 用例中仍是json的浮点数，被测函数收到的是同一个值的float
+        ASSERT_TRUE(c["f"].is_number_float()) << c.dump();
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        EXPECT_EQ(harness.run(c, params, blueprints).status, Harness::Status::Ok);
+        EXPECT_EQ(seen_float[0], c["f"].get<float>());
+        EXPECT_EQ(seen_float[1], c["s"]["a"].get<float>());
+        EXPECT_EQ(seen_float[2], c["s"]["c"][1].get<float>());
+        EXPECT_EQ(seen_float[3], c["buf"][2].get<float>());
+        EXPECT_EQ(seen_int[0], 7);
+        EXPECT_EQ(seen_int[1], 16);
+    }
+}
+
+TEST(Harness, PassesArraysRowMajorAndPointersWithLength) {
+    Harness harness(target_options("record_pointer"));
+    auto arr = scalar(SymbolTableEntryType::Int32);
+    arr.qualifer = SymbolTableEntryQualifer::Array;
+    arr.dims = {2, 3};
+    auto ptr = scalar(SymbolTableEntryType::Int32);
+    ptr.qualifer = SymbolTableEntryQualifer::Pointer;
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{{"arr", arr}, {"p", ptr}};
+    json single_case = {{"arr", {{1, 2, 3}, {4, 5, 6}}}, {"p", {10, 20, 30, 40}}};
+    EXPECT_EQ(harness.run(single_case, params, {}).status, Harness::Status::Ok);
+
+    auto *seen_int = target_global<long>("g_seen_int");
+    EXPECT_EQ(seen_int[0], 1 + 6);
+    EXPECT_EQ(seen_int[1], 100);
+    EXPECT_EQ(seen_int[2], 4);
+}
+
+TEST(Harness, ReportsCrashAndKeepsRunning) {
+    Harness harness(target_options("crash_on_negative"));
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{{"a", scalar(SymbolTableEntryType::Int32)}};
+    auto crashed = harness.run({{"a", -1}}, params, {});
+    EXPECT_EQ(crashed.status, Harness::Status::Crash);
+    EXPECT_EQ(crashed.signal, SIGSEGV);
+    EXPECT_EQ(harness.run({{"a", 1}}, params, {}).status, Harness::Status::Ok);
+}
+
+TEST(Harness, ReportsTimeout) {
+    Harness harness(target_options("spin_on_positive"));
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{{"a", scalar(SymbolTableEntryType::Int32)}};
+    EXPECT_EQ(harness.run({{"a", 1}}, params, {}).status, Harness::Status::Timeout);
+    EXPECT_EQ(harness.run({{"a", 0}}, params, {}).status, Harness::Status::Ok);
+}
+
+TEST(Harness, ForkServerIsolatesCrashes) {
+    auto opts = target_options("crash_on_negative");
+    opts.fork_server = true;
+    Harness harness(opts);
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{{"a", scalar(SymbolTableEntryType::Int32)}};
+    auto crashed = harness.run({{"a", -1}}, params, {});
+    EXPECT_EQ(crashed.status, Harness::Status::Crash);
+    EXPECT_EQ(crashed.signal, SIGSEGV);
+    EXPECT_EQ(harness.run({{"a", 1}}, params, {}).status, Harness::Status::Ok);
+}
+
+TEST(Harness, CoverageCountsNewEdgesAndHitClasses) {
+    auto opts = target_options("branchy");
+    opts.coverage = true;
+    Harness harness(opts);
+    ASSERT_TRUE(harness.has_coverage());
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{{"a", scalar(SymbolTableEntryType::Int32)}};
+    auto run = [&](int a) { return harness.run({{"a", a}}, params, {}).new_edges; };
+    EXPECT_EQ(run(1), 2u);
+    EXPECT_EQ(run(1), 0u);
+    EXPECT_EQ(harness.edges_covered(), 2u);
+    EXPECT_EQ(run(200), 2u);
+    EXPECT_EQ(harness.edges_covered(), 4u);
+    // 同一条边命中次数进入新的档位也算新覆盖
+    EXPECT_EQ(run(4242), 1u);
+    EXPECT_EQ(run(4243), 0u);
+    EXPECT_EQ(harness.edges_covered(), 4u);
+}
+
+TEST(Harness, CoverageIsVisibleFromForkedChildren) {
+    auto opts = target_options("branchy");
+    opts.coverage = true;
+    opts.fork_server = true;
+    Harness harness(opts);
+    std::vector<std::pair<std::string, SymbolTableEntry>> params{{"a", scalar(SymbolTableEntryType::Int32)}};
+    EXPECT_EQ(harness.run({{"a", 1}}, params, {}).new_edges, 2u);
+    EXPECT_EQ(harness.run({{"a", 200}}, params, {}).new_edges, 2u);
+    EXPECT_EQ(harness.edges_covered(), 4u);
+}
+
+TEST(Harness, CoverageFeedbackSteersGeneration) {
+    auto opts = target_options("branchy");
+    opts.coverage = true;
+    Harness harness(opts);
+    test::GenerationOptions gen_opts{};
+    gen_opts.cases = 20;
+    gen_opts.configure = [&harness](CConstraintVisitor &v) { v.setHarness(&harness); };
+    test::Generation gen{"int a;\nvoid _CONSTRAINT()\n{\n    a > -1000 && a < 10000;\n}\n", gen_opts};
+    EXPECT_EQ(gen.cases().size(), 20u);
+    const auto &m = gen.metrics();
+    EXPECT_GT(m.cases_executed, 0u);
+    EXPECT_GT(m.cases_new_coverage, 0u);
+    EXPECT_LE(m.cases_new_coverage, m.cases_executed);
+    EXPECT_GE(harness.edges_covered(), 3u);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <fmt/format.h>
+
+#include "generation.hpp"
+#include "manifest.hpp"
+
+using namespace ststgen;
+
+namespace {
+    const char *RANGE_SRC = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    a > 0 && a < 100;
+    b == a + 1;
+}
+)";
+    const char *NARROWED_SRC = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    a > 50 && a < 100;
+    b == a + 1;
+}
+)";
+
+    std::string read_file(const std::filesystem::path &path) {
+        std::ifstream ifs(path);
+        std::stringstream ss{};
+        ss << ifs.rdbuf();
+        return ss.str();
+    }
+
+    test::GenerationOptions incremental(Incremental mode, const std::filesystem::path &out) {
+        test::GenerationOptions opts{};
+        opts.cases = 20;
+        opts.master_seed = 11;
+        opts.out = out;
+        opts.configure = [mode](CConstraintVisitor &v) { v.setIncremental(mode); };
+        return opts;
+    }
+}// namespace
+
+TEST(Manifest, ContentHashIsFnv1a) {
+    EXPECT_EQ(content_hash(""), "cbf29ce484222325");
+    EXPECT_EQ(content_hash("a"), "af63dc4c8601ec8c");
+    EXPECT_EQ(content_hash(RANGE_SRC), content_hash(std::string(RANGE_SRC)));
+    EXPECT_NE(content_hash(RANGE_SRC), content_hash(NARROWED_SRC));
+}
+
+TEST(Manifest, RecordsConstraintsSeedAndCounts) {
+    const auto manifest = make_manifest(RANGE_SRC, 42, 10, 5);
+    EXPECT_EQ(manifest["constraints"], content_hash(RANGE_SRC));
+    EXPECT_EQ(manifest["seed"], 42);
+    EXPECT_EQ(manifest["positive"], 10);
+    EXPECT_EQ(manifest["negative"], 5);
+    EXPECT_TRUE(make_manifest(RANGE_SRC, std::nullopt, 10, 5)["seed"].is_null());
+    EXPECT_EQ(manifest, make_manifest(RANGE_SRC, 42, 10, 5));
+    EXPECT_NE(manifest, make_manifest(NARROWED_SRC, 42, 10, 5));
+    EXPECT_NE(manifest, make_manifest(RANGE_SRC, 43, 10, 5));
+    EXPECT_NE(manifest, make_manifest(RANGE_SRC, 42, 11, 5));
+}
+
+TEST(Manifest, CorpusCompleteChecksEveryCaseFile) {
+    const auto dir = test::fresh_dir("manifest");
+    EXPECT_TRUE(corpus_complete(dir, 0, 0));
+    for (auto name: {"P00000.json", "P00001.json", "N00000.json"}) {
+        std::ofstream(dir / name) << "{}";
+    }
+    EXPECT_TRUE(corpus_complete(dir, 2, 1));
+    EXPECT_FALSE(corpus_complete(dir, 3, 1));
+    EXPECT_FALSE(corpus_complete(dir, 2, 2));
+    std::filesystem::remove(dir / "P00000.json");
+    EXPECT_FALSE(corpus_complete(dir, 2, 1));
+}
+
+TEST(Incremental, RevalidateKeepsCasesThatStillHold) {
+    const auto dir = test::fresh_dir("incremental_revalidate");
+    std::vector<json> before{};
+    {
+        test::Generation gen{RANGE_SRC, incremental(Incremental::Off, dir)};
+        before = gen.cases();
+    }
+    ASSERT_EQ(before.size(), 20u);
+    size_t still_hold = 0;
+    for (const auto &c: before) {
+        still_hold += c["a"].get<int>() > 50;
+    }
+
+    test::Generation gen{NARROWED_SRC, incremental(Incremental::Revalidate, dir)};
+    const auto &m = gen.metrics();
+    EXPECT_EQ(m.cases_kept, still_hold);
+    EXPECT_EQ(m.cases_invalidated, 20 - still_hold);
+    EXPECT_EQ(m.cases_produced, 20 - still_hold);
+    const auto after = gen.cases();
+    ASSERT_EQ(after.size(), 20u);
+    for (size_t i = 0; i < after.size(); ++i) {
+        EXPECT_TRUE(gen.satisfies(after[i])) << after[i].dump();
+        if (before[i]["a"].get<int>() > 50) {
+            EXPECT_EQ(after[i], before[i]) << i;
+        }
+    }
+}
+
+TEST(Incremental, TrustRegeneratesOnlyMissingCases) {
+    const auto dir = test::fresh_dir("incremental_trust");
+    std::vector<std::string> names{};
+    {
+        test::Generation gen{RANGE_SRC, incremental(Incremental::Off, dir)};
+        names = gen.case_names();
+    }
+    ASSERT_EQ(names.size(), 20u);
+    std::vector<std::string> original{};
+    for (const auto &name: names) {
+        original.push_back(read_file(dir / name));
+    }
+    std::filesystem::remove(dir / "P00003.json");
+    std::filesystem::remove(dir / "P00011.json");
+    // 保留的用例不被读入，改写其中一个可以看出它没有被重新生成
+    std::ofstream(dir / "P00000.json") << original[0] << '\n';
+
+    test::Generation gen{RANGE_SRC, incremental(Incremental::Trust, dir)};
+    EXPECT_EQ(gen.metrics().cases_kept, 18u);
+    EXPECT_EQ(gen.metrics().cases_invalidated, 0u);
+    EXPECT_EQ(gen.metrics().cases_produced, 2u);
+    EXPECT_EQ(gen.case_names(), names);
+    EXPECT_EQ(read_file(dir / "P00000.json"), original[0] + '\n');
+    // 按主种子生成时补上的用例与原来的相同
+    EXPECT_EQ(read_file(dir / "P00003.json"), original[3]);
+    EXPECT_EQ(read_file(dir / "P00011.json"), original[11]);
+}
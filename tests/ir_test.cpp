@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "ir.hpp"
+
+using namespace ststgen;
+using ir::Op;
+using json = nlohmann::json;
+
+TEST(IR, StructurallyEqualNodesShareAnId) {
+    ir::Arena arena{};
+    auto a = arena.var("a");
+    auto sum1 = arena.make(Op::Add, {a, arena.int_const(1)});
+    const auto size = arena.size();
+    auto sum2 = arena.make(Op::Add, {arena.var("a"), arena.int_const(1)});
+    EXPECT_EQ(sum1, sum2);
+    EXPECT_EQ(arena.size(), size);
+    // 运算、常量类型、参数顺序、成员名不同的都是不同节点
+    EXPECT_NE(sum1, arena.make(Op::Sub, {a, arena.int_const(1)}));
+    EXPECT_NE(arena.int_const(1), arena.real_const(1.0));
+    EXPECT_NE(sum1, arena.make(Op::Add, {arena.int_const(1), a}));
+    auto s = arena.var("s");
+    EXPECT_NE(arena.field(s, "x"), arena.field(s, "y"));
+    EXPECT_EQ(arena.field(s, "x"), arena.field(s, "x"));
+}
+
+TEST(IR, ToStringFollowsCSyntax) {
+    ir::Arena arena{};
+    auto idx = arena.make(Op::Index, {arena.var("b"), arena.int_const(2)});
+    auto field = arena.field(arena.make(Op::Index, {arena.var("s"), arena.int_const(0)}), "d");
+    auto cmp = arena.make(Op::Lt, {arena.make(Op::Add, {idx, arena.real_const(1.5)}), arena.make(Op::Length, {field})});
+    EXPECT_EQ(arena.to_string(cmp), "((b[2] + 1.5) < _LENGTH(s[0].d))");
+    EXPECT_EQ(arena.to_string(arena.real_const(2.0)), "2.0");
+    EXPECT_EQ(arena.to_string(arena.make(Op::Neg, {arena.var("a")})), "-(a)");
+}
+
+TEST(IR, LinearDecomposition) {
+    ir::Arena arena{};
+    auto a = arena.var("a");
+    auto b = arena.make(Op::Index, {arena.var("b"), arena.int_const(0)});
+    // 2 * (a - 3) + -(b) - a * 1 + 4
+    auto e = arena.make(Op::Add, {arena.make(Op::Sub, {arena.make(Op::Add, {arena.make(Op::Mul, {arena.int_const(2), arena.make(Op::Sub, {a, arena.int_const(3)})}),
+                                                                           arena.make(Op::Neg, {b})}),
+                                                         arena.make(Op::Mul, {a, arena.int_const(1)})}),
+                                   arena.int_const(4)});
+    auto t = arena.linear(e);
+    ASSERT_TRUE(t.has_value());
+    EXPECT_EQ(t->coeffs.size(), 2u);
+    EXPECT_DOUBLE_EQ(t->coeffs.at(a), 1.0);
+    EXPECT_DOUBLE_EQ(t->coeffs.at(b), -1.0);
+    EXPECT_DOUBLE_EQ(t->constant, -2.0);
+
+    // 系数相消的项不留在结果里
+    auto cancel = arena.linear(arena.make(Op::Sub, {a, a}));
+    ASSERT_TRUE(cancel.has_value());
+    EXPECT_TRUE(cancel->coeffs.empty());
+}
+
+TEST(IR, NonLinearTermsAreRejected) {
+    ir::Arena arena{};
+    auto a = arena.var("a");
+    auto b = arena.var("b");
+    EXPECT_FALSE(arena.linear(arena.make(Op::Mul, {a, b})).has_value());
+    EXPECT_FALSE(arena.linear(arena.make(Op::Div, {a, arena.int_const(2)})).has_value());
+    EXPECT_FALSE(arena.linear(arena.make(Op::Mod, {a, arena.int_const(2)})).has_value());
+    EXPECT_FALSE(arena.linear(arena.make(Op::Lt, {a, b})).has_value());
+}
+
+TEST(IR, EvaluatesWithJsSemantics) {
+    ir::Arena arena{};
+    auto a = arena.var("a");
+    auto b = arena.var("b");
+    json env = {{"a", 7}, {"b", {1, 2, 3}}, {"s", {{"x", 4.5}}}};
+    auto num = [&](ir::NodeId id) { return ir::evaluate_number(arena, id, env); };
+    // /是实数除法，%与JS一样保留符号
+    EXPECT_DOUBLE_EQ(num(arena.make(Op::Div, {a, arena.int_const(2)})), 3.5);
+    EXPECT_DOUBLE_EQ(num(arena.make(Op::Mod, {arena.make(Op::Neg, {a}), arena.int_const(3)})), -1.0);
+    EXPECT_DOUBLE_EQ(num(arena.make(Op::Length, {b})), 3.0);
+    EXPECT_DOUBLE_EQ(num(arena.field(arena.var("s"), "x")), 4.5);
+    EXPECT_DOUBLE_EQ(num(arena.make(Op::Cond, {arena.make(Op::Gt, {a, arena.int_const(5)}), arena.int_const(1), arena.int_const(2)})), 1.0);
+    // 位运算按int32
+    EXPECT_DOUBLE_EQ(num(arena.make(Op::BitAnd, {arena.real_const(4294967295.0 + 8), arena.int_const(12)})), 4.0);
+    EXPECT_DOUBLE_EQ(num(arena.make(Op::Shl, {arena.int_const(1), arena.int_const(31)})), -2147483648.0);
+    EXPECT_TRUE(ir::evaluate(arena, arena.make(Op::And, {a, arena.make(Op::Eq, {arena.make(Op::Index, {b, arena.int_const(2)}), arena.int_const(3)})}), env));
+}
+
+TEST(IR, OutOfBoundsAccessMakesComparisonsFalse) {
+    ir::Arena arena{};
+    auto elem = arena.make(Op::Index, {arena.var("b"), arena.int_const(5)});
+    json env = {{"b", {1, 2, 3}}};
+    EXPECT_TRUE(std::isnan(ir::evaluate_number(arena, elem, env)));
+    EXPECT_FALSE(ir::evaluate(arena, arena.make(Op::Eq, {elem, elem}), env));
+    EXPECT_FALSE(ir::evaluate(arena, arena.make(Op::Lt, {elem, arena.int_const(0)}), env));
+    EXPECT_FALSE(ir::evaluate(arena, arena.make(Op::Ge, {elem, arena.int_const(0)}), env));
+    // 没有的变量同样是undefined
+    EXPECT_FALSE(ir::evaluate(arena, arena.make(Op::Gt, {arena.var("missing"), arena.int_const(0)}), env));
+    // 但 != 为真，与JS一致
+    EXPECT_TRUE(ir::evaluate(arena, arena.make(Op::Ne, {elem, arena.int_const(0)}), env));
+}
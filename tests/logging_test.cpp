@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+using namespace ststgen;
+
+namespace {
+    int g_evaluated = 0;
+
+    int side_effect() {
+        return ++g_evaluated;
+    }
+
+    // 恢复测试前的日志级别
+    struct LogLevel {
+        explicit LogLevel(int level) : m_saved(g_log_level.load()) {
+            g_log_level = level;
+        }
+        ~LogLevel() {
+            g_log_level = m_saved;
+        }
+        int m_saved;
+    };
+}// namespace
+
+TEST(Logging, RingIsFifo) {
+    LogRing ring{};
+    ring.push("a");
+    ring.push("b");
+    std::vector<std::string> out{};
+    ring.drain([&](const std::string &line) { out.push_back(line); });
+    ring.push("c");
+    ring.drain([&](const std::string &line) { out.push_back(line); });
+    EXPECT_EQ(out, (std::vector<std::string>{"a", "b", "c"}));
+}
+
+TEST(Logging, RingWrapsAroundUnderAConcurrentConsumer) {
+    LogRing ring{};
+    constexpr size_t N = LogRing::CAPACITY * 5 + 7;
+    std::vector<std::string> out{};
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        while (!done.load() || out.size() < N) {
+            ring.drain([&](const std::string &line) { out.push_back(line); });
+        }
+    });
+    // 环满时push等待消费者，不丢弃也不覆盖
+    for (size_t i = 0; i < N; ++i) {
+        ring.push(std::to_string(i));
+    }
+    done = true;
+    consumer.join();
+    ASSERT_EQ(out.size(), N);
+    for (size_t i = 0; i < N; ++i) {
+        ASSERT_EQ(out[i], std::to_string(i));
+    }
+}
+
+TEST(Logging, ArgumentsAreNotEvaluatedWhenDisabled) {
+    LogLevel level{0};
+    g_evaluated = 0;
+    info("value", side_effect());
+    dbg(side_effect());
+    EXPECT_EQ(g_evaluated, 0);
+}
+
+TEST(Logging, EnabledLinesReachStderrAfterFlush) {
+    LogLevel level{1};
+    testing::internal::CaptureStderr();
+    std::thread worker([] { info("from worker", 42); });
+    worker.join();
+    info("from main", side_effect());
+    log_flush();
+    auto err = testing::internal::GetCapturedStderr();
+    EXPECT_NE(err.find("from worker 42"), std::string::npos);
+    EXPECT_NE(err.find("from main"), std::string::npos);
+}
+
+TEST(Logging, PanicAndAssertThrow) {
+    LogLevel level{0};
+    EXPECT_THROW(panic("boom"), std::logic_error);
+    EXPECT_THROW(stst_assert(1 + 1 == 3), std::logic_error);
+    EXPECT_NO_THROW(stst_assert(1 + 1 == 2));
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <fmt/format.h>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    test::GenerationOptions with_limits(MemoryLimits limits, int cases, std::optional<uint64_t> master_seed = std::nullopt) {
+        test::GenerationOptions opts{};
+        opts.cases = cases;
+        opts.master_seed = master_seed;
+        opts.configure = [limits](CConstraintVisitor &v) { v.setMemoryLimits(limits); };
+        return opts;
+    }
+
+    void expect_consecutive(const std::vector<std::string> &names, size_t count) {
+        ASSERT_EQ(names.size(), count);
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(names[i], fmt::format("P{:05d}.json", i));
+        }
+    }
+}// namespace
+
+TEST(Memory, PeaksAreRecordedWithoutLimits) {
+    test::Generation gen{test::example("cons1.c"), with_limits({}, 10)};
+    EXPECT_EQ(gen.cases().size(), 10u);
+    const auto &m = gen.metrics();
+    EXPECT_GT(m.memory_peak, 0u);
+    EXPECT_GT(m.memory_z3_peak, 0u);
+    EXPECT_LE(m.memory_z3_peak, m.memory_peak);
+    EXPECT_EQ(m.memory_flushes, 0u);
+    EXPECT_EQ(m.memory_limited, 0u);
+}
+
+TEST(Memory, SoftLimitWritesEveryCaseInBatches) {
+    // 1字节的软上限：每次检查都提前写出用例、重建求解器，但不停止
+    for (auto seed: {std::optional<uint64_t>{}, std::optional<uint64_t>{7}}) {
+        test::Generation gen{test::example("cons1.c"), with_limits({1, 0, 1}, 20, seed)};
+        const auto &m = gen.metrics();
+        EXPECT_GT(m.memory_flushes, 0u);
+        EXPECT_EQ(m.memory_limited, 0u);
+        expect_consecutive(gen.case_names(), 20);
+        for (const auto &c: gen.cases()) {
+            EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        }
+    }
+}
+
+TEST(Memory, HardLimitStopsGeneration) {
+    // 按主种子生成时每个用例之后检查，第一个用例后即停止
+    test::Generation seeded{test::example("cons1.c"), with_limits({0, 1, 1}, 20, 7)};
+    EXPECT_EQ(seeded.metrics().memory_limited, 1u);
+    expect_consecutive(seeded.case_names(), 1);
+
+    // 变异模式下每轮变异之后检查
+    test::Generation mutated{test::example("cons1.c"), with_limits({0, 1, 1}, 1000)};
+    EXPECT_EQ(mutated.metrics().memory_limited, 1u);
+    const auto cases = mutated.cases();
+    EXPECT_LT(cases.size(), 1000u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(mutated.satisfies(c)) << c.dump();
+    }
+}
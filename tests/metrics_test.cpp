@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <thread>
+
+#include "generation.hpp"
+#include "metrics.hpp"
+
+using namespace ststgen;
+using std::chrono::microseconds;
+
+TEST(Metrics, LatencyBucketsArePowersOfTwo) {
+    LatencyHistogram h{};
+    h.add(microseconds(0));
+    h.add(microseconds(3));
+    h.add(microseconds(1000));
+    h.add(microseconds(1023));
+    auto j = h.to_json();
+    EXPECT_EQ(j.size(), 3u);
+    EXPECT_EQ(j["0"], 1);
+    EXPECT_EQ(j["2"], 1);
+    EXPECT_EQ(j["512"], 2);
+}
+
+TEST(Metrics, SampleHistogramBinsAndMoments) {
+    SampleHistogram h{};
+    h.mu = 10.0;
+    h.sigma = 2.0;
+    for (double v: {10.0, 10.0, 12.0, 8.0, 100.0, -100.0}) {
+        h.add(v);
+    }
+    EXPECT_EQ(h.counts.front(), 1u);
+    EXPECT_EQ(h.counts.back(), 1u);
+    // 每桶宽sigma/2，mu落在中间两桶的分界处
+    EXPECT_EQ(h.counts[SampleHistogram::BINS / 2 + 1], 2u);
+    auto j = h.to_json();
+    EXPECT_EQ(j["count"], 6);
+    EXPECT_DOUBLE_EQ(j["mean"].get<double>(), 40.0 / 6);
+}
+
+TEST(Metrics, WorkerMetricsSumAcrossWorkers) {
+    WorkerMetrics a{}, b{};
+    a.checks_sat = 3;
+    a.cases_produced = 2;
+    a.times.solve = std::chrono::milliseconds(5);
+    a.check_latency.add(microseconds(4));
+    a.gaussian["x"].mu = 1.0;
+    a.gaussian["x"].add(1.0);
+    b.checks_sat = 1;
+    b.checks_unsat = 2;
+    b.cases_produced = 2;
+    b.times.solve = std::chrono::milliseconds(15);
+    b.check_latency.add(microseconds(4));
+    b.gaussian["x"].add(2.0);
+    b.gaussian["y"].add(0.0);
+
+    WorkerMetrics total{};
+    total += a;
+    total += b;
+    auto j = total.to_json();
+    EXPECT_EQ(j["checks"]["sat"], 4);
+    EXPECT_EQ(j["checks"]["unsat"], 2);
+    EXPECT_DOUBLE_EQ(j["checks"]["per_case"].get<double>(), 6.0 / 4);
+    EXPECT_EQ(j["checks"]["latency_us"]["4"], 2);
+    EXPECT_EQ(j["cases"]["produced"], 4);
+    EXPECT_DOUBLE_EQ(j["time"]["solve"].get<double>(), 0.02);
+    EXPECT_EQ(j["gaussian"]["x"]["count"], 2);
+    EXPECT_EQ(j["gaussian"]["x"]["mu"], 1.0);
+    EXPECT_EQ(j["gaussian"]["y"]["count"], 1);
+    // 没有执行过用例时不输出覆盖一节
+    EXPECT_FALSE(j.contains("coverage"));
+}
+
+TEST(Metrics, TraceIsChromeTraceEventJson) {
+    auto &recorder = TraceRecorder::instance();
+    recorder.enable();
+    std::thread worker([&] {
+        recorder.set_thread_name("worker 1");
+        TraceSpan span{"solve", "generate"};
+    });
+    worker.join();
+    auto path = test::fresh_dir("trace") / "trace.json";
+    recorder.write(path);
+
+    std::ifstream in{path};
+    auto trace = json::parse(in);
+    ASSERT_TRUE(trace["traceEvents"].is_array());
+    bool named = false, spanned = false;
+    for (const auto &e: trace["traceEvents"]) {
+        if (e["ph"] == "M" && e["args"]["name"] == "worker 1") {
+            named = true;
+        }
+        if (e["ph"] == "X" && e["name"] == "solve") {
+            EXPECT_EQ(e["cat"], "generate");
+            EXPECT_GE(e["dur"].get<int64_t>(), 0);
+            spanned = true;
+        }
+    }
+    EXPECT_TRUE(named);
+    EXPECT_TRUE(spanned);
+}
+
+TEST(Metrics, GenerationCountsChecksAndPhases) {
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    test::Generation gen{test::example("simple_val.c"), opts};
+    const auto &m = gen.metrics();
+    EXPECT_GT(m.checks_sat, 0u);
+    EXPECT_GE(m.cases_produced, gen.cases().size());
+    EXPECT_GT(m.times.solve.count(), 0);
+    EXPECT_GT(m.times.write.count(), 0);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    void expect_reuse_accounting(const WorkerMetrics &m) {
+        EXPECT_GT(m.checks_saved, 0u);
+        // 每次省下的检查都对应一次提取，且本身是一次sat检查
+        EXPECT_LE(m.checks_saved, m.cases_produced + m.cases_deduplicated);
+        EXPECT_LE(m.checks_saved, m.checks_sat);
+    }
+}// namespace
+
+TEST(ModelReuse, CasesComeFromTheMutationChecks) {
+    test::GenerationOptions opts{};
+    opts.cases = 30;
+    test::Generation gen{test::example("cons3.c"), opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 30u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    expect_reuse_accounting(gen.metrics());
+}
+
+TEST(ModelReuse, GaussianScopesAreSampledPerCase) {
+    const char *src = R"(
+void GAUSSIAN(double VAR, double mu, double sigma);
+double x;
+int k;
+
+void _CONSTRAINT()
+{
+    GAUSSIAN(x, 0.0, 1.0);
+    x > k;
+    k > -3 && k < 3;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    expect_reuse_accounting(gen.metrics());
+}
+
+TEST(ModelReuse, NegativeCasesAreStillViolating) {
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    opts.positive = false;
+    test::Generation gen{test::example("cons5.c"), opts};
+    for (const auto &c: gen.cases()) {
+        EXPECT_FALSE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_LE(gen.metrics().checks_saved, gen.metrics().checks_sat);
+}
+
+TEST(ModelReuse, ConflictingGaussianSamplesCostOneCheck) {
+    // k是唯一变异的变量，每次叶子检查要么用取样值得到用例，要么因取样值与x > k冲突而不可满足；
+    // 冲突时不再另做一次不带取样值的检查，因此未被复用的sat检查只剩变异之外的少数几次
+    const char *src = R"(
+void GAUSSIAN(double VAR, double mu, double sigma);
+double x;
+int k;
+
+void _CONSTRAINT()
+{
+    GAUSSIAN(x, 0.0, 1.0);
+    x > k;
+    k > -3 && k < 3;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    test::Generation gen{src, opts};
+    ASSERT_EQ(gen.cases().size(), 20u);
+    const auto &m = gen.metrics();
+    EXPECT_GT(m.checks_unsat, 0u);
+    EXPECT_LT(m.checks_sat - m.checks_saved, m.checks_unsat);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+TEST(OrCombinations, EveryBranchCombinationIsCovered) {
+    const char *src = R"(
+int a;
+int b;
+
+void _CONSTRAINT()
+{
+    a < -100 || a > 100;
+    b == 1 || b == 2 || b == 3;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 18;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 18u);
+    std::set<std::pair<bool, int64_t>> combinations{};
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        combinations.emplace(c["a"].get<int64_t>() > 0, c["b"].get<int64_t>());
+    }
+    EXPECT_EQ(combinations.size(), 6u);
+}
+
+TEST(OrCombinations, InfeasibleBranchPairsArePruned) {
+    const char *src = R"(
+int x;
+int y;
+
+void _CONSTRAINT()
+{
+    x > 5 || x < 0;
+    x < 3 || x > 10;
+    y == 1 || y == 2 || y == 3;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 12;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 12u);
+    bool low = false, high = false;
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        low |= c["x"].get<int64_t>() < 0;
+        high |= c["x"].get<int64_t>() > 10;
+    }
+    EXPECT_TRUE(low && high);
+    // (x > 5, x < 3)与(x < 0, x > 10)各有三个组合，每对冲突只需求解一次
+    EXPECT_EQ(gen.metrics().or_combinations_pruned, 4u);
+}
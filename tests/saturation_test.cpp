@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+TEST(Saturation, StopsWhenEverySolutionHasBeenFound) {
+    test::GenerationOptions opts{};
+    opts.cases = 10;
+    test::Generation gen{"int a;\nvoid _CONSTRAINT()\n{\n    a >= 0 && a < 3;\n}\n", opts};
+    auto cases = gen.cases();
+    std::set<int64_t> values{};
+    for (const auto &c: cases) {
+        values.insert(c["a"].get<int64_t>());
+    }
+    EXPECT_EQ(cases.size(), 3u);
+    EXPECT_EQ(values, (std::set<int64_t>{0, 1, 2}));
+    EXPECT_EQ(gen.metrics().space_exhausted, 1u);
+}
+
+TEST(Saturation, DependentVariablesShareTheSolutionCount) {
+    const char *src = R"(
+int a;
+int b;
+int c[2];
+
+void _CONSTRAINT()
+{
+    a >= 0 && a < 2;
+    b == a * 2;
+    c[0] == b && c[1] == a;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 8;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    EXPECT_EQ(cases.size(), 2u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_EQ(gen.metrics().space_exhausted, 1u);
+}
+
+TEST(Saturation, LargeSpacesAreNotReportedExhausted) {
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    test::Generation gen{test::example("simple_val.c"), opts};
+    EXPECT_EQ(gen.cases().size(), 20u);
+    EXPECT_EQ(gen.metrics().space_exhausted, 0u);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "generation.hpp"
+#include "rng.hpp"
+
+using namespace ststgen;
+
+namespace {
+    std::vector<uint64_t> take(Philox g, size_t n) {
+        std::vector<uint64_t> ret(n);
+        for (auto &v: ret) {
+            v = g();
+        }
+        return ret;
+    }
+
+    std::string read_file(const std::filesystem::path &path) {
+        std::ifstream in{path};
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    test::GenerationOptions seeded(uint64_t seed, int start, int cases, bool positive = true) {
+        test::GenerationOptions opts{};
+        opts.master_seed = seed;
+        opts.start = start;
+        opts.cases = cases;
+        opts.positive = positive;
+        return opts;
+    }
+}// namespace
+
+TEST(Philox, MatchesTheReferenceKnownAnswer) {
+    // Random123 kat_vectors: philox4x32_10, 计数器与key全为0
+    Philox g{};
+    EXPECT_EQ(g(), 0xe169c58d6627e8d5ull);
+    EXPECT_EQ(g(), 0x9b00dbd8bc57ac4cull);
+}
+
+TEST(Philox, StreamsAreIndependentAndReproducible) {
+    const auto base = take(Philox(7, 'P', 3, 0), 8);
+    EXPECT_EQ(take(Philox(7, 'P', 3, 0), 8), base);
+    EXPECT_NE(take(Philox(8, 'P', 3, 0), 8), base);
+    EXPECT_NE(take(Philox(7, 'N', 3, 0), 8), base);
+    EXPECT_NE(take(Philox(7, 'P', 4, 0), 8), base);
+    EXPECT_NE(take(Philox(7, 'P', 3, Philox::stream_of("a")), 8), base);
+}
+
+TEST(Philox, StreamIdsAreFnv1a) {
+    EXPECT_EQ(Philox::stream_of("a"), 0xe40c292cu);
+    EXPECT_EQ(Philox::stream_of("s[0].d"), Philox::stream_of("s[0].d"));
+    EXPECT_NE(Philox::stream_of("b[0]"), Philox::stream_of("b[1]"));
+    EXPECT_NE(Philox::stream_of(""), 0u);
+}
+
+TEST(Seed, AnySingleCaseCanBeRegenerated) {
+    const auto src = test::example("cons1.c");
+    test::Generation all{src, seeded(42, 0, 8)};
+    auto names = all.case_names();
+    ASSERT_FALSE(names.empty());
+    for (int id: {0, 5, 7}) {
+        const auto name = fmt::format("P{:05d}.json", id);
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            continue;
+        }
+        // 每个用例都从新的求解器开始，与之前生成过哪些用例无关
+        test::Generation one{src, seeded(42, id, 1)};
+        EXPECT_EQ(read_file(one.out() / name), read_file(all.out() / name)) << name;
+    }
+}
+
+TEST(Seed, SplittingTheRangeDoesNotChangeTheCases) {
+    const auto src = test::example("simple_val.c");
+    test::Generation all{src, seeded(7, 0, 6, false)};
+    auto dir = test::fresh_dir("split");
+    auto first = seeded(7, 0, 3, false);
+    first.out = dir;
+    auto second = seeded(7, 3, 3, false);
+    second.out = dir;
+    test::Generation{src, first};
+    test::Generation{src, second};
+    for (const auto &name: all.case_names()) {
+        EXPECT_EQ(read_file(dir / name), read_file(all.out() / name)) << name;
+    }
+}
+
+TEST(Seed, DifferentMasterSeedsGiveDifferentCases) {
+    const auto src = test::example("cons3.c");
+    test::Generation a{src, seeded(1, 0, 4)};
+    test::Generation b{src, seeded(2, 0, 4)};
+    EXPECT_NE(a.cases(), b.cases());
+}
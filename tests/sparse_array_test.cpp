@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "generation.hpp"
+#include "ir.hpp"
+#include "rng.hpp"
+#include "sparse_array.hpp"
+
+using namespace ststgen;
+using json = nlohmann::json;
+
+namespace {
+    json expand(const SparseArray &array) {
+        std::ostringstream os{};
+        array.write_json(os);
+        return json::parse(os.str());
+    }
+
+    SymbolTableEntry array_entry(SymbolTableEntryType type, std::vector<int> dims) {
+        SymbolTableEntry entry{};
+        entry.qualifer = SymbolTableEntryQualifer::Array;
+        entry.type = type;
+        entry.dims = std::move(dims);
+        return entry;
+    }
+}// namespace
+
+TEST(Philox, FillMatchesSequentialCallsFromAnyOffset) {
+    const Philox gen{2025, 'P', 3, Philox::stream_of("a")};
+    std::vector<uint32_t> expected{};
+    auto seq = gen;
+    for (int i = 0; i < 16; ++i) {
+        const auto v = seq();
+        expected.push_back(static_cast<uint32_t>(v));
+        expected.push_back(static_cast<uint32_t>(v >> 32));
+    }
+    for (size_t offset: {0, 1, 3, 4, 7, 13}) {
+        std::vector<uint32_t> words(expected.size() - offset);
+        gen.fill(offset, words.data(), words.size());
+        EXPECT_TRUE(std::equal(words.begin(), words.end(), expected.begin() + static_cast<long>(offset))) << offset;
+    }
+}
+
+TEST(SparseArray, KnownElementsOverrideGeneratedOnes) {
+    auto sparse = SparseArray::make({3, 5}, 42);
+    SparseArray::set(sparse, {3, 5}, {0, 4}, 7);
+    SparseArray::set(sparse, {3, 5}, {2, 0}, -9);
+    EXPECT_TRUE(SparseArray::is_sparse(sparse));
+    EXPECT_FALSE(SparseArray::is_sparse(json::array({1, 2})));
+
+    SparseArray array{sparse, {3, 5}, SymbolTableEntryType::Int32};
+    EXPECT_EQ(array.size(), 15u);
+    EXPECT_EQ(array.element_size(), 4u);
+    auto full = expand(array);
+    ASSERT_EQ(full.size(), 3u);
+    for (const auto &row: full) {
+        EXPECT_EQ(row.size(), 5u);
+    }
+    EXPECT_EQ(full[0][4], 7);
+    EXPECT_EQ(full[2][0], -9);
+
+    // fill与write_json按同样的C内存布局给出同样的元素
+    std::vector<int32_t> raw(array.size());
+    array.fill(0, raw.size(), reinterpret_cast<std::byte *>(raw.data()));
+    for (size_t i = 0; i < raw.size(); ++i) {
+        EXPECT_EQ(full[i / 5][i % 5], raw[i]) << i;
+    }
+    // 从中间开始的一段与整体的对应部分相同
+    std::vector<int32_t> tail(6);
+    array.fill(9, tail.size(), reinterpret_cast<std::byte *>(tail.data()));
+    EXPECT_TRUE(std::equal(tail.begin(), tail.end(), raw.begin() + 9));
+}
+
+TEST(SparseArray, SameSeedGivesSameElements) {
+    const auto a = expand(SparseArray{SparseArray::make({100}, 7), {100}, SymbolTableEntryType::Int64});
+    const auto b = expand(SparseArray{SparseArray::make({100}, 7), {100}, SymbolTableEntryType::Int64});
+    const auto c = expand(SparseArray{SparseArray::make({100}, 8), {100}, SymbolTableEntryType::Int64});
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+}
+
+TEST(SparseArray, FloatsStayInTheRandomValueRange) {
+    SparseArray array{SparseArray::make({1000}, 1), {1000}, SymbolTableEntryType::Float32};
+    std::vector<float> raw(array.size());
+    array.fill(0, raw.size(), reinterpret_cast<std::byte *>(raw.data()));
+    for (auto v: raw) {
+        EXPECT_GE(v, static_cast<float>(INT32_MIN));
+        EXPECT_LE(v, static_cast<float>(INT32_MAX));
+    }
+    EXPECT_EQ(array.element_size(), 4u);
+    EXPECT_EQ(expand(array).size(), 1000u);
+}
+
+TEST(SparseArray, WriteCaseMatchesDumpWithoutSparseArrays) {
+    const json single_case = {{"a", 1}, {"b", {{1, 2}, {3, 4}}}, {"s", {{"x", 1.5}, {"y", json::array()}}}};
+    const std::vector<std::pair<std::string, SymbolTableEntry>> variables{
+            {"b", array_entry(SymbolTableEntryType::Int32, {2, 2})}};
+    std::ostringstream expected{}, actual{};
+    expected << std::setw(4) << single_case;
+    write_case(actual, single_case, variables);
+    EXPECT_EQ(actual.str(), expected.str());
+
+    std::ostringstream empty{};
+    write_case(empty, json::object(), variables);
+    EXPECT_EQ(empty.str(), "{}");
+}
+
+TEST(SparseArray, WriteCaseExpandsSparseArrays) {
+    auto sparse = SparseArray::make({4, 3}, 11);
+    SparseArray::set(sparse, {4, 3}, {3, 2}, 5);
+    const json single_case = {{"a", 1}, {"big", sparse}};
+    const std::vector<std::pair<std::string, SymbolTableEntry>> variables{
+            {"a", SymbolTableEntry{}},
+            {"big", array_entry(SymbolTableEntryType::Int32, {4, 3})}};
+    std::ostringstream os{};
+    write_case(os, single_case, variables);
+    auto written = json::parse(os.str());
+    EXPECT_EQ(written["a"], 1);
+    EXPECT_EQ(written["big"], expand(SparseArray{sparse, {4, 3}, SymbolTableEntryType::Int32}));
+    EXPECT_EQ(written["big"][3][2], 5);
+}
+
+TEST(SparseArray, EvaluatesLikeTheExpandedArray) {
+    auto sparse = SparseArray::make({2, 3}, 5);
+    SparseArray::set(sparse, {2, 3}, {1, 2}, 8);
+    const json sparse_env = {{"m", sparse}};
+    const json full_env = {{"m", expand(SparseArray{sparse, {2, 3}, SymbolTableEntryType::Int32})}};
+
+    ir::Arena arena{};
+    auto m = arena.var("m");
+    auto elem = arena.make(ir::Op::Index, {arena.make(ir::Op::Index, {m, arena.int_const(1)}), arena.int_const(2)});
+    auto cons = arena.make(ir::Op::Eq, {elem, arena.int_const(8)});
+    auto rows = arena.make(ir::Op::Eq, {arena.make(ir::Op::Length, {m}), arena.int_const(2)});
+    auto cols = arena.make(ir::Op::Eq, {arena.make(ir::Op::Length, {arena.make(ir::Op::Index, {m, arena.int_const(1)})}),
+                                        arena.int_const(3)});
+    for (auto root: {cons, rows, cols}) {
+        EXPECT_TRUE(ir::evaluate(arena, root, sparse_env)) << arena.to_string(root);
+        EXPECT_TRUE(ir::evaluate(arena, root, full_env)) << arena.to_string(root);
+    }
+}
+
+TEST(SparseArray, LargeArraysAreSparseWithDefaultEncoding) {
+    // 默认的Nested编码下，只以常量下标引用的大数组也只保存被引用的元素
+    const char *src = R"(
+int big[70000];
+long grid[300][300];
+int n;
+
+void _CONSTRAINT()
+{
+    big[5] == 7;
+    big[69999] > n;
+    n > 100;
+    grid[299][1] < grid[0][298];
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 3;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 3u);
+    for (const auto &c: cases) {
+        ASSERT_TRUE(c["big"].is_array());
+        EXPECT_EQ(c["big"].size(), 70000u);
+        EXPECT_EQ(c["big"][5], 7);
+        EXPECT_GT(c["big"][69999], c["n"]);
+        ASSERT_EQ(c["grid"].size(), 300u);
+        EXPECT_EQ(c["grid"][17].size(), 300u);
+        EXPECT_TRUE(gen.satisfies(c));
+    }
+    // 完整的数组每个元素至少占一个json节点，三个用例远超此数
+    EXPECT_LT(gen.metrics().memory_cases_peak, 70000u);
+}
+
+TEST(SparseArray, SymbolicIndexKeepsLargeArraysNested) {
+    const char *src = R"(
+int big[70000];
+int i;
+
+void _CONSTRAINT()
+{
+    i >= 0 && i < 4;
+    big[i] == 3;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 2;
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_FALSE(cases.empty());
+    for (const auto &c: cases) {
+        EXPECT_EQ(c["big"].size(), 70000u);
+        EXPECT_TRUE(gen.satisfies(c));
+    }
+}
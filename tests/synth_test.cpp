@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include "generation.hpp"
+#include "synth.hpp"
+
+using namespace ststgen;
+
+namespace {
+    size_t count(const std::string &s, const std::string &needle) {
+        size_t n = 0;
+        for (auto pos = s.find(needle); pos != std::string::npos; pos = s.find(needle, pos + 1)) {
+            n++;
+        }
+        return n;
+    }
+}// namespace
+
+TEST(Synth, EmitsRequestedShape) {
+    SynthParams params{};
+    params.chain = 5;
+    params.or_density = 3;
+    auto src = make_synthetic_constraints(params);
+    EXPECT_EQ(count(src, "int x"), 6u);
+    EXPECT_NE(src.find("x4 < x5;"), std::string::npos);
+    EXPECT_EQ(count(src, " || "), 3u);
+    EXPECT_NE(src.find("void _CONSTRAINT()"), std::string::npos);
+}
+
+TEST(Synth, EmptyParamsStillGiveAValidFile) {
+    auto src = make_synthetic_constraints({});
+    EXPECT_NE(src.find("int x0;"), std::string::npos);
+    EXPECT_NE(src.find("x0 > 0;"), std::string::npos);
+}
+
+TEST(Synth, OutputParsesAndGeneratesSatisfyingCases) {
+    SynthParams params{};
+    params.chain = 4;
+    params.disjunction = 3;
+    params.array = 3;
+    params.struct_array = 2;
+    test::GenerationOptions opts{};
+    opts.cases = 8;
+    test::Generation gen{make_synthetic_constraints(params), opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 8u);
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+    }
+    EXPECT_EQ(gen.metrics().cases_rejected, 0u);
+}
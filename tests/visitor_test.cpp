@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "generation.hpp"
+
+using namespace ststgen;
+
+namespace {
+    const char *EXAMPLES[] = {"cons1.c", "cons2.c", "cons3.c", "cons4.c", "cons5.c",
+                              "cons_complex.c", "free_array.c", "ndim_array.c", "simple_val.c"};
+}// namespace
+
+TEST(Visitor, CollectsDeclarationsInOrder) {
+    test::GenerationOptions opts{};
+    opts.cases = 1;
+    test::Generation gen{test::example("cons1.c"), opts};
+    auto vars = gen.visitor().getDeclaredVariables();
+    ASSERT_EQ(vars.size(), 3u);
+    EXPECT_EQ(vars[0].first, "a");
+    EXPECT_EQ(vars[0].second.qualifer, SymbolTableEntryQualifer::Primary);
+    EXPECT_EQ(vars[0].second.type, SymbolTableEntryType::Int32);
+    EXPECT_EQ(vars[1].first, "b");
+    EXPECT_EQ(vars[1].second.qualifer, SymbolTableEntryQualifer::Array);
+    EXPECT_EQ(vars[1].second.dims, std::vector<int>{3});
+    EXPECT_EQ(vars[2].first, "s");
+    EXPECT_EQ(vars[2].second.type, SymbolTableEntryType::Struct);
+    EXPECT_EQ(vars[2].second.struct_name, "S1");
+
+    const auto &blueprint = gen.visitor().getStructBlueprints().at("S1");
+    EXPECT_EQ(blueprint.m_member_order, (std::vector<std::string>{"a", "b", "c", "d"}));
+    EXPECT_EQ(blueprint.m_members.at("c").type, SymbolTableEntryType::Float64);
+    EXPECT_EQ(blueprint.m_members.at("d").qualifer, SymbolTableEntryQualifer::Pointer);
+}
+
+TEST(Visitor, PositiveCasesSatisfyEveryExample) {
+    for (auto file: EXAMPLES) {
+        test::GenerationOptions opts{};
+        opts.cases = 10;
+        test::Generation gen{test::example(file), opts};
+        auto cases = gen.cases();
+        EXPECT_FALSE(cases.empty()) << file;
+        for (const auto &c: cases) {
+            EXPECT_TRUE(gen.satisfies(c)) << file << ": " << c.dump();
+        }
+        EXPECT_EQ(gen.metrics().cases_rejected, 0u) << file;
+    }
+}
+
+TEST(Visitor, NegativeCasesViolateEveryExample) {
+    for (auto file: EXAMPLES) {
+        test::GenerationOptions opts{};
+        opts.cases = 10;
+        opts.positive = false;
+        test::Generation gen{test::example(file), opts};
+        auto cases = gen.cases();
+        EXPECT_FALSE(cases.empty()) << file;
+        for (const auto &c: cases) {
+            EXPECT_FALSE(gen.satisfies(c)) << file << ": " << c.dump();
+        }
+    }
+}
+
+TEST(Visitor, CasesAreNumberedFromTheStartOffset) {
+    test::GenerationOptions opts{};
+    opts.cases = 3;
+    opts.start = 40;
+    test::Generation gen{test::example("simple_val.c"), opts};
+    EXPECT_EQ(gen.case_names(), (std::vector<std::string>{"P00040.json", "P00041.json", "P00042.json"}));
+}
+
+TEST(Visitor, UnreferencedVariablesAreFilledFromTheRng) {
+    const char *src = R"(
+typedef struct {
+    int x;
+    double y;
+} P;
+
+int a;
+unsigned u;
+double d;
+int m[2][3];
+long *q;
+P pt;
+
+void _CONSTRAINT()
+{
+    a > 0 && a < 1000;
+}
+)";
+    test::GenerationOptions opts{};
+    opts.cases = 20;
+    opts.configure = [](CConstraintVisitor &v) { v.setPointerEncoding(PointerEncoding::Seq, 8); };
+    test::Generation gen{src, opts};
+    auto cases = gen.cases();
+    ASSERT_EQ(cases.size(), 20u);
+    std::set<int64_t> seen_u{};
+    for (const auto &c: cases) {
+        EXPECT_TRUE(gen.satisfies(c)) << c.dump();
+        ASSERT_TRUE(c["u"].is_number_integer());
+        EXPECT_GE(c["u"].get<int64_t>(), 0);
+        EXPECT_LE(c["u"].get<int64_t>(), UINT32_MAX);
+        seen_u.insert(c["u"].get<int64_t>());
+        EXPECT_TRUE(c["d"].is_number());
+        ASSERT_EQ(c["m"].size(), 2u);
+        EXPECT_EQ(c["m"][1].size(), 3u);
+        EXPECT_GE(c["q"].size(), 1u);
+        EXPECT_LE(c["q"].size(), 8u);
+        EXPECT_TRUE(c["pt"]["x"].is_number_integer());
+        EXPECT_TRUE(c["pt"]["y"].is_number());
+    }
+    // 每个用例重新抽取，而不是沿用同一个值
+    EXPECT_GT(seen_u.size(), 1u);
+}